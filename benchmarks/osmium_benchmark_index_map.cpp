@@ -10,14 +10,63 @@
 #include <osmium/io/any_input.hpp>
 #include <osmium/visitor.hpp>
 
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <random>
 #include <string>
+#include <vector>
 
 using index_type = osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>;
 
 using location_handler_type = osmium::handler::NodeLocationsForWays<index_type>;
 
+// Remembers the largest node ID, used as upper bound for the random lookups.
+struct MaxIdHandler : public osmium::handler::Handler {
+
+    osmium::unsigned_object_id_type max_id = 0;
+
+    void node(const osmium::Node& node) noexcept {
+        if (node.positive_id() > max_id) {
+            max_id = node.positive_id();
+        }
+    }
+
+}; // struct MaxIdHandler
+
+// Look up random IDs in the index. This is what happens when adding node
+// locations to ways. For large indexes the time is dominated by cache and
+// TLB misses, so this shows the effect of the memory layout of the index
+// (for instance dense_mmap_array vs. dense_mmap_array_huge).
+static void random_lookups(const index_type& index, osmium::unsigned_object_id_type max_id) {
+    const std::size_t num_lookups = 10 * 1000 * 1000;
+
+    std::mt19937_64 generator{42};
+    std::uniform_int_distribution<osmium::unsigned_object_id_type> distribution{1, max_id};
+    std::vector<osmium::unsigned_object_id_type> ids(num_lookups);
+    for (auto& id : ids) {
+        id = distribution(generator);
+    }
+
+    // Each ID depends on the result of the previous lookup, so that the
+    // CPU can't overlap the lookups and we see the full latency.
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t found = 0;
+    osmium::unsigned_object_id_type last = 0;
+    for (const auto id : ids) {
+        const auto location = index.get_noexcept(id + (last & 1U));
+        if (location.valid()) {
+            ++found;
+        }
+        last = static_cast<osmium::unsigned_object_id_type>(location.x());
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    std::cout << "random lookups: " << num_lookups
+              << " found: " << found
+              << " time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms\n";
+}
+
 int main(int argc, char* argv[]) {
     if (argc != 3) {
         std::cerr << "Usage: " << argv[0] << " OSMFILE FORMAT\n";
@@ -35,11 +84,17 @@ int main(int argc, char* argv[]) {
         location_handler_type location_handler{*index};
         location_handler.ignore_errors();
 
-        osmium::apply(reader, location_handler);
+        MaxIdHandler max_id_handler;
+
+        osmium::apply(reader, location_handler, max_id_handler);
         reader.close();
+
+        if (max_id_handler.max_id > 0) {
+            index->sort();
+            random_lookups(*index, max_id_handler.max_id);
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << '\n';
         std::exit(1);
     }
 }
-
@@ -0,0 +1,127 @@
+/*
+
+  Benchmark for the OPL parser. Compares the byte-by-byte and the
+  vectorized (SSE2/AVX2) scanners used for finding separators in OPL
+  lines and measures the time needed for parsing all lines.
+
+  The input file can be in any format, it is converted to OPL first.
+
+  To compare the complete parsing with and without the vectorized
+  scanner, compile a second time with -DOSMIUM_OPL_NO_SIMD.
+
+  The code in this file is released into the Public Domain.
+
+*/
+
+#include <osmium/io/any_input.hpp>
+#include <osmium/io/detail/opl_parser_functions.hpp>
+#include <osmium/io/detail/opl_scanner.hpp>
+#include <osmium/io/opl_output.hpp>
+#include <osmium/io/writer.hpp>
+#include <osmium/memory/buffer.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    std::vector<std::string> read_opl_lines(const std::string& input_filename) {
+        const std::string opl_filename{"osmium_benchmark_opl_parse.opl"};
+
+        osmium::io::Reader reader{input_filename};
+        osmium::io::Writer writer{opl_filename, osmium::io::overwrite::allow};
+        while (osmium::memory::Buffer buffer = reader.read()) {
+            writer(std::move(buffer));
+        }
+        writer.close();
+        reader.close();
+
+        std::vector<std::string> lines;
+        std::ifstream file{opl_filename};
+        for (std::string line; std::getline(file, line);) {
+            lines.push_back(std::move(line));
+        }
+        std::remove(opl_filename.c_str());
+
+        return lines;
+    }
+
+    template <typename TFunc>
+    void run(const char* name, TFunc&& func) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = func();
+        const auto stop = std::chrono::steady_clock::now();
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+        std::cout << name << ": " << ms << "ms (result " << result << ")\n";
+    }
+
+    // Walk through a line the way the parser does: Split into sections
+    // at spaces and inside sections into strings at the OPL separators.
+    template <typename TSectionEnd, typename TStringEnd>
+    uint64_t scan_lines(const std::vector<std::string>& lines, TSectionEnd&& section_end, TStringEnd&& string_end) {
+        uint64_t count = 0;
+        for (const auto& line : lines) {
+            const char* s = line.c_str();
+            while (*s) {
+                const char* e = section_end(s);
+                for (const char* p = s; p < e; ++p) {
+                    p = string_end(p);
+                    ++count;
+                }
+                s = *e ? e + 1 : e;
+            }
+        }
+        return count;
+    }
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " OSMFILE\n";
+        std::exit(1);
+    }
+
+    try {
+        const auto lines = read_opl_lines(argv[1]);
+        std::cout << "Lines: " << lines.size() << '\n';
+
+        using namespace osmium::io::detail; // NOLINT(google-build-using-namespace)
+
+        run("scanner byte-by-byte", [&lines]() {
+            return scan_lines(lines,
+                              [](const char* s) { return opl_find_first_of_scalar<'\0', ' ', '\t'>(s); },
+                              [](const char* s) { return opl_find_first_of_scalar<'\0', ' ', '\t', ',', '=', '%'>(s); });
+        });
+
+        run("scanner vectorized", [&lines]() {
+            return scan_lines(lines,
+                              [](const char* s) { return opl_find_section_end(s); },
+                              [](const char* s) { return opl_find_string_end(s); });
+        });
+
+        run("parse", [&lines]() {
+            uint64_t count = 0;
+            osmium::memory::Buffer buffer{1024UL * 1024UL, osmium::memory::Buffer::auto_grow::yes};
+            uint64_t line_count = 0;
+            for (const auto& line : lines) {
+                if (opl_parse_line(line_count++, line.c_str(), buffer)) {
+                    ++count;
+                }
+                if (buffer.committed() > 10UL * 1024UL * 1024UL) {
+                    buffer.clear();
+                }
+            }
+            return count;
+        });
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        std::exit(1);
+    }
+}
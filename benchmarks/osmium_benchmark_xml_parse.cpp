@@ -0,0 +1,152 @@
+/*
+
+  Benchmark for the XML parser. Compares parsing with Expat and with the
+  XMLPullParser, each on the parser thread only and in parallel on the
+  thread pool.
+
+  The input file can be in any format, it is converted to XML first. The
+  XML data is held in memory so that only the parsing is measured.
+
+  The code in this file is released into the Public Domain.
+
+*/
+
+#include <osmium/io/any_input.hpp>
+#include <osmium/io/detail/queue_util.hpp>
+#include <osmium/io/writer.hpp>
+#include <osmium/io/xml_input.hpp>
+#include <osmium/io/xml_output.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    std::vector<std::string> read_xml_blocks(const std::string& input_filename) {
+        const std::string xml_filename{"osmium_benchmark_xml_parse.osm"};
+
+        osmium::io::Reader reader{input_filename};
+        osmium::io::Writer writer{xml_filename, reader.header(), osmium::io::overwrite::allow};
+        while (osmium::memory::Buffer buffer = reader.read()) {
+            writer(std::move(buffer));
+        }
+        writer.close();
+        reader.close();
+
+        std::ifstream file{xml_filename, std::ios::binary};
+        const std::string data{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        std::remove(xml_filename.c_str());
+
+        // Cut into blocks the size the decompressors usually return.
+        const std::size_t block_size = 1024UL * 1024UL;
+        std::vector<std::string> blocks;
+        for (std::size_t pos = 0; pos < data.size(); pos += block_size) {
+            blocks.push_back(data.substr(pos, block_size));
+        }
+
+        return blocks;
+    }
+
+    uint64_t parse(const std::vector<std::string>& blocks, osmium::thread::Pool& pool, const bool parallel, const bool pull_parser) {
+        osmium::io::detail::future_string_queue_type input_queue;
+        osmium::io::detail::future_buffer_queue_type output_queue{20};
+        std::promise<osmium::io::Header> header_promise;
+
+        for (const auto& block : blocks) {
+            osmium::io::detail::add_to_queue(input_queue, std::string{block});
+        }
+        osmium::io::detail::add_to_queue(input_queue, std::string{});
+
+        osmium::io::detail::parser_arguments args = {
+            pool,
+            input_queue,
+            output_queue,
+            header_promise,
+            osmium::osm_entity_bits::all,
+            osmium::io::read_meta::yes,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr
+        };
+
+        std::thread thread{[&]() {
+            osmium::io::detail::XMLParser parser{args, parallel, pull_parser};
+            parser.parse();
+        }};
+
+        uint64_t count = 0;
+        while (true) {
+            std::future<osmium::memory::Buffer> future_buffer;
+            output_queue.wait_and_pop(future_buffer);
+            osmium::memory::Buffer buffer{future_buffer.get()};
+            if (!buffer) {
+                break;
+            }
+            while (buffer.has_nested_buffers()) {
+                const auto nested = buffer.get_last_nested();
+                count += static_cast<uint64_t>(std::distance(nested->begin(), nested->end()));
+            }
+            count += static_cast<uint64_t>(std::distance(buffer.begin(), buffer.end()));
+        }
+
+        thread.join();
+
+        return count;
+    }
+
+    template <typename TFunc>
+    void run(const char* name, TFunc&& func) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto result = func();
+        const auto stop = std::chrono::steady_clock::now();
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+        std::cout << name << ": " << ms << "ms (result " << result << ")\n";
+    }
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " OSMFILE\n";
+        std::exit(1);
+    }
+
+    try {
+        const auto blocks = read_xml_blocks(argv[1]);
+        std::cout << "Blocks: " << blocks.size() << '\n';
+
+        osmium::thread::Pool& pool = osmium::thread::Pool::default_instance();
+        std::cout << "Threads: " << pool.num_threads() << '\n';
+
+        run("expat", [&]() {
+            return parse(blocks, pool, false, false);
+        });
+
+        run("pull parser", [&]() {
+            return parse(blocks, pool, false, true);
+        });
+
+        run("expat parallel", [&]() {
+            return parse(blocks, pool, true, false);
+        });
+
+        run("pull parser parallel", [&]() {
+            return parse(blocks, pool, true, true);
+        });
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        std::exit(1);
+    }
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+#
+#  run_benchmark_xml_parse.sh
+#
+
+set -e
+
+BENCHMARK_NAME=xml_parse
+
+. @CMAKE_BINARY_DIR@/benchmarks/setup.sh
+
+CMD=$OB_DIR/osmium_benchmark_$BENCHMARK_NAME
+
+for data in $OB_DATA_FILES; do
+    filename=`basename $data`
+    echo "# $filename"
+    $CMD $data
+done
+
@@ -51,6 +51,10 @@
 #    OSMIUM_PBF_LIBRARIES - Libraries needed for PBF I/O.
 #    OSMIUM_IO_LIBRARIES  - Libraries needed for XML or PBF I/O.
 #    OSMIUM_LIBRARIES     - All libraries Osmium uses somewhere.
+#    LZ4_FOUND            - True if LZ4 support for PBF blobs is enabled.
+#    ZSTD_FOUND           - True if Zstandard support for PBF blobs is enabled.
+#    LIBDEFLATE_FOUND     - True if libdeflate is used for zlib compressed PBF
+#                           blobs (only if Osmium_USE_LIBDEFLATE is set).
 #
 #----------------------------------------------------------------------
 
@@ -129,6 +133,48 @@ if(Osmium_USE_PBF)
     else()
         message(WARNING "Osmium: Can not find some libraries for PBF input/output, please install them or configure the paths.")
     endif()
+
+    # Optional libdeflate backend for zlib compressed PBF blobs. This is
+    # not used automatically, set Osmium_USE_LIBDEFLATE to enable it.
+    if(Osmium_USE_LIBDEFLATE)
+        find_path(LIBDEFLATE_INCLUDE_DIR libdeflate.h)
+        find_library(LIBDEFLATE_LIBRARY NAMES deflate)
+        mark_as_advanced(LIBDEFLATE_INCLUDE_DIR LIBDEFLATE_LIBRARY)
+        if(LIBDEFLATE_INCLUDE_DIR AND LIBDEFLATE_LIBRARY)
+            set(LIBDEFLATE_FOUND TRUE)
+            list(APPEND OSMIUM_PBF_LIBRARIES ${LIBDEFLATE_LIBRARY})
+            list(APPEND OSMIUM_INCLUDE_DIRS ${LIBDEFLATE_INCLUDE_DIR})
+            add_definitions(-DOSMIUM_WITH_LIBDEFLATE)
+        else()
+            message(WARNING "Osmium: Can not find libdeflate, using zlib for PBF blobs.")
+        endif()
+    endif()
+
+    # Optional support for LZ4 and Zstandard compressed PBF blobs. These
+    # are used automatically if the libraries are found.
+    find_path(LZ4_INCLUDE_DIR lz4hc.h)
+    find_library(LZ4_LIBRARY NAMES lz4)
+    mark_as_advanced(LZ4_INCLUDE_DIR LZ4_LIBRARY)
+    if(LZ4_INCLUDE_DIR AND LZ4_LIBRARY)
+        set(LZ4_FOUND TRUE)
+        list(APPEND OSMIUM_PBF_LIBRARIES ${LZ4_LIBRARY})
+        list(APPEND OSMIUM_INCLUDE_DIRS ${LZ4_INCLUDE_DIR})
+        add_definitions(-DOSMIUM_WITH_LZ4)
+    else()
+        set(LZ4_FOUND FALSE)
+    endif()
+
+    find_path(ZSTD_INCLUDE_DIR zstd.h)
+    find_library(ZSTD_LIBRARY NAMES zstd)
+    mark_as_advanced(ZSTD_INCLUDE_DIR ZSTD_LIBRARY)
+    if(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+        set(ZSTD_FOUND TRUE)
+        list(APPEND OSMIUM_PBF_LIBRARIES ${ZSTD_LIBRARY})
+        list(APPEND OSMIUM_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR})
+        add_definitions(-DOSMIUM_WITH_ZSTD)
+    else()
+        set(ZSTD_FOUND FALSE)
+    endif()
 endif()
 
 #----------------------------------------------------------------------
@@ -37,14 +37,18 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/index/index.hpp>
 #include <osmium/index/map/dummy.hpp>
 #include <osmium/index/node_locations_map.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/item_type.hpp>
 #include <osmium/osm/location.hpp>
 #include <osmium/osm/node.hpp>
 #include <osmium/osm/node_ref.hpp>
 #include <osmium/osm/types.hpp>
 #include <osmium/osm/way.hpp>
 
+#include <cstddef>
 #include <limits>
 #include <type_traits>
+#include <vector>
 
 namespace osmium {
 
@@ -88,6 +92,12 @@ namespace osmium {
 
             bool m_must_sort = false;
 
+            // Used by process_buffer() for the lookups of all node refs
+            // with positive IDs.
+            std::vector<osmium::Way*> m_batch_ways;
+            std::vector<osmium::unsigned_object_id_type> m_batch_ids;
+            std::vector<osmium::Location> m_batch_locations;
+
             // It is okay to have this static dummy instance, even when using several threads,
             // because it is read-only.
             static dummy_type& get_dummy() {
@@ -95,6 +105,55 @@ namespace osmium {
                 return instance;
             }
 
+            void sort_if_needed() {
+                if (m_must_sort) {
+                    m_storage_pos.sort();
+                    m_storage_neg.sort();
+                    m_must_sort = false;
+                    m_last_id = std::numeric_limits<osmium::unsigned_object_id_type>::max();
+                }
+            }
+
+            void resolve_batch() {
+                if (m_batch_ways.empty()) {
+                    return;
+                }
+
+                sort_if_needed();
+
+                m_batch_ids.clear();
+                for (const osmium::Way* way : m_batch_ways) {
+                    for (const auto& node_ref : way->nodes()) {
+                        if (node_ref.ref() >= 0) {
+                            m_batch_ids.push_back(static_cast<osmium::unsigned_object_id_type>(node_ref.ref()));
+                        }
+                    }
+                }
+
+                m_batch_locations.resize(m_batch_ids.size());
+                m_storage_pos.get_noexcept_batch(m_batch_ids.data(), m_batch_ids.size(), m_batch_locations.data());
+
+                bool error = false;
+                std::size_t n = 0;
+                for (osmium::Way* way : m_batch_ways) {
+                    for (auto& node_ref : way->nodes()) {
+                        if (node_ref.ref() >= 0) {
+                            node_ref.set_location(m_batch_locations[n++]);
+                        } else {
+                            node_ref.set_location(m_storage_neg.get_noexcept(static_cast<osmium::unsigned_object_id_type>(-node_ref.ref())));
+                        }
+                        if (!node_ref.location()) {
+                            error = true;
+                        }
+                    }
+                }
+                m_batch_ways.clear();
+
+                if (!m_ignore_errors && error) {
+                    throw osmium::not_found{"location for one or more nodes not found in node location index"};
+                }
+            }
+
         public:
 
             explicit NodeLocationsForWays(TStoragePosIDs& storage_pos,
@@ -147,12 +206,7 @@ namespace osmium {
              * them to the way object.
              */
             void way(osmium::Way& way) {
-                if (m_must_sort) {
-                    m_storage_pos.sort();
-                    m_storage_neg.sort();
-                    m_must_sort = false;
-                    m_last_id = std::numeric_limits<osmium::unsigned_object_id_type>::max();
-                }
+                sort_if_needed();
                 bool error = false;
                 for (auto& node_ref : way.nodes()) {
                     node_ref.set_location(get_node_location(node_ref.ref()));
@@ -165,6 +219,50 @@ namespace osmium {
                 }
             }
 
+            /**
+             * Store the locations of all nodes in the buffer and add the
+             * node locations to all ways in the buffer. This has the same
+             * effect as calling node() and way() for all nodes and ways
+             * in the buffer, but the locations for all ways are looked up
+             * in one batch using Map::get_noexcept_batch(), which is much
+             * faster for large indexes. The nodes in the buffer are all
+             * stored before any ways are handled.
+             *
+             * @throws osmium::not_found If a location could not be found
+             *         and ignore_errors() was not called. In this case
+             *         the locations of all ways are still set as far as
+             *         possible.
+             */
+            void process_buffer(osmium::memory::Buffer& buffer) {
+                for (auto& item : buffer) {
+                    if (item.type() == osmium::item_type::node) {
+                        node(static_cast<const osmium::Node&>(item));
+                    } else if (item.type() == osmium::item_type::way) {
+                        m_batch_ways.push_back(&static_cast<osmium::Way&>(item));
+                    }
+                }
+                resolve_batch();
+            }
+
+            /**
+             * Add the node locations to all ways in the buffer, looking
+             * them up in one batch like process_buffer() does. Nodes in
+             * the buffer are ignored. This only reads from the indexes (if
+             * no sorting is needed), so several NodeLocationsForWays
+             * objects sharing the same indexes can do this at the same
+             * time from different threads, as long as nobody is writing
+             * to the indexes.
+             *
+             * @throws osmium::not_found If a location could not be found
+             *         and ignore_errors() was not called.
+             */
+            void add_locations_to_ways(osmium::memory::Buffer& buffer) {
+                for (auto& way : buffer.select<osmium::Way>()) {
+                    m_batch_ways.push_back(&way);
+                }
+                resolve_batch();
+            }
+
             /**
              * Call clear on the location indexes. Makes the
              * NodeLocationsForWays handler unusable. Used to explicitly free
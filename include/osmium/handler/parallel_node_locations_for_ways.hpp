@@ -0,0 +1,433 @@
+#ifndef OSMIUM_HANDLER_PARALLEL_NODE_LOCATIONS_FOR_WAYS_HPP
+#define OSMIUM_HANDLER_PARALLEL_NODE_LOCATIONS_FOR_WAYS_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/handler/node_locations_for_ways.hpp>
+#include <osmium/io/reader.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/item_type.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <utility>
+
+namespace osmium {
+
+    namespace handler {
+
+        namespace detail {
+
+            /**
+             * Counts tasks running on the thread pool so that we can wait
+             * until all of them are done.
+             */
+            class pending_tasks {
+
+                std::mutex m_mutex;
+                std::condition_variable m_done;
+                std::size_t m_count = 0;
+
+            public:
+
+                void add() {
+                    const std::lock_guard<std::mutex> lock{m_mutex};
+                    ++m_count;
+                }
+
+                void remove() {
+                    const std::lock_guard<std::mutex> lock{m_mutex};
+                    if (--m_count == 0) {
+                        m_done.notify_all();
+                    }
+                }
+
+                void wait() {
+                    std::unique_lock<std::mutex> lock{m_mutex};
+                    m_done.wait(lock, [this] { return m_count == 0; });
+                }
+
+            }; // class pending_tasks
+
+            class pending_task_guard {
+
+                pending_tasks& m_tasks;
+
+            public:
+
+                explicit pending_task_guard(pending_tasks& tasks) noexcept :
+                    m_tasks(tasks) {
+                }
+
+                pending_task_guard(const pending_task_guard&) = delete;
+                pending_task_guard& operator=(const pending_task_guard&) = delete;
+
+                ~pending_task_guard() {
+                    m_tasks.remove();
+                }
+
+            }; // class pending_task_guard
+
+            template <typename TStoragePosIDs, typename TStorageNegIDs>
+            void store_node_locations(const osmium::memory::Buffer& buffer, TStoragePosIDs& storage_pos, TStorageNegIDs& storage_neg) {
+                for (const auto& node : buffer.select<osmium::Node>()) {
+                    const auto id = node.id();
+                    if (id >= 0) {
+                        storage_pos.set(static_cast<osmium::unsigned_object_id_type>( id), node.location());
+                    } else {
+                        storage_neg.set(static_cast<osmium::unsigned_object_id_type>(-id), node.location());
+                    }
+                }
+            }
+
+            template <typename TStoragePosIDs, typename TStorageNegIDs>
+            class store_node_locations_task {
+
+                TStoragePosIDs* m_storage_pos;
+                TStorageNegIDs* m_storage_neg;
+                pending_tasks* m_pending;
+                osmium::memory::Buffer m_buffer;
+
+            public:
+
+                store_node_locations_task(TStoragePosIDs& storage_pos, TStorageNegIDs& storage_neg, pending_tasks& pending, osmium::memory::Buffer&& buffer) :
+                    m_storage_pos(&storage_pos),
+                    m_storage_neg(&storage_neg),
+                    m_pending(&pending),
+                    m_buffer(std::move(buffer)) {
+                }
+
+                osmium::memory::Buffer operator()() {
+                    const pending_task_guard guard{*m_pending};
+                    store_node_locations(m_buffer, *m_storage_pos, *m_storage_neg);
+                    return std::move(m_buffer);
+                }
+
+            }; // class store_node_locations_task
+
+            template <typename TStoragePosIDs, typename TStorageNegIDs>
+            class add_locations_to_ways_task {
+
+                TStoragePosIDs* m_storage_pos;
+                TStorageNegIDs* m_storage_neg;
+                pending_tasks* m_pending;
+                osmium::memory::Buffer m_buffer;
+                bool m_ignore_errors;
+
+            public:
+
+                add_locations_to_ways_task(TStoragePosIDs& storage_pos, TStorageNegIDs& storage_neg, pending_tasks& pending, osmium::memory::Buffer&& buffer, bool ignore_errors) :
+                    m_storage_pos(&storage_pos),
+                    m_storage_neg(&storage_neg),
+                    m_pending(&pending),
+                    m_buffer(std::move(buffer)),
+                    m_ignore_errors(ignore_errors) {
+                }
+
+                osmium::memory::Buffer operator()() {
+                    const pending_task_guard guard{*m_pending};
+                    NodeLocationsForWays<TStoragePosIDs, TStorageNegIDs> handler{*m_storage_pos, *m_storage_neg};
+                    if (m_ignore_errors) {
+                        handler.ignore_errors();
+                    }
+                    handler.add_locations_to_ways(m_buffer);
+                    return std::move(m_buffer);
+                }
+
+            }; // class add_locations_to_ways_task
+
+        } // namespace detail
+
+        /**
+         * Multithreaded version of the NodeLocationsForWays handler. It
+         * works on whole buffers instead of single objects: Node locations
+         * are stored in the indexes and the node locations are added to
+         * the ways from the threads of a thread pool, one task per buffer.
+         *
+         * All nodes are stored before any ways are processed: When the
+         * first buffer with ways arrives, it waits until all pending node
+         * buffers are done and sorts the indexes if needed. Ways are then
+         * processed in parallel, reading from the indexes only. If nodes
+         * show up again after ways (unsorted input), it waits for all
+         * pending way buffers before storing them.
+         *
+         * Node locations are only stored in parallel if both indexes
+         * support it (see Map::supports_concurrent_set()), which is the
+         * case for the dense array indexes. For other indexes the nodes
+         * are stored on the calling thread, adding the locations to the
+         * ways is still done in parallel. When storing in parallel the
+         * dense indexes are grown in larger steps, so they can end up to
+         * a quarter larger than needed.
+         *
+         * Usually you'll use the process() function, which reads all data
+         * from a reader and hands the buffers to you in order after the
+         * locations have been added. If you want to drive this yourself,
+         * call operator() for each buffer in order and wait for the
+         * futures it returns.
+         *
+         * @tparam TStoragePosIDs Class that handles the actual storage of the node locations
+         *                        (for positive IDs).
+         * @tparam TStorageNegIDs Same but for negative IDs.
+         */
+        template <typename TStoragePosIDs, typename TStorageNegIDs = dummy_type>
+        class ParallelNodeLocationsForWays {
+
+            TStoragePosIDs& m_storage_pos;
+            TStorageNegIDs& m_storage_neg;
+            osmium::thread::Pool& m_pool;
+
+            detail::pending_tasks m_pending_nodes;
+            detail::pending_tasks m_pending_ways;
+
+            osmium::unsigned_object_id_type m_last_id = 0;
+
+            bool m_concurrent_set;
+
+            bool m_ignore_errors = false;
+
+            bool m_must_sort = false;
+
+            bool m_growable_pos = true;
+
+            bool m_growable_neg = true;
+
+            static dummy_type& get_dummy() {
+                static dummy_type instance;
+                return instance;
+            }
+
+            static std::future<osmium::memory::Buffer> ready_future(osmium::memory::Buffer&& buffer) {
+                std::promise<osmium::memory::Buffer> promise;
+                promise.set_value(std::move(buffer));
+                return promise.get_future();
+            }
+
+            // Make sure the index is large enough for the id, so that the
+            // tasks only write into existing memory. Growing the index
+            // might move it, so we have to wait for all tasks writing to
+            // it first. To not have to do this for every buffer, the
+            // index is grown by a quarter more than needed. The extra
+            // entries have the empty value. If the index doesn't grow
+            // (for instance the Dummy index which ignores set()), growable
+            // is set to false and the index is never grown again, so we
+            // don't wait for the tasks on every buffer.
+            template <typename TStorage>
+            void grow(TStorage& storage, bool& growable, const osmium::unsigned_object_id_type max_id) {
+                if (!growable || max_id < storage.size()) {
+                    return;
+                }
+                m_pending_nodes.wait();
+                storage.set(max_id + max_id / 4, osmium::Location{});
+                growable = max_id < storage.size();
+            }
+
+            void wait() {
+                m_pending_nodes.wait();
+                m_pending_ways.wait();
+            }
+
+        public:
+
+            explicit ParallelNodeLocationsForWays(TStoragePosIDs& storage_pos,
+                                                  TStorageNegIDs& storage_neg = get_dummy(),
+                                                  osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) :
+                m_storage_pos(storage_pos),
+                m_storage_neg(storage_neg),
+                m_pool(pool),
+                m_concurrent_set(storage_pos.supports_concurrent_set() && storage_neg.supports_concurrent_set()) {
+            }
+
+            ParallelNodeLocationsForWays(const ParallelNodeLocationsForWays&) = delete;
+            ParallelNodeLocationsForWays& operator=(const ParallelNodeLocationsForWays&) = delete;
+
+            ParallelNodeLocationsForWays(ParallelNodeLocationsForWays&&) = delete;
+            ParallelNodeLocationsForWays& operator=(ParallelNodeLocationsForWays&&) = delete;
+
+            ~ParallelNodeLocationsForWays() noexcept {
+                // The tasks still running reference the pending task
+                // counters, so we have to wait for them.
+                wait();
+            }
+
+            void ignore_errors() {
+                m_ignore_errors = true;
+            }
+
+            /**
+             * Hand over the next buffer. Buffers must be given to this
+             * function in the order they appear in the input.
+             *
+             * @returns Future with the buffer after the node locations
+             *          have been stored and added to the ways. If a
+             *          location for a way could not be found and
+             *          ignore_errors() was not called, the future holds
+             *          an osmium::not_found exception.
+             */
+            std::future<osmium::memory::Buffer> operator()(osmium::memory::Buffer&& buffer) {
+                osmium::unsigned_object_id_type max_pos_id = 0;
+                osmium::unsigned_object_id_type max_neg_id = 0;
+                bool has_pos_ids = false;
+                bool has_neg_ids = false;
+                bool has_ways = false;
+
+                for (const auto& item : buffer) {
+                    if (item.type() == osmium::item_type::node) {
+                        const auto& node = static_cast<const osmium::Node&>(item);
+                        if (node.positive_id() < m_last_id) {
+                            m_must_sort = true;
+                        }
+                        m_last_id = node.positive_id();
+                        if (node.id() >= 0) {
+                            has_pos_ids = true;
+                            max_pos_id = std::max(max_pos_id, node.positive_id());
+                        } else {
+                            has_neg_ids = true;
+                            max_neg_id = std::max(max_neg_id, node.positive_id());
+                        }
+                    } else if (item.type() == osmium::item_type::way) {
+                        has_ways = true;
+                    }
+                }
+
+                if (has_pos_ids || has_neg_ids) {
+                    // Nobody must read from the indexes while we write.
+                    m_pending_ways.wait();
+
+                    if (m_concurrent_set && !has_ways) {
+                        if (has_pos_ids) {
+                            grow(m_storage_pos, m_growable_pos, max_pos_id);
+                        }
+                        if (has_neg_ids) {
+                            grow(m_storage_neg, m_growable_neg, max_neg_id);
+                        }
+                        m_pending_nodes.add();
+                        try {
+                            return m_pool.submit(detail::store_node_locations_task<TStoragePosIDs, TStorageNegIDs>{m_storage_pos, m_storage_neg, m_pending_nodes, std::move(buffer)});
+                        } catch (...) {
+                            m_pending_nodes.remove();
+                            throw;
+                        }
+                    }
+
+                    m_pending_nodes.wait();
+                    detail::store_node_locations(buffer, m_storage_pos, m_storage_neg);
+                }
+
+                if (!has_ways) {
+                    return ready_future(std::move(buffer));
+                }
+
+                m_pending_nodes.wait();
+                if (m_must_sort) {
+                    m_storage_pos.sort();
+                    m_storage_neg.sort();
+                    m_must_sort = false;
+                    m_last_id = std::numeric_limits<osmium::unsigned_object_id_type>::max();
+                }
+
+                m_pending_ways.add();
+                try {
+                    return m_pool.submit(detail::add_locations_to_ways_task<TStoragePosIDs, TStorageNegIDs>{m_storage_pos, m_storage_neg, m_pending_ways, std::move(buffer), m_ignore_errors});
+                } catch (...) {
+                    m_pending_ways.remove();
+                    throw;
+                }
+            }
+
+            /**
+             * Read all data from the reader, add the node locations to
+             * the ways and call func(buffer) with each buffer in the
+             * order they were read. The function is called on the calling
+             * thread. Afterwards the buffers are given back to the reader
+             * with Reader::recycle().
+             *
+             * @throws osmium::not_found If a location could not be found
+             *         and ignore_errors() was not called.
+             */
+            template <typename TFunc>
+            void process(osmium::io::Reader& reader, TFunc&& func) {
+                // Limit number of buffers in flight so that we don't read
+                // the whole file into memory if the tasks are slower than
+                // the reader.
+                const auto max_pending = 2 * static_cast<std::size_t>(m_pool.num_threads());
+                std::deque<std::future<osmium::memory::Buffer>> pending;
+
+                try {
+                    while (auto buffer = reader.read()) {
+                        pending.push_back((*this)(std::move(buffer)));
+                        while (pending.size() > max_pending) {
+                            auto done = pending.front().get();
+                            pending.pop_front();
+                            func(done);
+                            reader.recycle(std::move(done));
+                        }
+                    }
+
+                    while (!pending.empty()) {
+                        auto done = pending.front().get();
+                        pending.pop_front();
+                        func(done);
+                        reader.recycle(std::move(done));
+                    }
+                } catch (...) {
+                    wait();
+                    throw;
+                }
+            }
+
+            /**
+             * Call clear on the location indexes. Makes the handler
+             * unusable. Used to explicitly free memory if thats needed.
+             */
+            void clear() {
+                wait();
+                m_storage_pos.clear();
+                m_storage_neg.clear();
+            }
+
+        }; // class ParallelNodeLocationsForWays
+
+    } // namespace handler
+
+} // namespace osmium
+
+#endif // OSMIUM_HANDLER_PARALLEL_NODE_LOCATIONS_FOR_WAYS_HPP
@@ -56,6 +56,21 @@ namespace osmium {
 
         }; // class mmap_vector_anon
 
+        /**
+         * Same as mmap_vector_anon, but the memory is backed by
+         * transparent huge pages if the system supports them.
+         */
+        template <typename T>
+        class mmap_vector_anon_huge : public mmap_vector_base<T> {
+
+        public:
+
+            mmap_vector_anon_huge() :
+                mmap_vector_base<T>(mmap_vector_size_increment, osmium::MemoryMapping::mapping_mode::write_private_huge) {
+            }
+
+        }; // class mmap_vector_anon_huge
+
     } // namespace detail
 
 } // namespace osmium
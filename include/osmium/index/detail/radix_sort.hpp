@@ -0,0 +1,321 @@
+#ifndef OSMIUM_INDEX_DETAIL_RADIX_SORT_HPP
+#define OSMIUM_INDEX_DETAIL_RADIX_SORT_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/thread/pool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace index {
+
+        namespace detail {
+
+            enum : std::size_t {
+                // Below this number of elements std::sort() is used,
+                // because it is faster than starting all the tasks.
+                radix_sort_min_size = 1024UL * 1024UL
+            };
+
+            /**
+             * Call func(n) for n in 0 .. num_chunks-1. Chunk 0 is done on
+             * the calling thread, the other chunks on the pool.
+             */
+            template <typename TFunc>
+            void run_chunks(osmium::thread::Pool& pool, const std::size_t num_chunks, TFunc&& func) {
+                std::vector<std::future<void>> futures;
+                futures.reserve(num_chunks);
+
+                std::exception_ptr error;
+                try {
+                    for (std::size_t n = 1; n < num_chunks; ++n) {
+                        futures.push_back(pool.submit([&func, n]() {
+                            func(n);
+                        }));
+                    }
+                    func(0);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+
+                // All tasks reference func and the data, so we have to wait
+                // for all of them, even if one fails.
+                for (auto& future : futures) {
+                    try {
+                        future.get();
+                    } catch (...) {
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                }
+
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+
+            /**
+             * Map an integral key to an unsigned value with the same
+             * order. For signed keys the sign bit is flipped, so that
+             * negative keys come before positive ones.
+             */
+            template <typename TKey>
+            uint64_t radix_sort_key(const TKey key) noexcept {
+                using unsigned_key_type = typename std::make_unsigned<TKey>::type;
+                constexpr const unsigned_key_type sign_bit = std::is_signed<TKey>::value ? unsigned_key_type(1) << (sizeof(TKey) * 8U - 1U) : 0U;
+                return static_cast<uint64_t>(static_cast<unsigned_key_type>(static_cast<unsigned_key_type>(key) ^ sign_bit));
+            }
+
+            /**
+             * Sort the elements in data by the integer key returned from
+             * key(element) using a parallel LSD radix sort with one byte
+             * per pass. Bytes which are the same in all keys are skipped.
+             * Runs of elements with the same key are then sorted using
+             * operator<, so the result is the same as with std::sort() as
+             * long as operator< orders by key first.
+             *
+             * This needs temporary memory of the same size as the data.
+             * The data is split into one chunk per pool thread and the
+             * work for each pass is done in parallel on those chunks.
+             *
+             * If this is called from a task running on the pool, all work
+             * is done on the calling thread, because waiting for other
+             * tasks on the same pool could deadlock.
+             *
+             * @tparam T Element type. Must be copy constructible and
+             *           trivially destructible.
+             * @param data Pointer to the first element.
+             * @param size Number of elements.
+             * @param key Function returning the key for an element.
+             * @param pool The thread pool to use.
+             */
+            template <typename T, typename TKeyFunc>
+            void radix_sort(T* data, const std::size_t size, TKeyFunc&& key, osmium::thread::Pool& pool) {
+                static_assert(std::is_trivially_destructible<T>::value, "radix_sort() only works on trivially destructible types");
+
+                using key_type = typename std::decay<decltype(key(*data))>::type;
+                static_assert(std::is_integral<key_type>::value, "radix_sort() needs an integral key");
+
+                constexpr const std::size_t num_bytes = sizeof(key_type);
+                using histogram = std::array<std::size_t, 256>;
+
+                if (size < 2) {
+                    return;
+                }
+
+                const std::size_t num_chunks = pool.is_worker_thread() ? 1 : std::min(static_cast<std::size_t>(pool.num_threads()), size);
+                const std::size_t chunk_size = (size + num_chunks - 1) / num_chunks;
+
+                const auto chunk_begin = [&](std::size_t n) {
+                    return std::min(n * chunk_size, size);
+                };
+                const auto chunk_end = [&](std::size_t n) {
+                    return std::min((n + 1) * chunk_size, size);
+                };
+                const auto digit = [&](const T& element, std::size_t byte) {
+                    return static_cast<std::size_t>((radix_sort_key(key(element)) >> (byte * 8U)) & 0xffU);
+                };
+
+                // Find out which bytes differ between keys. Only those
+                // need a pass.
+                std::vector<std::array<histogram, num_bytes>> all_counts(num_chunks);
+                run_chunks(pool, num_chunks, [&](std::size_t n) {
+                    auto& counts = all_counts[n];
+                    for (auto& c : counts) {
+                        c.fill(0);
+                    }
+                    for (std::size_t i = chunk_begin(n); i < chunk_end(n); ++i) {
+                        const auto k = radix_sort_key(key(data[i]));
+                        for (std::size_t byte = 0; byte < num_bytes; ++byte) {
+                            ++counts[byte][(k >> (byte * 8U)) & 0xffU];
+                        }
+                    }
+                });
+
+                std::vector<std::size_t> passes;
+                for (std::size_t byte = 0; byte < num_bytes; ++byte) {
+                    std::size_t first_count = 0;
+                    for (const auto& counts : all_counts) {
+                        first_count += counts[byte][digit(data[0], byte)];
+                    }
+                    if (first_count != size) {
+                        passes.push_back(byte);
+                    }
+                }
+
+                if (!passes.empty()) {
+                    using storage_type = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+                    std::unique_ptr<storage_type[]> buffer{new storage_type[size]};
+                    T* src = data;
+                    T* dst = reinterpret_cast<T*>(buffer.get());
+                    bool dst_constructed = false;
+
+                    std::vector<histogram> offsets(num_chunks);
+                    for (std::size_t p = 0; p < passes.size(); ++p) {
+                        const std::size_t byte = passes[p];
+
+                        // For the first pass we already have the counts,
+                        // for later passes the data has been moved around.
+                        if (p == 0) {
+                            for (std::size_t n = 0; n < num_chunks; ++n) {
+                                offsets[n] = all_counts[n][byte];
+                            }
+                        } else {
+                            run_chunks(pool, num_chunks, [&](std::size_t n) {
+                                auto& counts = offsets[n];
+                                counts.fill(0);
+                                for (std::size_t i = chunk_begin(n); i < chunk_end(n); ++i) {
+                                    ++counts[digit(src[i], byte)];
+                                }
+                            });
+                        }
+
+                        // Turn counts into start positions for each chunk
+                        // and digit, keeping the order of the chunks so
+                        // that the sort is stable.
+                        std::size_t sum = 0;
+                        for (std::size_t d = 0; d < 256; ++d) {
+                            for (auto& chunk_offsets : offsets) {
+                                const auto count = chunk_offsets[d];
+                                chunk_offsets[d] = sum;
+                                sum += count;
+                            }
+                        }
+
+                        run_chunks(pool, num_chunks, [&](std::size_t n) {
+                            auto& pos = offsets[n];
+                            for (std::size_t i = chunk_begin(n); i < chunk_end(n); ++i) {
+                                T* target = dst + pos[digit(src[i], byte)]++;
+                                if (dst_constructed) {
+                                    *target = src[i];
+                                } else {
+                                    new (target) T(src[i]);
+                                }
+                            }
+                        });
+
+                        if (dst != data) {
+                            dst_constructed = true;
+                        }
+                        std::swap(src, dst);
+                    }
+
+                    if (src != data) {
+                        run_chunks(pool, num_chunks, [&](std::size_t n) {
+                            std::copy(src + chunk_begin(n), src + chunk_end(n), data + chunk_begin(n));
+                        });
+                    }
+                }
+
+                // Sort runs of elements with the same key. The chunk
+                // boundaries are moved forward to the start of a run, so
+                // that each run is handled by exactly one chunk.
+                std::vector<std::size_t> starts(num_chunks + 1, size);
+                starts[0] = 0;
+                for (std::size_t n = 1; n < num_chunks; ++n) {
+                    std::size_t i = std::max(chunk_begin(n), starts[n - 1]);
+                    while (i > 0 && i < size && key(data[i]) == key(data[i - 1])) {
+                        ++i;
+                    }
+                    starts[n] = i;
+                }
+
+                run_chunks(pool, num_chunks, [&](std::size_t n) {
+                    const std::size_t end = starts[n + 1];
+                    std::size_t i = starts[n];
+                    while (i < end) {
+                        const auto current = key(data[i]);
+                        std::size_t j = i + 1;
+                        while (j < end && key(data[j]) == current) {
+                            ++j;
+                        }
+                        if (j - i > 1) {
+                            std::sort(data + i, data + j);
+                        }
+                        i = j;
+                    }
+                });
+            }
+
+            /**
+             * Sort the elements in data by key(element) and then by
+             * operator<. For large inputs this uses radix_sort() on the
+             * default thread pool, otherwise std::sort().
+             */
+            template <typename T, typename TKeyFunc>
+            void sort_by_key(T* data, const std::size_t size, TKeyFunc&& key) {
+                if (size < radix_sort_min_size) {
+                    std::sort(data, data + size);
+                    return;
+                }
+                radix_sort(data, size, std::forward<TKeyFunc>(key), osmium::thread::Pool::default_instance());
+            }
+
+            /**
+             * Sort the elements in the vector by key(element) and then by
+             * operator<. Only vectors in memory (std::vector or derived
+             * from it) are sorted with sort_by_key(). File and mmap based
+             * vectors can be much larger than the available memory, so
+             * they are sorted in place with std::sort() instead of using
+             * the temporary copy needed by radix_sort().
+             */
+            template <typename TVector, typename TKeyFunc>
+            void sort_vector_by_key(TVector& vector, TKeyFunc&& key) {
+                using value_type = typename TVector::value_type;
+                if (std::is_base_of<std::vector<value_type>, TVector>::value) {
+                    sort_by_key(vector.data(), vector.size(), std::forward<TKeyFunc>(key));
+                } else {
+                    std::sort(vector.begin(), vector.end());
+                }
+            }
+
+        } // namespace detail
+
+    } // namespace index
+
+} // namespace osmium
+
+#endif // OSMIUM_INDEX_DETAIL_RADIX_SORT_HPP
@@ -33,9 +33,11 @@ DEALINGS IN THE SOFTWARE.
 
 */
 
+#include <osmium/index/detail/radix_sort.hpp>
 #include <osmium/index/index.hpp>
 #include <osmium/index/map.hpp>
 #include <osmium/io/detail/read_write.hpp>
+#include <osmium/util/compatibility.hpp>
 
 #include <algorithm>
 #include <cstddef>
@@ -80,6 +82,10 @@ namespace osmium {
                     m_vector[id] = value;
                 }
 
+                bool supports_concurrent_set() const noexcept final {
+                    return true;
+                }
+
                 TValue get(const TId id) const final {
                     if (id >= m_vector.size()) {
                         throw osmium::not_found{id};
@@ -98,6 +104,17 @@ namespace osmium {
                     return m_vector[id];
                 }
 
+                void get_noexcept_batch(const TId* ids, const std::size_t count, TValue* values) const noexcept final {
+                    constexpr const std::size_t distance = Map<TId, TValue>::prefetch_distance;
+                    const std::size_t vector_size = m_vector.size();
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (i + distance < count && ids[i + distance] < vector_size) {
+                            OSMIUM_PREFETCH(&m_vector[ids[i + distance]]);
+                        }
+                        values[i] = ids[i] < vector_size ? m_vector[ids[i]] : osmium::index::empty_value<TValue>();
+                    }
+                }
+
                 std::size_t size() const final {
                     return m_vector.size();
                 }
@@ -220,7 +237,9 @@ namespace osmium {
                 }
 
                 void sort() final {
-                    std::sort(m_vector.begin(), m_vector.end());
+                    osmium::index::detail::sort_vector_by_key(m_vector, [](const element_type& element) {
+                        return element.first;
+                    });
                 }
 
                 void dump_as_array(const int fd) final {
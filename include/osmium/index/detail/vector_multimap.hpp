@@ -33,6 +33,7 @@ DEALINGS IN THE SOFTWARE.
 
 */
 
+#include <osmium/index/detail/radix_sort.hpp>
 #include <osmium/index/index.hpp>
 #include <osmium/index/multimap.hpp>
 #include <osmium/io/detail/read_write.hpp>
@@ -121,7 +122,9 @@ namespace osmium {
                 }
 
                 void sort() final {
-                    std::sort(m_vector.begin(), m_vector.end());
+                    osmium::index::detail::sort_vector_by_key(m_vector, [](const element_type& element) {
+                        return element.first;
+                    });
                 }
 
                 void remove(const TId id, const TValue value) {
@@ -135,7 +138,7 @@ namespace osmium {
                 }
 
                 void consolidate() {
-                    std::sort(m_vector.begin(), m_vector.end());
+                    sort();
                 }
 
                 void erase_removed() {
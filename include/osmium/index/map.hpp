@@ -100,6 +100,12 @@ namespace osmium {
 
             protected:
 
+                // How many IDs ahead of the current one implementations of
+                // get_noexcept_batch() should prefetch.
+                enum : std::size_t {
+                    prefetch_distance = 16
+                };
+
                 Map(Map&&) noexcept = default;
                 Map& operator=(Map&&) noexcept = default;
 
@@ -125,6 +131,20 @@ namespace osmium {
                 /// Set the field with id to value.
                 virtual void set(const TId id, const TValue value) = 0;
 
+                /**
+                 * Can set() be called from several threads at the same time
+                 * for different ids? This is only allowed for ids smaller
+                 * than an id that has already been set before from a single
+                 * thread, because the map must not grow while other threads
+                 * are writing to it. It is never allowed at the same time
+                 * as any other function of the map is called.
+                 *
+                 * Returns false in the default implementation.
+                 */
+                virtual bool supports_concurrent_set() const noexcept {
+                    return false;
+                }
+
                 /**
                  * Retrieve value by id.
                  *
@@ -145,6 +165,25 @@ namespace osmium {
                  */
                 virtual TValue get_noexcept(const TId id) const noexcept = 0;
 
+                /**
+                 * Retrieve values for several ids at once. This does the same
+                 * as calling get_noexcept() for each id, but some
+                 * implementations do it faster, for instance by prefetching
+                 * the memory for later ids.
+                 *
+                 * @param ids Pointer to the ids to look for.
+                 * @param count Number of ids.
+                 * @param values Pointer to the memory where the values will
+                 *               be written to. There must be space for
+                 *               count values. Ids that are not found get
+                 *               the empty value.
+                 */
+                virtual void get_noexcept_batch(const TId* ids, const std::size_t count, TValue* values) const noexcept {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        values[i] = get_noexcept(ids[i]);
+                    }
+                }
+
                 /**
                  * Get the approximate number of items in the storage. The storage
                  * might allocate memory in blocks, so this size might not be
@@ -0,0 +1,400 @@
+#ifndef OSMIUM_INDEX_MAP_COMPRESSED_MEM_HPP
+#define OSMIUM_INDEX_MAP_COMPRESSED_MEM_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/index/index.hpp>
+#include <osmium/index/map.hpp>
+#include <osmium/io/detail/read_write.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/util/compatibility.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define OSMIUM_HAS_INDEX_MAP_COMPRESSED_MEM
+
+namespace osmium {
+
+    namespace index {
+
+        namespace map {
+
+            /**
+             * An in-memory index for node locations that stores the
+             * locations in compressed form. It uses much less memory than
+             * the dense or sparse arrays for OSM data, because the locations
+             * of nodes with nearby IDs are usually close together.
+             *
+             * The ID space is divided into blocks of 64 IDs. Each block is
+             * encoded as a bitmap of the IDs in it that have a location
+             * followed by the coordinates of those locations, each as
+             * zigzag and varint encoded difference to the previous location
+             * in the block. A directory with the offset of each block allows
+             * finding a block in constant time, a lookup then needs to
+             * decode at most 64 locations.
+             *
+             * Locations should be set in order of increasing ID (as they
+             * are in sorted OSM files). Setting locations in any other order
+             * works, but a block that has been written already must then be
+             * decoded and written again, the old data for this block is not
+             * reused.
+             *
+             * This index only works for osmium::Location values.
+             */
+            template <typename TId, typename TValue>
+            class CompressedMem : public osmium::index::map::Map<TId, TValue> {
+
+                static_assert(std::is_same<TValue, osmium::Location>::value, "CompressedMem only works with osmium::Location values");
+
+                enum {
+                    bits = 6
+                };
+
+                enum : uint64_t {
+                    block_size = 1ULL << bits
+                };
+
+                // The encoded data is stored in chunks of this size, so
+                // that it never has to be copied when it grows.
+                enum {
+                    chunk_bits = 24
+                };
+
+                enum : uint64_t {
+                    chunk_size = 1ULL << chunk_bits
+                };
+
+                // Maximum size of an encoded block: The bitmap and two
+                // varints of at most 10 bytes for each location.
+                enum : std::size_t {
+                    max_encoded_block_size = sizeof(uint64_t) + block_size * 2 * 10
+                };
+
+                enum : uint64_t {
+                    no_block = std::numeric_limits<uint64_t>::max()
+                };
+
+                // Offset of each block in the encoded data or no_block.
+                std::vector<uint64_t> m_directory;
+
+                std::vector<std::vector<char>> m_chunks;
+
+                // Offset of the block that was written last.
+                uint64_t m_last_offset = no_block;
+
+                // The block that is currently being changed. It is kept
+                // in decoded form until a different block is needed.
+                uint64_t m_open_block = no_block;
+                uint64_t m_open_bitmap = 0;
+                std::array<TValue, block_size> m_open_values;
+
+                // The number of IDs with a location.
+                std::size_t m_size = 0;
+
+                static uint64_t block(const uint64_t id) noexcept {
+                    return id >> bits;
+                }
+
+                static uint64_t offset(const uint64_t id) noexcept {
+                    return id & (block_size - 1);
+                }
+
+                static char* append_varint(char* out, uint64_t value) noexcept {
+                    while (value >= 0x80U) {
+                        *out++ = static_cast<char>((value & 0x7fU) | 0x80U);
+                        value >>= 7U;
+                    }
+                    *out++ = static_cast<char>(value);
+                    return out;
+                }
+
+                static uint64_t decode_varint(const char** data) noexcept {
+                    uint64_t value = 0;
+                    unsigned int shift = 0;
+                    const auto* d = reinterpret_cast<const unsigned char*>(*data);
+                    while (*d & 0x80U) {
+                        value |= static_cast<uint64_t>(*d++ & 0x7fU) << shift;
+                        shift += 7;
+                    }
+                    value |= static_cast<uint64_t>(*d++) << shift;
+                    *data = reinterpret_cast<const char*>(d);
+                    return value;
+                }
+
+                static char* append_delta(char* out, const int64_t delta) noexcept {
+                    return append_varint(out, (static_cast<uint64_t>(delta) << 1U) ^ static_cast<uint64_t>(delta >> 63));
+                }
+
+                static int64_t decode_delta(const char** data) noexcept {
+                    const uint64_t value = decode_varint(data);
+                    return static_cast<int64_t>(value >> 1U) ^ -static_cast<int64_t>(value & 1U);
+                }
+
+                const char* block_data(const uint64_t block_offset) const noexcept {
+                    return m_chunks[block_offset >> chunk_bits].data() + (block_offset & (chunk_size - 1));
+                }
+
+                // Decode all locations in an encoded block.
+                static uint64_t decode_block(const char* data, std::array<TValue, block_size>& values) noexcept {
+                    uint64_t bitmap = 0;
+                    std::memcpy(&bitmap, data, sizeof(bitmap));
+                    data += sizeof(bitmap);
+
+                    int64_t x = 0;
+                    int64_t y = 0;
+                    for (std::size_t n = 0; n < block_size; ++n) {
+                        if (bitmap & (1ULL << n)) {
+                            x += decode_delta(&data);
+                            y += decode_delta(&data);
+                            values[n] = TValue{static_cast<int32_t>(x), static_cast<int32_t>(y)};
+                        }
+                    }
+
+                    return bitmap;
+                }
+
+                // Encode the open block and add it to the data.
+                void flush() {
+                    if (m_open_block == no_block) {
+                        return;
+                    }
+
+                    std::array<char, max_encoded_block_size> buffer;
+                    std::memcpy(buffer.data(), &m_open_bitmap, sizeof(m_open_bitmap));
+                    char* out = buffer.data() + sizeof(m_open_bitmap);
+
+                    int64_t x = 0;
+                    int64_t y = 0;
+                    for (std::size_t n = 0; n < block_size; ++n) {
+                        if (m_open_bitmap & (1ULL << n)) {
+                            out = append_delta(out, m_open_values[n].x() - x);
+                            out = append_delta(out, m_open_values[n].y() - y);
+                            x = m_open_values[n].x();
+                            y = m_open_values[n].y();
+                        }
+                    }
+
+                    const auto size = static_cast<std::size_t>(out - buffer.data());
+                    if (m_chunks.empty() || m_chunks.back().size() + size > chunk_size) {
+                        m_chunks.emplace_back();
+                        m_chunks.back().reserve(chunk_size);
+                    }
+
+                    if (m_directory.size() <= m_open_block) {
+                        m_directory.resize(m_open_block + 1, no_block);
+                    }
+                    m_last_offset = ((m_chunks.size() - 1) << chunk_bits) | m_chunks.back().size();
+                    m_directory[m_open_block] = m_last_offset;
+
+                    m_chunks.back().insert(m_chunks.back().end(), buffer.data(), out);
+                    m_open_block = no_block;
+                }
+
+                void open_block(const uint64_t num) {
+                    flush();
+
+                    m_open_block = num;
+                    m_open_bitmap = 0;
+
+                    if (num < m_directory.size() && m_directory[num] != no_block) {
+                        // This block was written before, so we have to
+                        // decode it to change it.
+                        m_open_bitmap = decode_block(block_data(m_directory[num]), m_open_values);
+                        if (m_directory[num] == m_last_offset) {
+                            m_chunks.back().resize(m_last_offset & (chunk_size - 1));
+                            m_last_offset = no_block;
+                        }
+                        m_directory[num] = no_block;
+                    }
+                }
+
+            public:
+
+                CompressedMem() = default;
+
+                std::size_t size() const noexcept final {
+                    return m_size;
+                }
+
+                std::size_t used_memory() const noexcept final {
+                    std::size_t data_size = 0;
+                    for (const auto& chunk : m_chunks) {
+                        data_size += chunk.size();
+                    }
+                    return sizeof(CompressedMem) +
+                           m_directory.capacity() * sizeof(uint64_t) +
+                           data_size;
+                }
+
+                void set(const TId id, const TValue value) final {
+                    if (block(id) != m_open_block) {
+                        open_block(block(id));
+                    }
+
+                    const uint64_t bit = 1ULL << offset(id);
+                    if (!(m_open_bitmap & bit)) {
+                        m_open_bitmap |= bit;
+                        ++m_size;
+                    }
+                    m_open_values[offset(id)] = value;
+                }
+
+                TValue get_noexcept(const TId id) const noexcept final {
+                    const uint64_t num = block(id);
+                    const uint64_t bit = 1ULL << offset(id);
+
+                    if (num == m_open_block) {
+                        if (m_open_bitmap & bit) {
+                            return m_open_values[offset(id)];
+                        }
+                        return osmium::index::empty_value<TValue>();
+                    }
+
+                    if (num >= m_directory.size() || m_directory[num] == no_block) {
+                        return osmium::index::empty_value<TValue>();
+                    }
+
+                    const char* data = block_data(m_directory[num]);
+                    uint64_t bitmap = 0;
+                    std::memcpy(&bitmap, data, sizeof(bitmap));
+                    if (!(bitmap & bit)) {
+                        return osmium::index::empty_value<TValue>();
+                    }
+                    data += sizeof(bitmap);
+
+                    // Decode the locations before the one we want (one for
+                    // each bit set below our bit) and then the one we want.
+                    int64_t x = 0;
+                    int64_t y = 0;
+                    for (uint64_t before = bitmap & (bit - 1); before != 0; before &= before - 1) {
+                        x += decode_delta(&data);
+                        y += decode_delta(&data);
+                    }
+                    x += decode_delta(&data);
+                    y += decode_delta(&data);
+
+                    return TValue{static_cast<int32_t>(x), static_cast<int32_t>(y)};
+                }
+
+                void get_noexcept_batch(const TId* ids, const std::size_t count, TValue* values) const noexcept final {
+                    // The directory entries are prefetched twice as far
+                    // ahead as the block data, because we need them to
+                    // find the block data.
+                    constexpr const std::size_t distance = osmium::index::map::Map<TId, TValue>::prefetch_distance;
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (i + 2 * distance < count && block(ids[i + 2 * distance]) < m_directory.size()) {
+                            OSMIUM_PREFETCH(&m_directory[block(ids[i + 2 * distance])]);
+                        }
+                        if (i + distance < count) {
+                            const uint64_t num = block(ids[i + distance]);
+                            if (num < m_directory.size() && m_directory[num] != no_block) {
+                                OSMIUM_PREFETCH(block_data(m_directory[num]));
+                            }
+                        }
+                        values[i] = get_noexcept(ids[i]);
+                    }
+                }
+
+                TValue get(const TId id) const final {
+                    const auto value = get_noexcept(id);
+                    if (value == osmium::index::empty_value<TValue>()) {
+                        throw osmium::not_found{id};
+                    }
+                    return value;
+                }
+
+                void clear() final {
+                    m_directory.clear();
+                    m_directory.shrink_to_fit();
+                    m_chunks.clear();
+                    m_chunks.shrink_to_fit();
+                    m_last_offset = no_block;
+                    m_open_block = no_block;
+                    m_open_bitmap = 0;
+                    m_size = 0;
+                }
+
+                /**
+                 * Encode the block that is currently being changed. This is
+                 * not needed for lookups, but makes them a bit faster.
+                 */
+                void sort() final {
+                    flush();
+                }
+
+                void dump_as_list(const int fd) final {
+                    flush();
+
+                    using element_type = std::pair<TId, TValue>;
+                    std::vector<element_type> elements;
+                    elements.reserve(chunk_size / sizeof(element_type));
+
+                    std::array<TValue, block_size> values;
+                    for (uint64_t num = 0; num < m_directory.size(); ++num) {
+                        if (m_directory[num] == no_block) {
+                            continue;
+                        }
+                        const uint64_t bitmap = decode_block(block_data(m_directory[num]), values);
+                        for (std::size_t n = 0; n < block_size; ++n) {
+                            if (bitmap & (1ULL << n)) {
+                                elements.emplace_back(static_cast<TId>((num << bits) | n), values[n]);
+                            }
+                        }
+                        if (elements.size() + block_size > elements.capacity()) {
+                            osmium::io::detail::reliable_write(fd, reinterpret_cast<const char*>(elements.data()), sizeof(element_type) * elements.size());
+                            elements.clear();
+                        }
+                    }
+                    osmium::io::detail::reliable_write(fd, reinterpret_cast<const char*>(elements.data()), sizeof(element_type) * elements.size());
+                }
+
+            }; // class CompressedMem
+
+        } // namespace map
+
+    } // namespace index
+
+} // namespace osmium
+
+#ifdef OSMIUM_WANT_NODE_LOCATION_MAPS
+    REGISTER_MAP(osmium::unsigned_object_id_type, osmium::Location, osmium::index::map::CompressedMem, compressed_mem)
+#endif
+
+#endif // OSMIUM_INDEX_MAP_COMPRESSED_MEM_HPP
@@ -60,6 +60,10 @@ namespace osmium {
                     // intentionally left blank
                 }
 
+                bool supports_concurrent_set() const noexcept final {
+                    return true;
+                }
+
                 TValue get(const TId id) const final {
                     throw osmium::not_found{id};
                 }
@@ -33,8 +33,10 @@ DEALINGS IN THE SOFTWARE.
 
 */
 
+#include <osmium/index/detail/radix_sort.hpp>
 #include <osmium/index/index.hpp>
 #include <osmium/index/map.hpp>
+#include <osmium/util/compatibility.hpp>
 
 #include <algorithm>
 #include <cstddef>
@@ -211,6 +213,26 @@ namespace osmium {
                     return get_sparse(id);
                 }
 
+                void get_noexcept_batch(const TId* ids, const std::size_t count, TValue* values) const noexcept final {
+                    if (!m_dense) {
+                        for (std::size_t i = 0; i < count; ++i) {
+                            values[i] = get_sparse(ids[i]);
+                        }
+                        return;
+                    }
+
+                    constexpr const std::size_t distance = osmium::index::map::Map<TId, TValue>::prefetch_distance;
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (i + distance < count) {
+                            const uint64_t id = ids[i + distance];
+                            if (block(id) < m_dense_blocks.size() && !m_dense_blocks[block(id)].empty()) {
+                                OSMIUM_PREFETCH(&m_dense_blocks[block(id)][offset(id)]);
+                            }
+                        }
+                        values[i] = get_dense(ids[i]);
+                    }
+                }
+
                 TValue get(const TId id) const final {
                     const auto value = get_noexcept(id);
                     if (value == osmium::index::empty_value<TValue>()) {
@@ -229,7 +251,9 @@ namespace osmium {
                 }
 
                 void sort() final {
-                    std::sort(m_sparse_entries.begin(), m_sparse_entries.end());
+                    osmium::index::detail::sort_by_key(m_sparse_entries.data(), m_sparse_entries.size(), [](const entry& e) {
+                        return e.id;
+                    });
                 }
 
                 /**
@@ -47,16 +47,23 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/error.hpp>
 #include <osmium/io/file_compression.hpp>
 #include <osmium/io/writer_options.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/util/config.hpp>
 #include <osmium/util/file.hpp>
 
 #include <bzlib.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
+#include <cstddef>
 #include <cstdio>
+#include <deque>
+#include <future>
 #include <limits>
 #include <string>
 #include <system_error>
+#include <utility>
 
 #ifndef _MSC_VER
 # include <unistd.h>
@@ -394,13 +401,333 @@ namespace osmium {
 
         }; // class Bzip2BufferDecompressor
 
+        namespace detail {
+
+            /**
+             * Incremental bzip2 decoder working on data in memory. Input
+             * can be given in pieces of any size. Several concatenated
+             * bzip2 streams are decoded one after the other.
+             */
+            class bzip2_stream_decoder {
+
+                bz_stream m_bzstream{};
+                bool m_in_stream = false;
+
+                void init() {
+                    m_bzstream = bz_stream{};
+                    const int result = BZ2_bzDecompressInit(&m_bzstream, 0, 0);
+                    if (result != BZ_OK) {
+                        throw bzip2_error{"bzip2 error: decompression init failed", result};
+                    }
+                    m_in_stream = true;
+                }
+
+                void end() noexcept {
+                    if (m_in_stream) {
+                        BZ2_bzDecompressEnd(&m_bzstream);
+                        m_in_stream = false;
+                    }
+                }
+
+            public:
+
+                bzip2_stream_decoder() noexcept = default;
+
+                bzip2_stream_decoder(const bzip2_stream_decoder&) = delete;
+                bzip2_stream_decoder& operator=(const bzip2_stream_decoder&) = delete;
+
+                bzip2_stream_decoder(bzip2_stream_decoder&&) = delete;
+                bzip2_stream_decoder& operator=(bzip2_stream_decoder&&) = delete;
+
+                ~bzip2_stream_decoder() noexcept {
+                    end();
+                }
+
+                /**
+                 * Decode the input and append the decoded data to the
+                 * output.
+                 *
+                 * @throws bzip2_error If the data is corrupt.
+                 */
+                void decode(const char* data, std::size_t size, std::string& output) {
+                    while (size > 0) {
+                        if (!m_in_stream) {
+                            init();
+                        }
+
+                        const auto chunk = std::min(size, static_cast<std::size_t>(std::numeric_limits<unsigned int>::max()));
+                        m_bzstream.next_in = const_cast<char*>(data);
+                        m_bzstream.avail_in = static_cast<unsigned int>(chunk);
+
+                        int result = BZ_OK;
+                        do {
+                            const auto old_size = output.size();
+                            const std::size_t grow_by = std::min(std::max(static_cast<std::size_t>(Decompressor::input_buffer_size), chunk * 4),
+                                                                 static_cast<std::size_t>(std::numeric_limits<unsigned int>::max()));
+                            output.resize(old_size + grow_by);
+                            m_bzstream.next_out = &output[old_size];
+                            m_bzstream.avail_out = static_cast<unsigned int>(grow_by);
+                            result = BZ2_bzDecompress(&m_bzstream);
+                            output.resize(old_size + grow_by - m_bzstream.avail_out);
+                            if (result != BZ_OK && result != BZ_STREAM_END) {
+                                end();
+                                throw bzip2_error{"bzip2 error: decompress failed", result};
+                            }
+                        } while (result == BZ_OK && (m_bzstream.avail_in > 0 || m_bzstream.avail_out == 0));
+
+                        const auto used = chunk - m_bzstream.avail_in;
+                        data += used;
+                        size -= used;
+
+                        if (result == BZ_STREAM_END) {
+                            // Another stream might follow.
+                            end();
+                        }
+                    }
+                }
+
+                /**
+                 * Call this after all input has been given to decode().
+                 *
+                 * @throws bzip2_error If the input ended in the middle of
+                 *                     a stream.
+                 */
+                void finish() {
+                    if (m_in_stream) {
+                        end();
+                        throw bzip2_error{"bzip2 error: unexpected end of data", BZ_UNEXPECTED_EOF};
+                    }
+                }
+
+            }; // class bzip2_stream_decoder
+
+            /**
+             * Find the start of the last bzip2 stream in the data that
+             * starts after the beginning of the data. Looks for the stream
+             * header ("BZh" and the block size) followed by the magic
+             * number of a block or of the end of the stream. Returns 0 if
+             * there is no such stream.
+             */
+            inline std::size_t find_last_bzip2_stream_start(const std::string& data) noexcept {
+                static const char block_magic[] = "\x31\x41\x59\x26\x53\x59";
+                static const char eos_magic[] = "\x17\x72\x45\x38\x50\x90";
+                constexpr const std::size_t header_size = 4 + 6;
+
+                if (data.size() < header_size + 1) {
+                    return 0;
+                }
+
+                auto pos = data.size() - header_size;
+                while (pos > 0) {
+                    pos = data.rfind("BZh", pos);
+                    if (pos == std::string::npos || pos == 0) {
+                        return 0;
+                    }
+                    if (data[pos + 3] >= '1' && data[pos + 3] <= '9' &&
+                        (!data.compare(pos + 4, 6, block_magic, 6) ||
+                         !data.compare(pos + 4, 6, eos_magic, 6))) {
+                        return pos;
+                    }
+                    --pos;
+                }
+
+                return 0;
+            }
+
+            /// Task decoding one chunk of complete bzip2 streams.
+            class bzip2_decode_chunk {
+
+                std::string m_data;
+
+            public:
+
+                explicit bzip2_decode_chunk(std::string&& data) :
+                    m_data(std::move(data)) {
+                }
+
+                std::string operator()() const {
+                    std::string output;
+                    bzip2_stream_decoder decoder;
+                    decoder.decode(m_data.data(), m_data.size(), output);
+                    decoder.finish();
+                    return output;
+                }
+
+            }; // class bzip2_decode_chunk
+
+        } // namespace detail
+
+        /**
+         * Decompressor for bzip2 files consisting of many concatenated
+         * streams as created by parallel bzip2 compressors such as pbzip2
+         * or lbzip2. The compressed data is cut at stream boundaries and
+         * the pieces are decompressed in parallel on the thread pool. The
+         * decompressed data is returned in the original order.
+         *
+         * Stream boundaries are found by searching for the stream
+         * header. If no boundary is found in the first
+         * max_chunks_without_boundary chunks of input (which is the case
+         * for files written by plain bzip2 with only one stream), the
+         * rest of the file is decompressed sequentially.
+         *
+         * This is used instead of the Bzip2Decompressor when reading
+         * files if the environment variable OSMIUM_USE_PARALLEL_BZIP2 is
+         * set to true.
+         */
+        class Bzip2ParallelDecompressor : public Decompressor {
+
+            enum : std::size_t {
+                chunk_size = Decompressor::input_buffer_size,
+                max_chunks_without_boundary = 32
+            };
+
+            int m_fd;
+            osmium::thread::Pool& m_pool;
+            std::string m_input{};
+            std::deque<std::future<std::string>> m_results{};
+            detail::bzip2_stream_decoder m_sequential_decoder{};
+            std::size_t m_offset = 0;
+            bool m_eof = false;
+            bool m_sequential = false;
+
+            std::size_t max_pending() const noexcept {
+                return 2 * static_cast<std::size_t>(m_pool.num_threads());
+            }
+
+            std::string read_input() {
+                std::string data;
+                data.resize(chunk_size);
+                const auto nread = osmium::io::detail::reliable_read(m_fd, &*data.begin(), chunk_size);
+                data.resize(static_cast<std::string::size_type>(nread));
+                m_offset += data.size();
+                set_offset(m_offset);
+                return data;
+            }
+
+            void submit(std::string&& data) {
+                m_results.push_back(m_pool.submit(detail::bzip2_decode_chunk{std::move(data)}));
+            }
+
+            void fill_and_split() {
+                std::string data{read_input()};
+                if (data.empty()) {
+                    m_eof = true;
+                    if (m_offset == 0) {
+                        throw bzip2_error{"bzip2 error: read failed: unexpected end of file", BZ_UNEXPECTED_EOF};
+                    }
+                    if (!m_input.empty()) {
+                        submit(std::move(m_input));
+                        m_input.clear();
+                    }
+                    return;
+                }
+
+                m_input += data;
+                if (m_input.size() < chunk_size) {
+                    return;
+                }
+
+                const auto pos = detail::find_last_bzip2_stream_start(m_input);
+                if (pos == 0) {
+                    if (m_input.size() >= chunk_size * max_chunks_without_boundary) {
+                        m_sequential = true;
+                    }
+                    return;
+                }
+
+                submit(m_input.substr(0, pos));
+                m_input.erase(0, pos);
+            }
+
+        public:
+
+            Bzip2ParallelDecompressor(const int fd, osmium::thread::Pool& pool) :
+                m_fd(fd),
+                m_pool(pool) {
+            }
+
+            explicit Bzip2ParallelDecompressor(const int fd) :
+                Bzip2ParallelDecompressor(fd, osmium::thread::Pool::default_instance()) {
+            }
+
+            Bzip2ParallelDecompressor(const Bzip2ParallelDecompressor&) = delete;
+            Bzip2ParallelDecompressor& operator=(const Bzip2ParallelDecompressor&) = delete;
+
+            Bzip2ParallelDecompressor(Bzip2ParallelDecompressor&&) = delete;
+            Bzip2ParallelDecompressor& operator=(Bzip2ParallelDecompressor&&) = delete;
+
+            ~Bzip2ParallelDecompressor() noexcept final {
+                try {
+                    close();
+                } catch (...) {
+                    // Ignore any exceptions because destructor must not throw.
+                }
+            }
+
+            std::string read() final {
+                while (true) {
+                    // Results are returned in order. Before waiting for the
+                    // first one we queue up enough work for all threads.
+                    if (!m_results.empty() && (m_eof || m_sequential || m_results.size() >= max_pending())) {
+                        std::string output{m_results.front().get()};
+                        m_results.pop_front();
+                        if (!output.empty()) {
+                            return output;
+                        }
+                        continue;
+                    }
+
+                    if (m_eof) {
+                        m_sequential_decoder.finish();
+                        return std::string{};
+                    }
+
+                    if (m_sequential) {
+                        std::string data;
+                        if (m_input.empty()) {
+                            data = read_input();
+                            if (data.empty()) {
+                                m_eof = true;
+                                continue;
+                            }
+                        } else {
+                            data.swap(m_input);
+                        }
+                        std::string output;
+                        m_sequential_decoder.decode(data.data(), data.size(), output);
+                        if (!output.empty()) {
+                            return output;
+                        }
+                        continue;
+                    }
+
+                    fill_and_split();
+                }
+            }
+
+            void close() final {
+                m_results.clear();
+                if (m_fd >= 0) {
+                    const int fd = m_fd;
+                    m_fd = -1;
+                    osmium::io::detail::reliable_close(fd);
+                }
+            }
+
+        }; // class Bzip2ParallelDecompressor
+
         namespace detail {
 
             // we want the register_compression() function to run, setting
             // the variable is only a side-effect, it will never be used
             const bool registered_bzip2_compression = osmium::io::CompressionFactory::instance().register_compression(osmium::io::file_compression::bzip2,
                 [](const int fd, const fsync sync) { return new osmium::io::Bzip2Compressor{fd, sync}; },
-                [](const int fd) { return new osmium::io::Bzip2Decompressor{fd}; },
+                [](const int fd) -> osmium::io::Decompressor* {
+                    if (osmium::config::use_parallel_bzip2()) {
+                        return new osmium::io::Bzip2ParallelDecompressor{fd};
+                    }
+                    return new osmium::io::Bzip2Decompressor{fd};
+                },
                 [](const char* buffer, const std::size_t size) { return new osmium::io::Bzip2BufferDecompressor{buffer, size}; }
             );
 
@@ -0,0 +1,407 @@
+#ifndef OSMIUM_IO_DETAIL_COLUMNAR_OUTPUT_FORMAT_HPP
+#define OSMIUM_IO_DETAIL_COLUMNAR_OUTPUT_FORMAT_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/io/detail/output_format.hpp>
+#include <osmium/io/detail/queue_util.hpp>
+#include <osmium/io/error.hpp>
+#include <osmium/io/file.hpp>
+#include <osmium/io/file_format.hpp>
+#include <osmium/io/header.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/item_type.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/object.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/tag.hpp>
+#include <osmium/osm/timestamp.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/visitor.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace io {
+
+        /**
+         * @brief Columnar output format.
+         *
+         * The columnar format stores OSM objects as typed columns that can
+         * be memory mapped and used directly by analytical tools. All
+         * numbers are stored in the byte order of the machine that wrote
+         * the file, the byte order mark in the file header can be used to
+         * detect it.
+         *
+         * The file starts with a file header of 16 bytes:
+         *
+         * - 8 bytes magic "OSMCOLUM"
+         * - uint32_t byte order mark 0x01020304
+         * - uint32_t version of the layout (currently 1)
+         *
+         * This is followed by any number of blocks, one for each buffer
+         * written. Each block starts with a block header:
+         *
+         * - uint64_t size of the block in bytes (including this header)
+         * - uint64_t number of nodes, ways, and relations (3 values)
+         * - the column directory: for each column in the order given by
+         *   the columnar_column enum two uint64_t values, the offset of
+         *   the column from the start of the block and its size in bytes.
+         *
+         * The column data follows the block header, every column starts
+         * at an offset divisible by 8. The block size is also divisible
+         * by 8, so the next block starts directly after it.
+         *
+         * The columns for each object type (with n objects) are:
+         *
+         * - id (int64_t[n])
+         * - version, timestamp (seconds since the epoch), uid, and
+         *   changeset (uint32_t[n])
+         * - tag_index (uint32_t[n+1]): the tags of object i are the tags
+         *   tag_index[i] to tag_index[i+1] (exclusive).
+         * - key_offsets and value_offsets (uint32_t[t+1] for t tags) and
+         *   key_data and value_data (char): key j is stored in key_data
+         *   from key_offsets[j] to key_offsets[j+1] (exclusive), same for
+         *   the values. The strings are not null-terminated.
+         *
+         * Nodes additionally have lon and lat columns (int32_t[n]) with
+         * the coordinates in the fixed-point format of osmium::Location
+         * (degrees times 10^7).
+         *
+         * Ways additionally have a node_index (uint32_t[n+1]) and node_refs
+         * (int64_t) column. The node refs of way i are stored in node_refs
+         * from node_index[i] to node_index[i+1] (exclusive).
+         *
+         * Relations additionally have a member_index (uint32_t[n+1]),
+         * member_types (uint8_t, 1 = node, 2 = way, 3 = relation),
+         * member_refs (int64_t), and role_offsets (uint32_t) and role_data
+         * (char) columns. The members are indexed like the way nodes, the
+         * roles are stored like the tag keys.
+         *
+         * Deleted objects, changesets and areas are not written.
+         */
+        enum class columnar_column : std::size_t {
+            node_id = 0,
+            node_version,
+            node_timestamp,
+            node_uid,
+            node_changeset,
+            node_tag_index,
+            node_key_offsets,
+            node_key_data,
+            node_value_offsets,
+            node_value_data,
+            node_lon,
+            node_lat,
+            way_id,
+            way_version,
+            way_timestamp,
+            way_uid,
+            way_changeset,
+            way_tag_index,
+            way_key_offsets,
+            way_key_data,
+            way_value_offsets,
+            way_value_data,
+            way_node_index,
+            way_node_refs,
+            relation_id,
+            relation_version,
+            relation_timestamp,
+            relation_uid,
+            relation_changeset,
+            relation_tag_index,
+            relation_key_offsets,
+            relation_key_data,
+            relation_value_offsets,
+            relation_value_data,
+            relation_member_index,
+            relation_member_types,
+            relation_member_refs,
+            relation_role_offsets,
+            relation_role_data,
+            number_of_columns
+        };
+
+        namespace detail {
+
+            constexpr const char columnar_magic[] = "OSMCOLUM";
+
+            enum : uint32_t {
+                columnar_byte_order_mark = 0x01020304U,
+                columnar_layout_version = 1U
+            };
+
+            enum : std::size_t {
+                columnar_file_header_size = 16,
+                columnar_block_header_size = (1 + 3 + 2 * static_cast<std::size_t>(columnar_column::number_of_columns)) * sizeof(uint64_t)
+            };
+
+            inline uint32_t columnar_index(const std::size_t value) {
+                if (value > std::numeric_limits<uint32_t>::max()) {
+                    throw osmium::io_error{"columnar output: too much data in one buffer"};
+                }
+                return static_cast<uint32_t>(value);
+            }
+
+            // Variable length strings stored as offsets and data.
+            class ColumnarStrings {
+
+                std::vector<uint32_t> m_offsets{0};
+                std::string m_data;
+
+            public:
+
+                void add(const char* str) {
+                    m_data.append(str);
+                    m_offsets.push_back(columnar_index(m_data.size()));
+                }
+
+                const std::vector<uint32_t>& offsets() const noexcept {
+                    return m_offsets;
+                }
+
+                const std::string& data() const noexcept {
+                    return m_data;
+                }
+
+            }; // class ColumnarStrings
+
+            // The columns all object types have in common.
+            struct ColumnarObjects {
+
+                std::vector<osmium::object_id_type> ids;
+                std::vector<osmium::object_version_type> versions;
+                std::vector<uint32_t> timestamps;
+                std::vector<osmium::user_id_type> uids;
+                std::vector<osmium::changeset_id_type> changesets;
+                std::vector<uint32_t> tag_index{0};
+                ColumnarStrings keys;
+                ColumnarStrings values;
+
+                void add(const osmium::OSMObject& object) {
+                    ids.push_back(object.id());
+                    versions.push_back(object.version());
+                    timestamps.push_back(static_cast<uint32_t>(object.timestamp()));
+                    uids.push_back(object.uid());
+                    changesets.push_back(object.changeset());
+                    for (const auto& tag : object.tags()) {
+                        keys.add(tag.key());
+                        values.add(tag.value());
+                    }
+                    tag_index.push_back(columnar_index(keys.offsets().size() - 1));
+                }
+
+            }; // struct ColumnarObjects
+
+            /**
+             * Writes out one buffer with OSM data as a block in the columnar
+             * format. See osmium::io::columnar_column for a description.
+             */
+            class ColumnarOutputBlock : public OutputBlock {
+
+                ColumnarObjects m_nodes;
+                std::vector<int32_t> m_node_lons;
+                std::vector<int32_t> m_node_lats;
+
+                ColumnarObjects m_ways;
+                std::vector<uint32_t> m_way_node_index{0};
+                std::vector<int64_t> m_way_node_refs;
+
+                ColumnarObjects m_relations;
+                std::vector<uint32_t> m_member_index{0};
+                std::vector<uint8_t> m_member_types;
+                std::vector<int64_t> m_member_refs;
+                ColumnarStrings m_roles;
+
+                void set_uint64(const std::size_t offset, const uint64_t value) {
+                    std::memcpy(&(*m_out)[offset], &value, sizeof(uint64_t));
+                }
+
+                void add_column(const columnar_column column, const char* data, const std::size_t size) {
+                    const std::size_t offset = m_out->size();
+                    const std::size_t entry = (4 + 2 * static_cast<std::size_t>(column)) * sizeof(uint64_t);
+                    set_uint64(entry, offset);
+                    set_uint64(entry + sizeof(uint64_t), size);
+
+                    m_out->append(data, size);
+                    m_out->append((8 - size % 8) % 8, '\0');
+                }
+
+                template <typename T>
+                void add_column(const columnar_column column, const std::vector<T>& data) {
+                    add_column(column, reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T));
+                }
+
+                static columnar_column column_after(const columnar_column column, const std::size_t n) noexcept {
+                    return static_cast<columnar_column>(static_cast<std::size_t>(column) + n);
+                }
+
+                // Add the columns all object types have in common. They
+                // are in the same order for all types starting at the id.
+                void add_columns(const columnar_column id_column, const ColumnarObjects& objects) {
+                    add_column(id_column, objects.ids);
+                    add_column(column_after(id_column, 1), objects.versions);
+                    add_column(column_after(id_column, 2), objects.timestamps);
+                    add_column(column_after(id_column, 3), objects.uids);
+                    add_column(column_after(id_column, 4), objects.changesets);
+                    add_column(column_after(id_column, 5), objects.tag_index);
+                    add_column(column_after(id_column, 6), objects.keys.offsets());
+                    add_column(column_after(id_column, 7), objects.keys.data().data(), objects.keys.data().size());
+                    add_column(column_after(id_column, 8), objects.values.offsets());
+                    add_column(column_after(id_column, 9), objects.values.data().data(), objects.values.data().size());
+                }
+
+            public:
+
+                explicit ColumnarOutputBlock(osmium::memory::Buffer&& buffer) :
+                    OutputBlock(std::move(buffer)) {
+                }
+
+                std::string operator()() {
+                    osmium::apply(m_input_buffer->cbegin(), m_input_buffer->cend(), *this);
+
+                    m_out->assign(columnar_block_header_size, '\0');
+                    set_uint64(1 * sizeof(uint64_t), m_nodes.ids.size());
+                    set_uint64(2 * sizeof(uint64_t), m_ways.ids.size());
+                    set_uint64(3 * sizeof(uint64_t), m_relations.ids.size());
+
+                    add_columns(columnar_column::node_id, m_nodes);
+                    add_column(columnar_column::node_lon, m_node_lons);
+                    add_column(columnar_column::node_lat, m_node_lats);
+
+                    add_columns(columnar_column::way_id, m_ways);
+                    add_column(columnar_column::way_node_index, m_way_node_index);
+                    add_column(columnar_column::way_node_refs, m_way_node_refs);
+
+                    add_columns(columnar_column::relation_id, m_relations);
+                    add_column(columnar_column::relation_member_index, m_member_index);
+                    add_column(columnar_column::relation_member_types, m_member_types);
+                    add_column(columnar_column::relation_member_refs, m_member_refs);
+                    add_column(columnar_column::relation_role_offsets, m_roles.offsets());
+                    add_column(columnar_column::relation_role_data, m_roles.data().data(), m_roles.data().size());
+
+                    set_uint64(0, m_out->size());
+
+                    std::string out;
+                    using std::swap;
+                    swap(out, *m_out);
+
+                    return out;
+                }
+
+                void node(const osmium::Node& node) {
+                    if (!node.visible()) {
+                        return;
+                    }
+                    m_nodes.add(node);
+                    m_node_lons.push_back(node.location().x());
+                    m_node_lats.push_back(node.location().y());
+                }
+
+                void way(const osmium::Way& way) {
+                    if (!way.visible()) {
+                        return;
+                    }
+                    m_ways.add(way);
+                    for (const auto& node_ref : way.nodes()) {
+                        m_way_node_refs.push_back(node_ref.ref());
+                    }
+                    m_way_node_index.push_back(columnar_index(m_way_node_refs.size()));
+                }
+
+                void relation(const osmium::Relation& relation) {
+                    if (!relation.visible()) {
+                        return;
+                    }
+                    m_relations.add(relation);
+                    for (const auto& member : relation.members()) {
+                        m_member_types.push_back(static_cast<uint8_t>(member.type()));
+                        m_member_refs.push_back(member.ref());
+                        m_roles.add(member.role());
+                    }
+                    m_member_index.push_back(columnar_index(m_member_refs.size()));
+                }
+
+            }; // class ColumnarOutputBlock
+
+            class ColumnarOutputFormat : public osmium::io::detail::OutputFormat {
+
+            public:
+
+                ColumnarOutputFormat(osmium::thread::Pool& pool, const osmium::io::File& /*file*/, future_string_queue_type& output_queue) :
+                    OutputFormat(pool, output_queue) {
+                }
+
+                void write_header(const osmium::io::Header& /*header*/) final {
+                    std::string out{columnar_magic, sizeof(columnar_magic) - 1};
+                    const std::array<uint32_t, 2> values{{columnar_byte_order_mark, columnar_layout_version}};
+                    out.append(reinterpret_cast<const char*>(values.data()), sizeof(values));
+                    send_to_output_queue(std::move(out));
+                }
+
+                void write_buffer(osmium::memory::Buffer&& buffer) final {
+                    m_output_queue.push(m_pool.submit(ColumnarOutputBlock{std::move(buffer)}));
+                }
+
+            }; // class ColumnarOutputFormat
+
+            // we want the register_output_format() function to run, setting
+            // the variable is only a side-effect, it will never be used
+            const bool registered_columnar_output = osmium::io::detail::OutputFormatFactory::instance().register_output_format(osmium::io::file_format::columnar,
+                [](osmium::thread::Pool& pool, const osmium::io::File& file, future_string_queue_type& output_queue) {
+                    return new osmium::io::detail::ColumnarOutputFormat(pool, file, output_queue);
+            });
+
+            // dummy function to silence the unused variable warning from above
+            inline bool get_registered_columnar_output() noexcept {
+                return registered_columnar_output;
+            }
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_COLUMNAR_OUTPUT_FORMAT_HPP
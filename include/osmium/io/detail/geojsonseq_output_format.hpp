@@ -0,0 +1,230 @@
+#ifndef OSMIUM_IO_DETAIL_GEOJSONSEQ_OUTPUT_FORMAT_HPP
+#define OSMIUM_IO_DETAIL_GEOJSONSEQ_OUTPUT_FORMAT_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/geom/factory.hpp>
+#include <osmium/geom/geojson.hpp>
+#include <osmium/io/detail/output_format.hpp>
+#include <osmium/io/detail/queue_util.hpp>
+#include <osmium/io/detail/string_util.hpp>
+#include <osmium/io/file.hpp>
+#include <osmium/io/file_format.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/area.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/object.hpp>
+#include <osmium/osm/tag.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/visitor.hpp>
+
+#include <string>
+#include <utility>
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            struct geojsonseq_output_options {
+
+                /// Start each feature with the record separator (RFC 8142)?
+                bool print_record_separator = true;
+
+            }; // struct geojsonseq_output_options
+
+            /**
+             * Writes out one buffer with OSM data as a GeoJSON text sequence
+             * with one feature per line.
+             *
+             * Nodes are written as Points, ways as LineStrings, and areas
+             * from relations as MultiPolygons. Closed ways which the area
+             * assembler would turn into an area (at least four nodes, first
+             * and last node are the same, not tagged area=no) are written
+             * as Polygons instead of LineStrings. Areas created from ways are
+             * not written, so there is only one feature per way, whether the
+             * data went through the area assembler or not. Ways need node
+             * locations for this, so they must either come from a file with
+             * locations on ways or have been through a location handler.
+             * Nodes and ways without tags are not written, they are usually
+             * only there as parts of ways and relations. Deleted objects,
+             * relations, changesets, and all objects whose geometry can not
+             * be created are not written either.
+             */
+            class GeoJSONSeqOutputBlock : public OutputBlock {
+
+                geojsonseq_output_options m_options;
+
+                osmium::geom::GeoJSONFactory<> m_factory{};
+
+                void write_feature(const char type, const osmium::object_id_type id, const std::string& geometry, const osmium::TagList& tags) {
+                    if (m_options.print_record_separator) {
+                        *m_out += '\x1e';
+                    }
+                    *m_out += "{\"type\":\"Feature\",\"id\":\"";
+                    *m_out += type;
+                    output_int(id);
+                    *m_out += "\",\"geometry\":";
+                    *m_out += geometry;
+                    *m_out += ",\"properties\":{";
+                    bool first = true;
+                    for (const auto& tag : tags) {
+                        if (first) {
+                            first = false;
+                        } else {
+                            *m_out += ',';
+                        }
+                        *m_out += '"';
+                        append_json_encoded_string(*m_out, tag.key());
+                        *m_out += "\":\"";
+                        append_json_encoded_string(*m_out, tag.value());
+                        *m_out += '"';
+                    }
+                    *m_out += "}}\n";
+                }
+
+            public:
+
+                GeoJSONSeqOutputBlock(osmium::memory::Buffer&& buffer, const geojsonseq_output_options& options) :
+                    OutputBlock(std::move(buffer)),
+                    m_options(options) {
+                }
+
+                std::string operator()() {
+                    osmium::apply(m_input_buffer->cbegin(), m_input_buffer->cend(), *this);
+
+                    std::string out;
+                    using std::swap;
+                    swap(out, *m_out);
+
+                    return out;
+                }
+
+                void node(const osmium::Node& node) {
+                    if (!node.visible() || node.tags().empty()) {
+                        return;
+                    }
+                    try {
+                        write_feature('n', node.id(), m_factory.create_point(node), node.tags());
+                    } catch (const osmium::invalid_location&) {
+                        // ignore nodes without valid location
+                    }
+                }
+
+                static bool is_area(const osmium::Way& way) {
+                    return way.nodes().size() > 3 &&
+                           way.ends_have_same_id() &&
+                           !way.tags().has_tag("area", "no");
+                }
+
+                void way(const osmium::Way& way) {
+                    if (!way.visible() || way.tags().empty()) {
+                        return;
+                    }
+                    if (is_area(way)) {
+                        try {
+                            write_feature('w', way.id(), m_factory.create_polygon(way), way.tags());
+                            return;
+                        } catch (const osmium::geometry_error&) {
+                            // not enough different locations for a polygon,
+                            // try as linestring
+                        } catch (const osmium::invalid_location&) {
+                            // ignore ways with missing locations
+                            return;
+                        }
+                    }
+                    try {
+                        write_feature('w', way.id(), m_factory.create_linestring(way), way.tags());
+                    } catch (const osmium::geometry_error&) {
+                        // ignore ways with less than two different locations
+                    } catch (const osmium::invalid_location&) {
+                        // ignore ways with missing locations
+                    }
+                }
+
+                void area(const osmium::Area& area) {
+                    // Areas from ways have already been written as Polygons
+                    // when the way was written.
+                    if (!area.visible() || area.from_way()) {
+                        return;
+                    }
+                    try {
+                        write_feature('r', area.orig_id(), m_factory.create_multipolygon(area), area.tags());
+                    } catch (const osmium::geometry_error&) {
+                        // ignore invalid areas
+                    } catch (const osmium::invalid_location&) {
+                        // ignore areas with missing locations
+                    }
+                }
+
+            }; // class GeoJSONSeqOutputBlock
+
+            class GeoJSONSeqOutputFormat : public osmium::io::detail::OutputFormat {
+
+                geojsonseq_output_options m_options;
+
+            public:
+
+                GeoJSONSeqOutputFormat(osmium::thread::Pool& pool, const osmium::io::File& file, future_string_queue_type& output_queue) :
+                    OutputFormat(pool, output_queue) {
+                    m_options.print_record_separator = file.get("print_record_separator") != "false";
+                }
+
+                void write_buffer(osmium::memory::Buffer&& buffer) final {
+                    m_output_queue.push(m_pool.submit(GeoJSONSeqOutputBlock{std::move(buffer), m_options}));
+                }
+
+            }; // class GeoJSONSeqOutputFormat
+
+            // we want the register_output_format() function to run, setting
+            // the variable is only a side-effect, it will never be used
+            const bool registered_geojsonseq_output = osmium::io::detail::OutputFormatFactory::instance().register_output_format(osmium::io::file_format::geojsonseq,
+                [](osmium::thread::Pool& pool, const osmium::io::File& file, future_string_queue_type& output_queue) {
+                    return new osmium::io::detail::GeoJSONSeqOutputFormat(pool, file, output_queue);
+            });
+
+            // dummy function to silence the unused variable warning from above
+            inline bool get_registered_geojsonseq_output() noexcept {
+                return registered_geojsonseq_output;
+            }
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_GEOJSONSEQ_OUTPUT_FORMAT_HPP
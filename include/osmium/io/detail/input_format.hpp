@@ -33,12 +33,14 @@ DEALINGS IN THE SOFTWARE.
 
 */
 
+#include <osmium/io/detail/mapped_input.hpp>
 #include <osmium/io/detail/queue_util.hpp>
 #include <osmium/io/error.hpp>
 #include <osmium/io/file.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
 #include <osmium/memory/buffer.hpp>
+#include <osmium/memory/buffer_pool.hpp>
 #include <osmium/osm/entity_bits.hpp>
 #include <osmium/thread/pool.hpp>
 
@@ -48,10 +50,15 @@ DEALINGS IN THE SOFTWARE.
 #include <future>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 namespace osmium {
 
+    namespace io {
+        class PBFBlobIndex;
+    } // namespace io
+
     namespace io {
 
         namespace detail {
@@ -63,6 +70,10 @@ namespace osmium {
                 std::promise<osmium::io::Header>& header_promise;
                 osmium::osm_entity_bits::type read_which_entities;
                 osmium::io::read_meta read_metadata;
+                std::shared_ptr<MappedInput> mapped_input;
+                std::shared_ptr<const osmium::io::PBFBlobIndex> blob_index;
+                std::shared_ptr<osmium::memory::BufferPool> buffer_pool;
+                std::shared_ptr<completion_signal> completion;
             };
 
             class Parser {
@@ -73,6 +84,10 @@ namespace osmium {
                 queue_wrapper<std::string> m_input_queue;
                 osmium::osm_entity_bits::type m_read_which_entities;
                 osmium::io::read_meta m_read_metadata;
+                std::shared_ptr<MappedInput> m_mapped_input;
+                std::shared_ptr<const osmium::io::PBFBlobIndex> m_blob_index;
+                std::shared_ptr<osmium::memory::BufferPool> m_buffer_pool;
+                std::shared_ptr<completion_signal> m_completion;
                 bool m_header_is_done;
 
             protected:
@@ -89,6 +104,31 @@ namespace osmium {
                     return m_read_metadata;
                 }
 
+                /**
+                 * The memory mapped input file if the Reader has set it up
+                 * (see the "pbf_mmap" file option), nullptr otherwise. If
+                 * this is set, there is no data in the input queue.
+                 */
+                const std::shared_ptr<MappedInput>& mapped_input() const noexcept {
+                    return m_mapped_input;
+                }
+
+                /**
+                 * The index of blobs to read if the user has given one to
+                 * the Reader, nullptr otherwise.
+                 */
+                const std::shared_ptr<const osmium::io::PBFBlobIndex>& blob_index() const noexcept {
+                    return m_blob_index;
+                }
+
+                /**
+                 * The pool output buffers should be taken from if the user
+                 * has given one to the Reader, nullptr otherwise.
+                 */
+                const std::shared_ptr<osmium::memory::BufferPool>& buffer_pool() const noexcept {
+                    return m_buffer_pool;
+                }
+
                 bool header_is_done() const noexcept {
                     return m_header_is_done;
                 }
@@ -118,6 +158,23 @@ namespace osmium {
                     m_output_queue.push(std::move(future));
                 }
 
+                /**
+                 * Run a task creating a buffer on the thread pool. Use this
+                 * instead of get_pool().submit() for tasks whose result is
+                 * sent to the output queue. If the Reader delivers buffers
+                 * in completion order, it has to be told when they are done.
+                 */
+                template <typename TFunc>
+                std::future<osmium::memory::Buffer> submit_to_pool(TFunc&& func) {
+                    if (!m_completion) {
+                        return m_pool.submit(std::forward<TFunc>(func));
+                    }
+                    signalling_task<typename std::decay<TFunc>::type> task{std::forward<TFunc>(func), m_completion};
+                    auto future = task.get_future();
+                    m_pool.submit(std::move(task));
+                    return future;
+                }
+
             public:
 
                 explicit Parser(parser_arguments& args) :
@@ -127,6 +184,10 @@ namespace osmium {
                     m_input_queue(args.input_queue),
                     m_read_which_entities(args.read_which_entities),
                     m_read_metadata(args.read_metadata),
+                    m_mapped_input(args.mapped_input),
+                    m_blob_index(args.blob_index),
+                    m_buffer_pool(args.buffer_pool),
+                    m_completion(args.completion),
                     m_header_is_done(false) {
                 }
 
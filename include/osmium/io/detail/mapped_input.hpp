@@ -0,0 +1,107 @@
+#ifndef OSMIUM_IO_DETAIL_MAPPED_INPUT_HPP
+#define OSMIUM_IO_DETAIL_MAPPED_INPUT_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+
+*/
+
+#include <osmium/util/memory_mapping.hpp>
+
+#include <atomic>
+#include <cstddef>
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            /**
+             * A read-only memory mapping of a complete (uncompressed) input
+             * file. Parsers that support it can work directly on the mapped
+             * data instead of getting copies of it through the input queue.
+             *
+             * The parser updates the offset so that Reader::offset() still
+             * reports the progress through the file.
+             */
+            class MappedInput {
+
+                osmium::util::MemoryMapping m_mapping;
+                std::atomic<std::size_t> m_offset{0};
+
+            public:
+
+                /**
+                 * Map the file with the given file descriptor. The file
+                 * descriptor can be closed after this.
+                 *
+                 * @param fd Open file descriptor.
+                 * @param size Size of the file. Must not be 0.
+                 * @throws std::system_error if the mapping fails.
+                 */
+                MappedInput(const int fd, const std::size_t size) :
+                    m_mapping(size, osmium::util::MemoryMapping::mapping_mode::readonly, fd) {
+                }
+
+                MappedInput(const MappedInput&) = delete;
+                MappedInput& operator=(const MappedInput&) = delete;
+
+                MappedInput(MappedInput&&) = delete;
+                MappedInput& operator=(MappedInput&&) = delete;
+
+                ~MappedInput() noexcept = default;
+
+                const char* data() const noexcept {
+                    return m_mapping.get_addr<const char>();
+                }
+
+                std::size_t size() const noexcept {
+                    return m_mapping.size();
+                }
+
+                std::size_t offset() const noexcept {
+                    return m_offset;
+                }
+
+                void set_offset(const std::size_t offset) noexcept {
+                    m_offset = offset;
+                }
+
+            }; // class MappedInput
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_MAPPED_INPUT_HPP
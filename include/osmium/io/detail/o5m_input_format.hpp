@@ -51,6 +51,7 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/osm/types.hpp>
 #include <osmium/osm/way.hpp>
 #include <osmium/thread/util.hpp>
+#include <osmium/util/config.hpp>
 #include <osmium/util/delta.hpp>
 
 #include <protozero/exception.hpp>
@@ -62,6 +63,7 @@ DEALINGS IN THE SOFTWARE.
 #include <cstdint>
 #include <cstring>
 #include <future>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <string>
@@ -115,7 +117,7 @@ namespace osmium {
 
                 // The data is stored in this string. It is default constructed
                 // and then resized on demand the first time something is added.
-                // This is done because the ReferenceTable is in a O5mParser
+                // This is done because the ReferenceTable is in an O5mDecoder
                 // object which will be copied from one thread to another. This
                 // way the string is still small when it is copied.
                 std::string m_table;
@@ -150,97 +152,36 @@ namespace osmium {
 
             }; // class ReferenceTable
 
-            class O5mParser : public Parser {
+            enum class o5m_dataset_type : unsigned char {
+                node         = 0x10,
+                way          = 0x11,
+                relation     = 0x12,
+                bounding_box = 0xdb,
+                timestamp    = 0xdc,
+                header       = 0xe0,
+                sync         = 0xee,
+                jump         = 0xef,
+                reset        = 0xff
+            };
+
+            /**
+             * Decodes the node, way, and relation datasets of an o5m file
+             * into a buffer. The delta coding and string table state is kept
+             * between datasets until reset() is called.
+             */
+            class O5mDecoder {
 
                 enum {
                     initial_buffer_size = 1024UL * 1024UL
                 };
 
-                osmium::io::Header m_header{};
-
                 osmium::memory::Buffer m_buffer{initial_buffer_size,
                                                 osmium::memory::Buffer::auto_grow::internal};
 
-                std::string m_input{};
-
-                const char* m_data;
-                const char* m_end;
+                osmium::osm_entity_bits::type m_read_types;
 
                 ReferenceTable m_reference_table;
 
-                static int64_t zvarint(const char** data, const char* end) {
-                    return protozero::decode_zigzag64(protozero::decode_varint(data, end));
-                }
-
-                bool ensure_bytes_available(std::size_t need_bytes) {
-                    if ((m_end - m_data) >= static_cast<int64_t>(need_bytes)) {
-                        return true;
-                    }
-
-                    if (input_done() && (m_input.size() < need_bytes)) {
-                        return false;
-                    }
-
-                    m_input.erase(0, m_data - m_input.data());
-
-                    while (m_input.size() < need_bytes) {
-                        const std::string data{get_input()};
-                        if (input_done()) {
-                            return false;
-                        }
-                        m_input.append(data);
-                    }
-
-                    m_data = m_input.data();
-                    m_end = m_input.data() + m_input.size();
-
-                    return true;
-                }
-
-                void check_header_magic() {
-                    static const unsigned char header_magic[] = { 0xff, 0xe0, 0x04, 'o', '5' };
-
-                    if (std::strncmp(reinterpret_cast<const char*>(header_magic), m_data, sizeof(header_magic)) != 0) {
-                        throw o5m_error{"wrong header magic"};
-                    }
-
-                    m_data += sizeof(header_magic);
-                }
-
-                void check_file_type() {
-                    if (*m_data == 'm') {         // o5m data file
-                        m_header.set_has_multiple_object_versions(false);
-                    } else if (*m_data == 'c') {  // o5c change file
-                        m_header.set_has_multiple_object_versions(true);
-                    } else {
-                        throw o5m_error{"wrong header magic"};
-                    }
-
-                    m_data++;
-                }
-
-                void check_file_format_version() {
-                    if (*m_data != '2') {
-                        throw o5m_error{"wrong header magic"};
-                    }
-
-                    m_data++;
-                }
-
-                void decode_header() {
-                    if (! ensure_bytes_available(7)) { // overall length of header
-                        throw o5m_error{"file too short (incomplete header info)"};
-                    }
-
-                    check_header_magic();
-                    check_file_type();
-                    check_file_format_version();
-                }
-
-                void mark_header_as_done() {
-                    set_header_value(m_header);
-                }
-
                 osmium::DeltaDecode<osmium::object_id_type> m_delta_id;
 
                 osmium::DeltaDecode<int64_t> m_delta_timestamp;
@@ -251,6 +192,16 @@ namespace osmium {
                 osmium::DeltaDecode<osmium::object_id_type> m_delta_way_node_id;
                 std::array<osmium::DeltaDecode<osmium::object_id_type>, 3> m_delta_member_ids;
 
+            public:
+
+                static int64_t zvarint(const char** data, const char* end) {
+                    return protozero::decode_zigzag64(protozero::decode_varint(data, end));
+                }
+
+                explicit O5mDecoder(const osmium::osm_entity_bits::type read_types) :
+                    m_read_types(read_types) {
+                }
+
                 void reset() {
                     m_reference_table.clear();
 
@@ -266,6 +217,8 @@ namespace osmium {
                     m_delta_member_ids[2].clear();
                 }
 
+            private:
+
                 const char* decode_string(const char** dataptr, const char* const end) {
                     if (**dataptr == 0x00) { // get inline string
                         (*dataptr)++;
@@ -501,86 +454,309 @@ namespace osmium {
                     }
                 }
 
+            public:
+
+                /**
+                 * Decode one dataset. Datasets of types not wanted and
+                 * datasets other than nodes, ways, and relations are
+                 * ignored.
+                 */
+                void decode_dataset(const o5m_dataset_type type, const char* data, const char* const end) {
+                    switch (type) {
+                        case o5m_dataset_type::node:
+                            if (m_read_types & osmium::osm_entity_bits::node) {
+                                decode_node(data, end);
+                                m_buffer.commit();
+                            }
+                            break;
+                        case o5m_dataset_type::way:
+                            if (m_read_types & osmium::osm_entity_bits::way) {
+                                decode_way(data, end);
+                                m_buffer.commit();
+                            }
+                            break;
+                        case o5m_dataset_type::relation:
+                            if (m_read_types & osmium::osm_entity_bits::relation) {
+                                decode_relation(data, end);
+                                m_buffer.commit();
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                }
+
+                /// Are there any full buffers to be taken out?
+                bool has_full_buffer() const noexcept {
+                    return m_buffer.has_nested_buffers();
+                }
+
+                /**
+                 * Take out the oldest full buffer.
+                 *
+                 * @pre has_full_buffer()
+                 */
+                osmium::memory::Buffer get_full_buffer() {
+                    std::unique_ptr<osmium::memory::Buffer> buffer_ptr{m_buffer.get_last_nested()};
+                    return std::move(*buffer_ptr);
+                }
+
+                /**
+                 * Take out the current buffer. It can contain nested
+                 * full buffers. A new buffer is started.
+                 */
+                osmium::memory::Buffer release_buffer() {
+                    osmium::memory::Buffer buffer{initial_buffer_size, osmium::memory::Buffer::auto_grow::internal};
+                    using std::swap;
+                    swap(buffer, m_buffer);
+                    return buffer;
+                }
+
+            }; // class O5mDecoder
+
+            /**
+             * Decode all datasets in a segment of an o5m file which starts
+             * with fresh decoder state, ie. at the beginning of the data or
+             * after a reset.
+             */
+            inline void o5m_decode_datasets(O5mDecoder& decoder, const char* data, const char* const end) {
+                while (data != end) {
+                    const auto ds_type = static_cast<o5m_dataset_type>(*data++);
+                    if (ds_type > o5m_dataset_type::jump) {
+                        if (ds_type == o5m_dataset_type::reset) {
+                            decoder.reset();
+                        }
+                        continue;
+                    }
+
+                    uint64_t length = 0;
+                    try {
+                        length = protozero::decode_varint(&data, end);
+                    } catch (const protozero::end_of_buffer_exception&) {
+                        throw o5m_error{"premature end of file"};
+                    }
+                    if (length > static_cast<uint64_t>(end - data)) {
+                        throw o5m_error{"premature end of file"};
+                    }
+
+                    decoder.decode_dataset(ds_type, data, data + length);
+                    data += length;
+                }
+            }
+
+            /// Task decoding a segment of an o5m file.
+            class O5mSegmentDecoder {
+
+                std::string m_data;
+                osmium::osm_entity_bits::type m_read_types;
+
+            public:
+
+                O5mSegmentDecoder(std::string&& data, const osmium::osm_entity_bits::type read_types) :
+                    m_data(std::move(data)),
+                    m_read_types(read_types) {
+                }
+
+                osmium::memory::Buffer operator()() {
+                    O5mDecoder decoder{m_read_types};
+                    o5m_decode_datasets(decoder, m_data.data(), m_data.data() + m_data.size());
+                    return decoder.release_buffer();
+                }
+
+            }; // class O5mSegmentDecoder
+
+            /**
+             * The o5m parser. Normally all datasets are decoded in order on
+             * the parser thread.
+             *
+             * In parallel mode (see osmium::config::use_parallel_o5m_decoding())
+             * the data is cut into segments at reset markers, where all
+             * delta coding and string table state is cleared. Segments of
+             * at least min_segment_size bytes are decoded by
+             * O5mSegmentDecoder tasks on the thread pool. If there is no
+             * reset marker for max_segment_size bytes, the data up to the
+             * next reset is decoded on the parser thread instead. The
+             * header is always handled on the parser thread.
+             */
+            class O5mParser : public Parser {
+
+                enum {
+                    min_segment_size = 1024UL * 1024UL
+                };
+
+                enum {
+                    max_segment_size = 32UL * 1024UL * 1024UL
+                };
+
+                osmium::io::Header m_header{};
+
+                O5mDecoder m_decoder;
+
+                std::string m_input{};
+
+                const char* m_data;
+                const char* m_end;
+
+                bool m_parallel;
+
+                bool ensure_bytes_available(std::size_t need_bytes) {
+                    if ((m_end - m_data) >= static_cast<int64_t>(need_bytes)) {
+                        return true;
+                    }
+
+                    if (input_done() && (m_input.size() < need_bytes)) {
+                        return false;
+                    }
+
+                    m_input.erase(0, m_data - m_input.data());
+
+                    while (m_input.size() < need_bytes) {
+                        const std::string data{get_input()};
+                        if (input_done()) {
+                            return false;
+                        }
+                        m_input.append(data);
+                    }
+
+                    m_data = m_input.data();
+                    m_end = m_input.data() + m_input.size();
+
+                    return true;
+                }
+
+                void check_header_magic() {
+                    static const unsigned char header_magic[] = { 0xff, 0xe0, 0x04, 'o', '5' };
+
+                    if (std::strncmp(reinterpret_cast<const char*>(header_magic), m_data, sizeof(header_magic)) != 0) {
+                        throw o5m_error{"wrong header magic"};
+                    }
+
+                    m_data += sizeof(header_magic);
+                }
+
+                void check_file_type() {
+                    if (*m_data == 'm') {         // o5m data file
+                        m_header.set_has_multiple_object_versions(false);
+                    } else if (*m_data == 'c') {  // o5c change file
+                        m_header.set_has_multiple_object_versions(true);
+                    } else {
+                        throw o5m_error{"wrong header magic"};
+                    }
+
+                    m_data++;
+                }
+
+                void check_file_format_version() {
+                    if (*m_data != '2') {
+                        throw o5m_error{"wrong header magic"};
+                    }
+
+                    m_data++;
+                }
+
+                void decode_header() {
+                    if (! ensure_bytes_available(7)) { // overall length of header
+                        throw o5m_error{"file too short (incomplete header info)"};
+                    }
+
+                    check_header_magic();
+                    check_file_type();
+                    check_file_format_version();
+                }
+
+                void mark_header_as_done() {
+                    set_header_value(m_header);
+                }
+
                 void decode_bbox(const char* data, const char* const end) {
-                    const auto sw_lon = zvarint(&data, end);
-                    const auto sw_lat = zvarint(&data, end);
-                    const auto ne_lon = zvarint(&data, end);
-                    const auto ne_lat = zvarint(&data, end);
+                    const auto sw_lon = O5mDecoder::zvarint(&data, end);
+                    const auto sw_lat = O5mDecoder::zvarint(&data, end);
+                    const auto ne_lon = O5mDecoder::zvarint(&data, end);
+                    const auto ne_lat = O5mDecoder::zvarint(&data, end);
 
                     m_header.add_box(osmium::Box{osmium::Location{sw_lon, sw_lat},
                                                  osmium::Location{ne_lon, ne_lat}});
                 }
 
                 void decode_timestamp(const char* data, const char* const end) {
-                    const auto timestamp = osmium::Timestamp{zvarint(&data, end)}.to_iso();
+                    const auto timestamp = osmium::Timestamp{O5mDecoder::zvarint(&data, end)}.to_iso();
                     m_header.set("o5m_timestamp", timestamp);
                     m_header.set("timestamp", timestamp);
                 }
 
-                enum class dataset_type : unsigned char {
-                    node         = 0x10,
-                    way          = 0x11,
-                    relation     = 0x12,
-                    bounding_box = 0xdb,
-                    timestamp    = 0xdc,
-                    header       = 0xe0,
-                    sync         = 0xee,
-                    jump         = 0xef,
-                    reset        = 0xff
-                };
+                void send_full_buffers() {
+                    while (m_decoder.has_full_buffer()) {
+                        send_to_output_queue(m_decoder.get_full_buffer());
+                    }
+                }
+
+                void send_buffer() {
+                    osmium::memory::Buffer buffer{m_decoder.release_buffer()};
+                    while (buffer.has_nested_buffers()) {
+                        std::unique_ptr<osmium::memory::Buffer> buffer_ptr{buffer.get_last_nested()};
+                        send_to_output_queue(std::move(*buffer_ptr));
+                    }
+                    if (buffer.committed() > 0) {
+                        send_to_output_queue(std::move(buffer));
+                    }
+                }
+
+                // Read the length of the next dataset and make sure all
+                // of it is available.
+                uint64_t get_dataset_length() {
+                    ensure_bytes_available(protozero::max_varint_length);
+
+                    uint64_t length = 0;
+                    try {
+                        length = protozero::decode_varint(&m_data, m_end);
+                    } catch (const protozero::end_of_buffer_exception&) {
+                        throw o5m_error{"premature end of file"};
+                    }
+
+                    if (! ensure_bytes_available(length)) {
+                        throw o5m_error{"premature end of file"};
+                    }
+
+                    return length;
+                }
+
+                // Handle datasets (other than objects) which contain
+                // header information.
+                void decode_header_dataset(const o5m_dataset_type ds_type, const uint64_t length) {
+                    switch (ds_type) {
+                        case o5m_dataset_type::bounding_box:
+                            decode_bbox(m_data, m_data + length);
+                            break;
+                        case o5m_dataset_type::timestamp:
+                            decode_timestamp(m_data, m_data + length);
+                            break;
+                        default:
+                            // ignore unknown datasets
+                            break;
+                    }
+                }
+
+                static bool is_object(const o5m_dataset_type ds_type) noexcept {
+                    return ds_type == o5m_dataset_type::node ||
+                           ds_type == o5m_dataset_type::way ||
+                           ds_type == o5m_dataset_type::relation;
+                }
 
                 void decode_data() {
                     while (ensure_bytes_available(1)) {
-                        const auto ds_type = static_cast<dataset_type>(*m_data++);
-                        if (ds_type > dataset_type::jump) {
-                            if (ds_type == dataset_type::reset) {
-                                reset();
+                        const auto ds_type = static_cast<o5m_dataset_type>(*m_data++);
+                        if (ds_type > o5m_dataset_type::jump) {
+                            if (ds_type == o5m_dataset_type::reset) {
+                                m_decoder.reset();
                             }
                         } else {
-                            ensure_bytes_available(protozero::max_varint_length);
-
-                            uint64_t length = 0;
-                            try {
-                                length = protozero::decode_varint(&m_data, m_end);
-                            } catch (const protozero::end_of_buffer_exception&) {
-                                throw o5m_error{"premature end of file"};
-                            }
-
-                            if (! ensure_bytes_available(length)) {
-                                throw o5m_error{"premature end of file"};
-                            }
+                            const auto length = get_dataset_length();
 
-                            switch (ds_type) {
-                                case dataset_type::node:
-                                    mark_header_as_done();
-                                    if (read_types() & osmium::osm_entity_bits::node) {
-                                        decode_node(m_data, m_data + length);
-                                        m_buffer.commit();
-                                    }
-                                    break;
-                                case dataset_type::way:
-                                    mark_header_as_done();
-                                    if (read_types() & osmium::osm_entity_bits::way) {
-                                        decode_way(m_data, m_data + length);
-                                        m_buffer.commit();
-                                    }
-                                    break;
-                                case dataset_type::relation:
-                                    mark_header_as_done();
-                                    if (read_types() & osmium::osm_entity_bits::relation) {
-                                        decode_relation(m_data, m_data + length);
-                                        m_buffer.commit();
-                                    }
-                                    break;
-                                case dataset_type::bounding_box:
-                                    decode_bbox(m_data, m_data + length);
-                                    break;
-                                case dataset_type::timestamp:
-                                    decode_timestamp(m_data, m_data + length);
-                                    break;
-                                default:
-                                    // ignore unknown datasets
-                                    break;
+                            if (is_object(ds_type)) {
+                                mark_header_as_done();
+                                m_decoder.decode_dataset(ds_type, m_data, m_data + length);
+                            } else {
+                                decode_header_dataset(ds_type, length);
                             }
 
                             if (read_types() == osmium::osm_entity_bits::nothing && header_is_done()) {
@@ -589,26 +765,86 @@ namespace osmium {
 
                             m_data += length;
 
-                            if (m_buffer.has_nested_buffers()) {
-                                std::unique_ptr<osmium::memory::Buffer> buffer_ptr{m_buffer.get_last_nested()};
-                                send_to_output_queue(std::move(*buffer_ptr));
+                            send_full_buffers();
+                        }
+                    }
+
+                    send_buffer();
+
+                    mark_header_as_done();
+                }
+
+                void decode_data_parallel() {
+                    // The datasets since the last reset which have not
+                    // been decoded yet.
+                    std::string segment;
+
+                    // Set if the current segment was too large and is
+                    // decoded on this thread.
+                    bool sequential = false;
+
+                    while (ensure_bytes_available(1)) {
+                        const auto ds_type = static_cast<o5m_dataset_type>(*m_data++);
+                        if (ds_type > o5m_dataset_type::jump) {
+                            if (ds_type != o5m_dataset_type::reset) {
+                                continue;
                             }
+                            if (sequential) {
+                                send_buffer();
+                                m_decoder.reset();
+                                sequential = false;
+                            } else if (segment.size() >= min_segment_size) {
+                                send_to_output_queue(submit_to_pool(O5mSegmentDecoder{std::move(segment), read_types()}));
+                                segment.clear();
+                            } else if (!segment.empty()) {
+                                segment += static_cast<char>(ds_type);
+                            }
+                            continue;
                         }
+
+                        const auto length = get_dataset_length();
+
+                        if (!is_object(ds_type)) {
+                            decode_header_dataset(ds_type, length);
+                        } else {
+                            mark_header_as_done();
+                            if (sequential) {
+                                m_decoder.decode_dataset(ds_type, m_data, m_data + length);
+                                send_full_buffers();
+                            } else {
+                                segment += static_cast<char>(ds_type);
+                                protozero::write_varint(std::back_inserter(segment), length);
+                                segment.append(m_data, length);
+                                if (segment.size() > max_segment_size) {
+                                    // Not enough reset markers, decode
+                                    // on this thread until the next one.
+                                    o5m_decode_datasets(m_decoder, segment.data(), segment.data() + segment.size());
+                                    segment.clear();
+                                    send_full_buffers();
+                                    sequential = true;
+                                }
+                            }
+                        }
+
+                        m_data += length;
                     }
 
-                    if (m_buffer.committed() > 0) {
-                        send_to_output_queue(std::move(m_buffer));
+                    if (!segment.empty()) {
+                        send_to_output_queue(submit_to_pool(O5mSegmentDecoder{std::move(segment), read_types()}));
                     }
+                    send_buffer();
 
                     mark_header_as_done();
                 }
 
             public:
 
-                explicit O5mParser(parser_arguments& args) :
+                explicit O5mParser(parser_arguments& args, const bool parallel = false) :
                     Parser(args),
+                    m_decoder(args.read_which_entities),
                     m_data(m_input.data()),
-                    m_end(m_data) {
+                    m_end(m_data),
+                    m_parallel(parallel) {
                 }
 
                 O5mParser(const O5mParser&) = delete;
@@ -623,7 +859,11 @@ namespace osmium {
                     osmium::thread::set_thread_name("_osmium_o5m_in");
 
                     decode_header();
-                    decode_data();
+                    if (m_parallel && read_types() != osmium::osm_entity_bits::nothing) {
+                        decode_data_parallel();
+                    } else {
+                        decode_data();
+                    }
                 }
 
             }; // class O5mParser
@@ -633,7 +873,7 @@ namespace osmium {
             const bool registered_o5m_parser = ParserFactory::instance().register_parser(
                 file_format::o5m,
                 [](parser_arguments& args) {
-                    return std::unique_ptr<Parser>(new O5mParser{args});
+                    return std::unique_ptr<Parser>(new O5mParser{args, osmium::config::use_parallel_o5m_decoding()});
             });
 
             // dummy function to silence the unused variable warning from above
@@ -0,0 +1,401 @@
+#ifndef OSMIUM_IO_DETAIL_O5M_OUTPUT_FORMAT_HPP
+#define OSMIUM_IO_DETAIL_O5M_OUTPUT_FORMAT_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+#include <osmium/io/detail/output_format.hpp>
+#include <osmium/io/detail/queue_util.hpp>
+#include <osmium/io/file.hpp>
+#include <osmium/io/file_format.hpp>
+#include <osmium/io/header.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/box.hpp>
+#include <osmium/osm/item_type.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/metadata_options.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/object.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/tag.hpp>
+#include <osmium/osm/timestamp.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/util/delta.hpp>
+#include <osmium/visitor.hpp>
+
+#include <protozero/varint.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            // Implementation of the o5m/o5c file formats according to the
+            // description at https://wiki.openstreetmap.org/wiki/O5m .
+
+            struct o5m_output_options {
+
+                /// Which metadata of objects should be added?
+                osmium::metadata_options add_metadata;
+
+            }; // struct o5m_output_options
+
+            /**
+             * The encoder side of the o5m string reference table. Strings
+             * (or string pairs) are written inline the first time they are
+             * seen and as references into the table afterwards.
+             */
+            class O5mStringTable {
+
+                // These settings must be the same as in the ReferenceTable
+                // used for decoding.
+
+                // The maximum number of entries in the table.
+                enum {
+                    number_of_entries = 15000U
+                };
+
+                // The maximum length of a string in the table including
+                // two \0 bytes.
+                enum {
+                    max_length = 250U + 2U
+                };
+
+                std::unordered_map<std::string, uint64_t> m_index{};
+
+                uint64_t m_count = 0;
+
+            public:
+
+                void clear() {
+                    m_index.clear();
+                    m_count = 0;
+                }
+
+                /**
+                 * Write the string (which must contain its \0 bytes) into
+                 * out, either inline or as reference.
+                 */
+                void write(std::string& out, const std::string& str) {
+                    const auto it = m_index.find(str);
+                    if (it != m_index.end() && m_count - it->second <= number_of_entries) {
+                        protozero::write_varint(std::back_inserter(out), m_count - it->second);
+                        return;
+                    }
+
+                    out += '\0';
+                    out += str;
+
+                    if (str.size() <= max_length) {
+                        m_index[str] = m_count++;
+                    }
+                }
+
+                /**
+                 * Write the anonymous user (uid 0, no name) inline. The
+                 * decoder adds an entry to the table for it, but it must
+                 * never be referenced.
+                 */
+                void write_anonymous_user(std::string& out) {
+                    out.append(3, '\0');
+                    ++m_count;
+                }
+
+            }; // class O5mStringTable
+
+            /**
+             * Writes out one buffer with OSM data in o5m format. Each block
+             * starts with a reset marker, so all blocks can be encoded
+             * independently of each other.
+             */
+            class O5mOutputBlock : public OutputBlock {
+
+                enum class dataset_type : unsigned char {
+                    node     = 0x10,
+                    way      = 0x11,
+                    relation = 0x12,
+                    reset    = 0xff
+                };
+
+                o5m_output_options m_options;
+
+                O5mStringTable m_string_table{};
+
+                // Data of the current dataset.
+                std::string m_data{};
+
+                // Used for building strings for the string table.
+                std::string m_string{};
+
+                osmium::DeltaEncode<osmium::object_id_type> m_delta_id{};
+
+                osmium::DeltaEncode<int64_t> m_delta_timestamp{};
+                osmium::DeltaEncode<osmium::changeset_id_type> m_delta_changeset{};
+                osmium::DeltaEncode<int64_t> m_delta_lon{};
+                osmium::DeltaEncode<int64_t> m_delta_lat{};
+
+                osmium::DeltaEncode<osmium::object_id_type> m_delta_way_node_id{};
+                std::array<osmium::DeltaEncode<osmium::object_id_type>, 3> m_delta_member_ids;
+
+                void write_varint(std::string& out, const uint64_t value) {
+                    protozero::write_varint(std::back_inserter(out), value);
+                }
+
+                void write_zvarint(const int64_t value) {
+                    write_varint(m_data, protozero::encode_zigzag64(value));
+                }
+
+                void write_user(const osmium::OSMObject& object) {
+                    const auto uid = m_options.add_metadata.uid() ? object.uid() : 0;
+                    const char* user = m_options.add_metadata.user() ? object.user() : "";
+
+                    // Readers treat uid 0 as the anonymous user which has
+                    // no user name, so the name can not be stored in that
+                    // case.
+                    if (uid == 0) {
+                        m_string_table.write_anonymous_user(m_data);
+                        return;
+                    }
+
+                    m_string.clear();
+                    write_varint(m_string, uid);
+                    m_string += '\0';
+                    m_string += user;
+                    m_string += '\0';
+                    m_string_table.write(m_data, m_string);
+                }
+
+                void write_info(const osmium::OSMObject& object) {
+                    if (!m_options.add_metadata.any() || object.version() == 0) {
+                        m_data += '\0';
+                        return;
+                    }
+
+                    // The version is always written, because o5m can't
+                    // store any other metadata without it.
+                    write_varint(m_data, object.version());
+
+                    const int64_t timestamp = m_options.add_metadata.timestamp() ? uint32_t(object.timestamp()) : 0;
+                    write_zvarint(m_delta_timestamp.update(timestamp));
+                    if (timestamp != 0) {
+                        const osmium::changeset_id_type changeset = m_options.add_metadata.changeset() ? object.changeset() : 0;
+                        write_zvarint(m_delta_changeset.update(changeset));
+                        write_user(object);
+                    }
+                }
+
+                void write_tags(const osmium::TagList& tags) {
+                    for (const auto& tag : tags) {
+                        m_string.assign(tag.key());
+                        m_string += '\0';
+                        m_string += tag.value();
+                        m_string += '\0';
+                        m_string_table.write(m_data, m_string);
+                    }
+                }
+
+                void write_dataset(const dataset_type type) {
+                    *m_out += static_cast<char>(type);
+                    write_varint(*m_out, m_data.size());
+                    *m_out += m_data;
+                    m_data.clear();
+                }
+
+                // Write the part of a dataset that is the same for all
+                // object types. Returns true if there is more data to
+                // write, false for deleted objects.
+                bool write_object(const osmium::OSMObject& object) {
+                    write_zvarint(m_delta_id.update(object.id()));
+                    write_info(object);
+                    return object.visible();
+                }
+
+            public:
+
+                O5mOutputBlock(osmium::memory::Buffer&& buffer, const o5m_output_options& options) :
+                    OutputBlock(std::move(buffer)),
+                    m_options(options) {
+                }
+
+                std::string operator()() {
+                    *m_out += static_cast<char>(dataset_type::reset);
+                    osmium::apply(m_input_buffer->cbegin(), m_input_buffer->cend(), *this);
+
+                    std::string out;
+                    using std::swap;
+                    swap(out, *m_out);
+
+                    return out;
+                }
+
+                void node(const osmium::Node& node) {
+                    if (write_object(node)) {
+                        write_zvarint(m_delta_lon.update(node.location().x()));
+                        write_zvarint(m_delta_lat.update(node.location().y()));
+                        write_tags(node.tags());
+                    }
+                    write_dataset(dataset_type::node);
+                }
+
+                void way(const osmium::Way& way) {
+                    if (write_object(way)) {
+                        std::string refs;
+                        for (const auto& node_ref : way.nodes()) {
+                            write_varint(refs, protozero::encode_zigzag64(m_delta_way_node_id.update(node_ref.ref())));
+                        }
+                        write_varint(m_data, refs.size());
+                        m_data += refs;
+                        write_tags(way.tags());
+                    }
+                    write_dataset(dataset_type::way);
+                }
+
+                void relation(const osmium::Relation& relation) {
+                    if (write_object(relation)) {
+                        std::string refs;
+                        for (const auto& member : relation.members()) {
+                            const auto index = osmium::item_type_to_nwr_index(member.type());
+                            write_varint(refs, protozero::encode_zigzag64(m_delta_member_ids[index].update(member.ref())));
+                            m_string.assign(1, static_cast<char>('0' + index));
+                            m_string += member.role();
+                            m_string += '\0';
+                            m_string_table.write(refs, m_string);
+                        }
+                        write_varint(m_data, refs.size());
+                        m_data += refs;
+                        write_tags(relation.tags());
+                    }
+                    write_dataset(dataset_type::relation);
+                }
+
+            }; // class O5mOutputBlock
+
+            class O5mOutputFormat : public osmium::io::detail::OutputFormat {
+
+                enum class dataset_type : unsigned char {
+                    bounding_box = 0xdb,
+                    timestamp    = 0xdc,
+                    header       = 0xe0,
+                    end_of_file  = 0xfe,
+                    reset        = 0xff
+                };
+
+                o5m_output_options m_options;
+
+                bool m_change_format;
+
+                static void write_dataset(std::string& out, const dataset_type type, const std::string& data) {
+                    out += static_cast<char>(type);
+                    protozero::write_varint(std::back_inserter(out), data.size());
+                    out += data;
+                }
+
+                static void add_zvarint(std::string& out, const int64_t value) {
+                    protozero::write_varint(std::back_inserter(out), protozero::encode_zigzag64(value));
+                }
+
+            public:
+
+                O5mOutputFormat(osmium::thread::Pool& pool, const osmium::io::File& file, future_string_queue_type& output_queue) :
+                    OutputFormat(pool, output_queue),
+                    m_change_format(file.is_true("o5c_change_format")) {
+                    m_options.add_metadata = osmium::metadata_options{file.get("add_metadata")};
+                }
+
+                void write_header(const osmium::io::Header& header) final {
+                    std::string out;
+
+                    out += static_cast<char>(dataset_type::reset);
+                    write_dataset(out, dataset_type::header, m_change_format ? "o5c2" : "o5m2");
+
+                    std::string timestamp{header.get("timestamp")};
+                    if (timestamp.empty()) {
+                        timestamp = header.get("osmosis_replication_timestamp");
+                    }
+                    if (!timestamp.empty()) {
+                        std::string data;
+                        add_zvarint(data, osmium::Timestamp{timestamp.c_str()}.seconds_since_epoch());
+                        write_dataset(out, dataset_type::timestamp, data);
+                    }
+
+                    if (!header.boxes().empty()) {
+                        const osmium::Box box = header.joined_boxes();
+                        std::string data;
+                        add_zvarint(data, box.bottom_left().x());
+                        add_zvarint(data, box.bottom_left().y());
+                        add_zvarint(data, box.top_right().x());
+                        add_zvarint(data, box.top_right().y());
+                        write_dataset(out, dataset_type::bounding_box, data);
+                    }
+
+                    send_to_output_queue(std::move(out));
+                }
+
+                void write_buffer(osmium::memory::Buffer&& buffer) final {
+                    m_output_queue.push(m_pool.submit(O5mOutputBlock{std::move(buffer), m_options}));
+                }
+
+                void write_end() final {
+                    send_to_output_queue(std::string(1, static_cast<char>(dataset_type::end_of_file)));
+                }
+
+            }; // class O5mOutputFormat
+
+            // we want the register_output_format() function to run, setting
+            // the variable is only a side-effect, it will never be used
+            const bool registered_o5m_output = osmium::io::detail::OutputFormatFactory::instance().register_output_format(osmium::io::file_format::o5m,
+                [](osmium::thread::Pool& pool, const osmium::io::File& file, future_string_queue_type& output_queue) {
+                    return new osmium::io::detail::O5mOutputFormat(pool, file, output_queue);
+            });
+
+            // dummy function to silence the unused variable warning from above
+            inline bool get_registered_o5m_output() noexcept {
+                return registered_o5m_output;
+            }
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_O5M_OUTPUT_FORMAT_HPP
@@ -38,6 +38,8 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
 #include <osmium/memory/buffer.hpp>
+#include <osmium/osm/entity_bits.hpp>
+#include <osmium/thread/pool.hpp>
 #include <osmium/thread/util.hpp>
 
 #include <cstdint>
@@ -98,17 +100,95 @@ namespace osmium {
                 }
             }
 
-            class OPLParser : public Parser {
+            inline bool is_opl_line_end(const char c) noexcept {
+                return c == '\n' || c == '\r';
+            }
+
+            /**
+             * Count the lines in the data the same way line_by_line() does,
+             * ie empty lines are not counted.
+             */
+            inline uint64_t opl_count_lines(const std::string& data) noexcept {
+                uint64_t count = 0;
+                for (std::string::size_type i = 0; i < data.size(); ++i) {
+                    if (!is_opl_line_end(data[i]) &&
+                        (i + 1 == data.size() || is_opl_line_end(data[i + 1]))) {
+                        ++count;
+                    }
+                }
+                return count;
+            }
+
+            /**
+             * Task parsing a chunk of OPL data consisting of complete lines
+             * into a buffer. The line count is only used for error
+             * messages.
+             */
+            class OPLChunkParser {
 
                 enum {
                     initial_buffer_size = 1024UL * 1024UL
                 };
 
-                osmium::memory::Buffer m_buffer{initial_buffer_size,
-                                                osmium::memory::Buffer::auto_grow::internal};
+                std::string m_data;
+                osmium::memory::Buffer m_buffer{};
+                uint64_t m_line_count;
+                osmium::osm_entity_bits::type m_read_types;
+                bool m_input_done = false;
+
+            public:
+
+                OPLChunkParser(std::string&& data, const uint64_t first_line, const osmium::osm_entity_bits::type read_types) :
+                    m_data(std::move(data)),
+                    m_line_count(first_line),
+                    m_read_types(read_types) {
+                }
+
+                // These three functions are the interface needed by
+                // line_by_line().
+
+                bool input_done() const noexcept {
+                    return m_input_done;
+                }
+
+                std::string get_input() {
+                    m_input_done = true;
+                    return std::move(m_data);
+                }
+
+                void parse_line(const char* data) {
+                    opl_parse_line(m_line_count, data, m_buffer, m_read_types);
+                    ++m_line_count;
+                }
+
+                osmium::memory::Buffer operator()() {
+                    m_buffer = osmium::memory::Buffer{initial_buffer_size, osmium::memory::Buffer::auto_grow::yes};
+                    line_by_line(*this);
+                    return std::move(m_buffer);
+                }
+
+            }; // class OPLChunkParser
+
+            /**
+             * The OPL parser cuts the input into chunks of complete lines
+             * and parses those in parallel on the thread pool. Each chunk
+             * results in one buffer, the buffers are sent to the output
+             * queue in order.
+             */
+            class OPLParser : public Parser {
+
+                enum {
+                    max_chunk_size = 1024UL * 1024UL
+                };
 
                 uint64_t m_line_count = 0;
 
+                void submit_chunk(std::string&& chunk) {
+                    const auto lines = opl_count_lines(chunk);
+                    send_to_output_queue(submit_to_pool(OPLChunkParser{std::move(chunk), m_line_count, read_types()}));
+                    m_line_count += lines;
+                }
+
             public:
 
                 explicit OPLParser(parser_arguments& args) :
@@ -124,23 +204,39 @@ namespace osmium {
 
                 ~OPLParser() noexcept final = default;
 
-                void parse_line(const char* data) {
-                    if (opl_parse_line(m_line_count, data, m_buffer, read_types())) {
-                        if (m_buffer.has_nested_buffers()) {
-                            std::unique_ptr<osmium::memory::Buffer> buffer_ptr{m_buffer.get_last_nested()};
-                            send_to_output_queue(std::move(*buffer_ptr));
-                        }
-                    }
-                    ++m_line_count;
-                }
-
                 void run() final {
                     osmium::thread::set_thread_name("_osmium_opl_in");
 
-                    line_by_line(*this);
+                    std::string rest;
+                    while (!input_done()) {
+                        std::string input{get_input()};
+
+                        // Large inputs are cut into several chunks so that
+                        // they can be parsed in parallel.
+                        std::string::size_type start = 0;
+                        while (input.size() - start > max_chunk_size) {
+                            const auto pos = input.find_last_of("\n\r", start + max_chunk_size);
+                            if (pos == std::string::npos || pos < start) {
+                                break;
+                            }
+                            rest.append(input, start, pos + 1 - start);
+                            submit_chunk(std::move(rest));
+                            rest.clear();
+                            start = pos + 1;
+                        }
 
-                    if (m_buffer.committed() > 0) {
-                        send_to_output_queue(std::move(m_buffer));
+                        const auto pos = input.find_last_of("\n\r");
+                        if (pos == std::string::npos || pos < start) {
+                            rest.append(input, start, std::string::npos);
+                            continue;
+                        }
+                        rest.append(input, start, pos + 1 - start);
+                        submit_chunk(std::move(rest));
+                        rest.assign(input, pos + 1, std::string::npos);
+                    }
+
+                    if (!rest.empty()) {
+                        submit_chunk(std::move(rest));
                     }
                 }
 
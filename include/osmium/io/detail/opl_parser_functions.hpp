@@ -34,6 +34,7 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/builder/osm_object_builder.hpp>
+#include <osmium/io/detail/opl_scanner.hpp>
 #include <osmium/io/detail/string_util.hpp>
 #include <osmium/io/error.hpp>
 #include <osmium/memory/buffer.hpp>
@@ -131,9 +132,7 @@ namespace osmium {
              * string.
              */
             inline const char* opl_skip_section(const char** s) noexcept {
-                while (opl_non_empty(*s)) {
-                    ++*s;
-                }
+                *s = opl_find_section_end(*s);
                 return *s;
             }
 
@@ -184,16 +183,14 @@ namespace osmium {
             inline void opl_parse_string(const char** data, std::string& result) {
                 const char* s = *data;
                 while (true) {
-                    if (*s == '\0' || *s == ' ' || *s == '\t' || *s == ',' || *s == '=') {
+                    const char* end = opl_find_string_end(s);
+                    result.append(s, end);
+                    s = end;
+                    if (*s != '%') {
                         break;
                     }
-                    if (*s == '%') {
-                        ++s;
-                        opl_parse_escaped(&s, result);
-                    } else {
-                        result += *s;
-                        ++s;
-                    }
+                    ++s;
+                    opl_parse_escaped(&s, result);
                 }
                 *data = s;
             }
@@ -213,22 +210,31 @@ namespace osmium {
                     ++*s;
                 }
 
-                int64_t value = 0;
+                // Work on a local copy of the pointer and with unsigned
+                // digit values, this allows the compiler to keep
+                // everything in registers.
+                const char* p = *s;
+                uint64_t uvalue = 0;
 
                 int n = max_int_len;
-                while (**s >= '0' && **s <= '9') {
+                unsigned int digit = static_cast<unsigned char>(*p) - static_cast<unsigned int>('0');
+                while (digit < 10) {
                     if (--n == 0) {
+                        *s = p;
                         throw opl_error{"integer too long", *s};
                     }
-                    value *= 10;
-                    value += **s - '0';
-                    ++*s;
+                    uvalue = uvalue * 10 + digit;
+                    ++p;
+                    digit = static_cast<unsigned char>(*p) - static_cast<unsigned int>('0');
                 }
+                *s = p;
 
                 if (n == max_int_len) {
                     throw opl_error{"expected integer", *s};
                 }
 
+                auto value = static_cast<int64_t>(uvalue);
+
                 if (negative) {
                     value = -value;
                     if (value < std::numeric_limits<T>::min()) {
@@ -0,0 +1,193 @@
+#ifndef OSMIUM_IO_DETAIL_OPL_SCANNER_HPP
+#define OSMIUM_IO_DETAIL_OPL_SCANNER_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <cstdint>
+#include <initializer_list>
+
+#if defined(__AVX2__) && !defined(OSMIUM_OPL_NO_SIMD)
+# include <immintrin.h>
+# define OSMIUM_OPL_SCANNER_AVX2
+#elif defined(__SSE2__) && !defined(OSMIUM_OPL_NO_SIMD)
+# include <emmintrin.h>
+# define OSMIUM_OPL_SCANNER_SSE2
+#endif
+
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+// The vectorized scanners read whole aligned blocks which can extend
+// past the terminating null character of the string. Aligned loads
+// never cross a page boundary so this is safe, but the address sanitizer
+// doesn't know that.
+#if defined(__clang__) || (defined(__GNUC__) && !defined(__INTEL_COMPILER))
+# define OSMIUM_OPL_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+# define OSMIUM_OPL_NO_SANITIZE_ADDRESS
+#endif
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            /**
+             * Returns true if c is one of the characters in the template
+             * parameters.
+             */
+            template <char... TChars>
+            inline bool opl_is_one_of(const char c) noexcept {
+                bool result = false;
+                (void)std::initializer_list<int>{(result = result || (c == TChars), 0)...};
+                return result;
+            }
+
+            /**
+             * Find the first character in the null-terminated string s
+             * that is one of the characters in the template parameters.
+             * The null character must be one of them.
+             *
+             * This is the simple byte-by-byte version.
+             */
+            template <char... TChars>
+            inline const char* opl_find_first_of_scalar(const char* s) noexcept {
+                while (!opl_is_one_of<TChars...>(*s)) {
+                    ++s;
+                }
+                return s;
+            }
+
+            inline unsigned int opl_count_trailing_zeros(uint32_t mask) noexcept {
+#ifdef _MSC_VER
+                unsigned long index; // NOLINT(google-runtime-int)
+                _BitScanForward(&index, mask);
+                return static_cast<unsigned int>(index);
+#else
+                return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+            }
+
+#if defined(OSMIUM_OPL_SCANNER_AVX2)
+
+            enum {
+                opl_scanner_block_size = 32
+            };
+
+            template <char... TChars>
+            OSMIUM_OPL_NO_SANITIZE_ADDRESS
+            inline uint32_t opl_match_block(const char* p) noexcept {
+                const __m256i data = _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+                __m256i matches = _mm256_setzero_si256();
+                (void)std::initializer_list<int>{(matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(data, _mm256_set1_epi8(TChars))), 0)...};
+                return static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+            }
+
+#elif defined(OSMIUM_OPL_SCANNER_SSE2)
+
+            enum {
+                opl_scanner_block_size = 16
+            };
+
+            template <char... TChars>
+            OSMIUM_OPL_NO_SANITIZE_ADDRESS
+            inline uint32_t opl_match_block(const char* p) noexcept {
+                const __m128i data = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i matches = _mm_setzero_si128();
+                (void)std::initializer_list<int>{(matches = _mm_or_si128(matches, _mm_cmpeq_epi8(data, _mm_set1_epi8(TChars))), 0)...};
+                return static_cast<uint32_t>(_mm_movemask_epi8(matches));
+            }
+
+#endif
+
+            /**
+             * Find the first character in the null-terminated string s
+             * that is one of the characters in the template parameters.
+             * The null character must be one of them.
+             *
+             * If compiled with SSE2 or AVX2 support, this looks at 16 or
+             * 32 bytes at a time. Define OSMIUM_OPL_NO_SIMD to always use
+             * the byte-by-byte version.
+             */
+            template <char... TChars>
+            OSMIUM_OPL_NO_SANITIZE_ADDRESS
+            inline const char* opl_find_first_of(const char* s) noexcept {
+#if defined(OSMIUM_OPL_SCANNER_AVX2) || defined(OSMIUM_OPL_SCANNER_SSE2)
+                // Handle the first (unaligned) block by loading the
+                // aligned block it is in and ignoring the bytes before s.
+                const auto offset = static_cast<unsigned int>(reinterpret_cast<uintptr_t>(s) % opl_scanner_block_size);
+                const char* p = s - offset;
+                uint32_t mask = opl_match_block<TChars...>(p) >> offset;
+                if (mask) {
+                    return s + opl_count_trailing_zeros(mask);
+                }
+                while (true) {
+                    p += opl_scanner_block_size;
+                    mask = opl_match_block<TChars...>(p);
+                    if (mask) {
+                        return p + opl_count_trailing_zeros(mask);
+                    }
+                }
+#else
+                return opl_find_first_of_scalar<TChars...>(s);
+#endif
+            }
+
+            /**
+             * Find end of a section in an OPL line, ie the next space or
+             * tab character or the end of the string.
+             */
+            inline const char* opl_find_section_end(const char* s) noexcept {
+                return opl_find_first_of<'\0', ' ', '\t'>(s);
+            }
+
+            /**
+             * Find end of a string in an OPL line or the next escape
+             * character, ie the next space, tab, comma, equal sign, percent
+             * sign or the end of the string.
+             */
+            inline const char* opl_find_string_end(const char* s) noexcept {
+                return opl_find_first_of<'\0', ' ', '\t', ',', '=', '%'>(s);
+            }
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#undef OSMIUM_OPL_NO_SANITIZE_ADDRESS
+
+#endif // OSMIUM_IO_DETAIL_OPL_SCANNER_HPP
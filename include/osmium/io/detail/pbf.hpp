@@ -73,6 +73,11 @@ namespace osmium {
 
             const int64_t resolution_convert = lonlat_resolution / osmium::detail::coordinate_precision;
 
+            // format marker for the BlobHeader indexdata written by Osmium
+            constexpr const char* pbf_index_data_format() noexcept {
+                return "osmium-1";
+            }
+
         } // namespace detail
 
     } // namespace io
@@ -34,12 +34,21 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/builder/osm_object_builder.hpp>
+#include <osmium/io/detail/mapped_input.hpp>
 #include <osmium/io/detail/pbf.hpp> // IWYU pragma: export
 #include <osmium/io/detail/protobuf_tags.hpp>
 #include <osmium/io/detail/zlib.hpp>
+#ifdef OSMIUM_WITH_LZ4
+# include <osmium/io/detail/lz4.hpp>
+#endif
+#ifdef OSMIUM_WITH_ZSTD
+# include <osmium/io/detail/zstd.hpp>
+#endif
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/pbf_blob_index.hpp>
 #include <osmium/memory/buffer.hpp>
+#include <osmium/memory/buffer_pool.hpp>
 #include <osmium/osm/box.hpp>
 #include <osmium/osm/entity_bits.hpp>
 #include <osmium/osm/item_type.hpp>
@@ -52,6 +61,7 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/osm/way.hpp>
 #include <osmium/util/delta.hpp>
 
+#include <protozero/exception.hpp>
 #include <protozero/iterators.hpp>
 #include <protozero/pbf_message.hpp>
 #include <protozero/types.hpp>
@@ -94,7 +104,7 @@ namespace osmium {
 
                 osmium::osm_entity_bits::type m_read_types;
 
-                osmium::memory::Buffer m_buffer{initial_buffer_size, osmium::memory::Buffer::auto_grow::internal};
+                osmium::memory::Buffer m_buffer;
 
                 osmium::io::read_meta m_read_metadata;
 
@@ -711,9 +721,19 @@ namespace osmium {
 
             public:
 
-                PBFPrimitiveBlockDecoder(const data_view& data, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata) :
+                /**
+                 * Construct decoder.
+                 *
+                 * If a buffer pool is given, the output buffer is taken from
+                 * it. It will grow as needed instead of using nested buffers,
+                 * so that its memory can be re-used as a whole for the next
+                 * block once it is given back to the pool.
+                 */
+                PBFPrimitiveBlockDecoder(const data_view& data, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata, osmium::memory::BufferPool* buffer_pool = nullptr) :
                     m_data(data),
                     m_read_types(read_types),
+                    m_buffer(buffer_pool ? buffer_pool->get(initial_buffer_size, osmium::memory::Buffer::auto_grow::yes)
+                                         : osmium::memory::Buffer{initial_buffer_size, osmium::memory::Buffer::auto_grow::internal}),
                     m_read_metadata(read_metadata) {
                 }
 
@@ -738,9 +758,127 @@ namespace osmium {
 
             }; // class PBFPrimitiveBlockDecoder
 
-            inline data_view decode_blob(const std::string& blob_data, std::string& output) {
+            /**
+             * Decode the 4 bytes in network byte order in front of each
+             * BlobHeader. They contain the length of the BlobHeader.
+             *
+             * @throws osmium::pbf_error If the size is too large.
+             */
+            inline uint32_t decode_blob_header_size(const char* d) {
+                const uint32_t size = (static_cast<uint32_t>(d[3])) |
+                                      (static_cast<uint32_t>(d[2]) <<  8U) |
+                                      (static_cast<uint32_t>(d[1]) << 16U) |
+                                      (static_cast<uint32_t>(d[0]) << 24U);
+
+                if (size > static_cast<uint32_t>(max_blob_header_size)) {
+                    throw osmium::pbf_error{"invalid BlobHeader size (> max_blob_header_size)"};
+                }
+
+                return size;
+            }
+
+            /**
+             * Decode the BlobHeader indexdata written by Osmium.
+             *
+             * @param data The content of the indexdata field.
+             * @param entry The types and ID range are added to this.
+             * @returns false if the indexdata wasn't written by Osmium and
+             *          nothing has been added to the entry.
+             */
+            inline bool decode_blob_index_data(const data_view& data, pbf_blob_index_entry& entry) {
+                bool has_format = false;
+                auto types = osmium::osm_entity_bits::nothing;
+                osmium::object_id_type min_id = 0;
+                osmium::object_id_type max_id = 0;
+
+                try {
+                    protozero::pbf_message<FileFormat::IndexData> pbf_index_data{data};
+                    while (pbf_index_data.next()) {
+                        switch (pbf_index_data.tag_and_type()) {
+                            case protozero::tag_and_type(FileFormat::IndexData::required_string_format, protozero::pbf_wire_type::length_delimited):
+                                has_format = pbf_index_data.get_view() == data_view{pbf_index_data_format()};
+                                break;
+                            case protozero::tag_and_type(FileFormat::IndexData::optional_uint32_types, protozero::pbf_wire_type::varint):
+                                types = static_cast<osmium::osm_entity_bits::type>(pbf_index_data.get_uint32() & osmium::osm_entity_bits::object);
+                                break;
+                            case protozero::tag_and_type(FileFormat::IndexData::optional_sint64_min_id, protozero::pbf_wire_type::varint):
+                                min_id = pbf_index_data.get_sint64();
+                                break;
+                            case protozero::tag_and_type(FileFormat::IndexData::optional_sint64_max_id, protozero::pbf_wire_type::varint):
+                                max_id = pbf_index_data.get_sint64();
+                                break;
+                            default:
+                                pbf_index_data.skip();
+                        }
+                    }
+                } catch (const protozero::exception&) {
+                    return false;
+                }
+
+                if (!has_format) {
+                    return false;
+                }
+
+                entry.types = types;
+                entry.min_id = min_id;
+                entry.max_id = max_id;
+
+                return true;
+            }
+
+            /**
+             * Decode the BlobHeader. Make sure it contains the expected
+             * type. Return the size of the following Blob.
+             *
+             * @param pbf_blob_header The BlobHeader message.
+             * @param expected_type The type the blob must have.
+             * @param index_data If this is not nullptr, it will be set to
+             *                   the content of the indexdata field (if any).
+             */
+            inline size_t decode_blob_header(protozero::pbf_message<FileFormat::BlobHeader>&& pbf_blob_header, const char* expected_type, data_view* index_data = nullptr) {
+                protozero::data_view blob_header_type;
+                size_t blob_header_datasize = 0;
+
+                while (pbf_blob_header.next()) {
+                    switch (pbf_blob_header.tag_and_type()) {
+                        case protozero::tag_and_type(FileFormat::BlobHeader::required_string_type, protozero::pbf_wire_type::length_delimited):
+                            blob_header_type = pbf_blob_header.get_view();
+                            break;
+                        case protozero::tag_and_type(FileFormat::BlobHeader::required_int32_datasize, protozero::pbf_wire_type::varint):
+                            blob_header_datasize = pbf_blob_header.get_int32();
+                            break;
+                        case protozero::tag_and_type(FileFormat::BlobHeader::optional_bytes_indexdata, protozero::pbf_wire_type::length_delimited):
+                            if (index_data) {
+                                *index_data = pbf_blob_header.get_view();
+                            } else {
+                                pbf_blob_header.skip();
+                            }
+                            break;
+                        default:
+                            pbf_blob_header.skip();
+                    }
+                }
+
+                if (blob_header_datasize == 0) {
+                    throw osmium::pbf_error{"PBF format error: BlobHeader.datasize missing or zero."};
+                }
+
+                if (std::strncmp(expected_type, blob_header_type.data(), blob_header_type.size()) != 0) {
+                    throw osmium::pbf_error{"blob does not have expected type (OSMHeader in first blob, OSMData in following blobs)"};
+                }
+
+                return blob_header_datasize;
+            }
+
+            inline data_view decode_blob(const data_view& blob_data, std::string& output) {
                 int32_t raw_size = 0;
                 protozero::data_view zlib_data;
+#ifdef OSMIUM_WITH_LZ4
+                protozero::data_view lz4_data;
+#endif
+#ifdef OSMIUM_WITH_ZSTD
+                protozero::data_view zstd_data;
+#endif
 
                 protozero::pbf_message<FileFormat::Blob> pbf_blob{blob_data};
                 while (pbf_blob.next()) {
@@ -764,6 +902,20 @@ namespace osmium {
                             break;
                         case protozero::tag_and_type(FileFormat::Blob::optional_bytes_lzma_data, protozero::pbf_wire_type::length_delimited):
                             throw osmium::pbf_error{"lzma blobs not implemented"};
+                        case protozero::tag_and_type(FileFormat::Blob::optional_bytes_lz4_data, protozero::pbf_wire_type::length_delimited):
+#ifdef OSMIUM_WITH_LZ4
+                            lz4_data = pbf_blob.get_view();
+                            break;
+#else
+                            throw osmium::pbf_error{"lz4 blobs not supported (compile with OSMIUM_WITH_LZ4)"};
+#endif
+                        case protozero::tag_and_type(FileFormat::Blob::optional_bytes_zstd_data, protozero::pbf_wire_type::length_delimited):
+#ifdef OSMIUM_WITH_ZSTD
+                            zstd_data = pbf_blob.get_view();
+                            break;
+#else
+                            throw osmium::pbf_error{"zstd blobs not supported (compile with OSMIUM_WITH_ZSTD)"};
+#endif
                         default:
                             throw osmium::pbf_error{"unknown compression"};
                     }
@@ -778,6 +930,28 @@ namespace osmium {
                     );
                 }
 
+#ifdef OSMIUM_WITH_LZ4
+                if (!lz4_data.empty() && raw_size != 0) {
+                    return osmium::io::detail::lz4_uncompress_string(
+                        lz4_data.data(),
+                        lz4_data.size(),
+                        static_cast<std::size_t>(raw_size),
+                        output
+                    );
+                }
+#endif
+
+#ifdef OSMIUM_WITH_ZSTD
+                if (!zstd_data.empty() && raw_size != 0) {
+                    return osmium::io::detail::zstd_uncompress_string(
+                        zstd_data.data(),
+                        zstd_data.size(),
+                        static_cast<std::size_t>(raw_size),
+                        output
+                    );
+                }
+#endif
+
                 throw osmium::pbf_error{"blob contains no data"};
             }
 
@@ -886,7 +1060,7 @@ namespace osmium {
              * @returns Header object
              * @throws osmium::pbf_error If there was a parsing error
              */
-            inline osmium::io::Header decode_header(const std::string& header_block_data) {
+            inline osmium::io::Header decode_header(const data_view& header_block_data) {
                 std::string output;
 
                 return decode_header_block(decode_blob(header_block_data, output));
@@ -894,21 +1068,44 @@ namespace osmium {
 
             class PBFDataBlobDecoder {
 
+                // Only one of these two is set. They keep the data
+                // m_input_data points to alive.
                 std::shared_ptr<std::string> m_input_buffer;
+                std::shared_ptr<MappedInput> m_mapped_input;
+
+                data_view m_input_data;
                 osmium::osm_entity_bits::type m_read_types;
                 osmium::io::read_meta m_read_metadata;
 
+                // Output buffers are taken from here if set.
+                std::shared_ptr<osmium::memory::BufferPool> m_buffer_pool;
+
             public:
 
-                PBFDataBlobDecoder(std::string&& input_buffer, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata) :
+                PBFDataBlobDecoder(std::string&& input_buffer, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata, const std::shared_ptr<osmium::memory::BufferPool>& buffer_pool = nullptr) :
                     m_input_buffer(std::make_shared<std::string>(std::move(input_buffer))),
+                    m_input_data(*m_input_buffer),
                     m_read_types(read_types),
-                    m_read_metadata(read_metadata) {
+                    m_read_metadata(read_metadata),
+                    m_buffer_pool(buffer_pool) {
+                }
+
+                /**
+                 * Construct decoder for a blob inside a memory mapped
+                 * input file. The data is not copied, the decoder keeps
+                 * the mapping alive until it is done.
+                 */
+                PBFDataBlobDecoder(const std::shared_ptr<MappedInput>& mapped_input, const data_view& input_data, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata, const std::shared_ptr<osmium::memory::BufferPool>& buffer_pool = nullptr) :
+                    m_mapped_input(mapped_input),
+                    m_input_data(input_data),
+                    m_read_types(read_types),
+                    m_read_metadata(read_metadata),
+                    m_buffer_pool(buffer_pool) {
                 }
 
                 osmium::memory::Buffer operator()() {
                     std::string output;
-                    PBFPrimitiveBlockDecoder decoder{decode_blob(*m_input_buffer, output), m_read_types, m_read_metadata};
+                    PBFPrimitiveBlockDecoder decoder{decode_blob(m_input_data, output), m_read_types, m_read_metadata, m_buffer_pool.get()};
                     return decoder();
                 }
 
@@ -39,10 +39,13 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/detail/protobuf_tags.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/pbf_blob_index.hpp>
 #include <osmium/osm/entity_bits.hpp>
+#include <osmium/osm/object.hpp>
 #include <osmium/thread/pool.hpp>
 #include <osmium/thread/util.hpp>
 #include <osmium/util/config.hpp>
+#include <osmium/util/file.hpp>
 
 #include <protozero/pbf_message.hpp>
 #include <protozero/types.hpp>
@@ -51,10 +54,12 @@ DEALINGS IN THE SOFTWARE.
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <future>
 #include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace osmium {
 
@@ -66,6 +71,9 @@ namespace osmium {
 
                 std::string m_input_buffer{};
 
+                // Current read position if reading from mapped input.
+                size_t m_mapped_offset = 0;
+
                 /**
                  * Read the given number of bytes from the input queue.
                  *
@@ -91,102 +99,165 @@ namespace osmium {
                     return output;
                 }
 
+                /**
+                 * Read the given number of bytes from the memory mapped
+                 * input file. No data is copied, the returned view points
+                 * into the mapping.
+                 *
+                 * @param size Number of bytes to read
+                 * @returns View on the data
+                 * @throws osmium::pbf_error If size bytes can't be read
+                 */
+                data_view read_from_mapped_input(size_t size) {
+                    const auto& input = *mapped_input();
+                    if (input.size() - m_mapped_offset < size) {
+                        throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                    }
+
+                    const data_view data{input.data() + m_mapped_offset, size};
+                    m_mapped_offset += size;
+                    mapped_input()->set_offset(m_mapped_offset);
+
+                    return data;
+                }
+
                 /**
                  * Read 4 bytes in network byte order from file. They contain
                  * the length of the following BlobHeader.
                  */
                 uint32_t read_blob_header_size_from_file() {
-                    uint32_t size;
+                    std::string input_data;
+                    const char* d;
 
                     try {
-                        // size is encoded in network byte order
-                        const std::string input_data{read_from_input_queue(sizeof(size))};
-                        const char* d = input_data.data();
-                        size = (static_cast<uint32_t>(d[3])) |
-                               (static_cast<uint32_t>(d[2]) <<  8U) |
-                               (static_cast<uint32_t>(d[1]) << 16U) |
-                               (static_cast<uint32_t>(d[0]) << 24U);
+                        if (mapped_input()) {
+                            d = read_from_mapped_input(sizeof(uint32_t)).data();
+                        } else {
+                            input_data = read_from_input_queue(sizeof(uint32_t));
+                            d = input_data.data();
+                        }
                     } catch (const osmium::pbf_error&) {
                         return 0; // EOF
                     }
 
-                    if (size > static_cast<uint32_t>(max_blob_header_size)) {
-                        throw osmium::pbf_error{"invalid BlobHeader size (> max_blob_header_size)"};
-                    }
-
-                    return size;
+                    return decode_blob_header_size(d);
                 }
 
                 /**
-                 * Decode the BlobHeader. Make sure it contains the expected
-                 * type. Return the size of the following Blob.
+                 * Read the BlobHeader and check that it has the expected
+                 * type. If blob_info is not nullptr, the indexdata from
+                 * the BlobHeader (if written by Osmium) is decoded into it.
+                 *
+                 * @returns The size of the following Blob or 0 on EOF.
                  */
-                static size_t decode_blob_header(protozero::pbf_message<FileFormat::BlobHeader>&& pbf_blob_header, const char* expected_type) {
-                    protozero::data_view blob_header_type;
-                    size_t blob_header_datasize = 0;
-
-                    while (pbf_blob_header.next()) {
-                        switch (pbf_blob_header.tag_and_type()) {
-                            case protozero::tag_and_type(FileFormat::BlobHeader::required_string_type, protozero::pbf_wire_type::length_delimited):
-                                blob_header_type = pbf_blob_header.get_view();
-                                break;
-                            case protozero::tag_and_type(FileFormat::BlobHeader::required_int32_datasize, protozero::pbf_wire_type::varint):
-                                blob_header_datasize = pbf_blob_header.get_int32();
-                                break;
-                            default:
-                                pbf_blob_header.skip();
-                        }
-                    }
+                size_t check_type_and_get_blob_size(const char* expected_type, pbf_blob_index_entry* blob_info = nullptr) {
+                    assert(expected_type);
 
-                    if (blob_header_datasize == 0) {
-                        throw osmium::pbf_error{"PBF format error: BlobHeader.datasize missing or zero."};
+                    const auto size = read_blob_header_size_from_file();
+                    if (size == 0) { // EOF
+                        return 0;
                     }
 
-                    if (std::strncmp(expected_type, blob_header_type.data(), blob_header_type.size()) != 0) {
-                        throw osmium::pbf_error{"blob does not have expected type (OSMHeader in first blob, OSMData in following blobs)"};
+                    std::string blob_header;
+                    data_view blob_header_data;
+                    if (mapped_input()) {
+                        blob_header_data = read_from_mapped_input(size);
+                    } else {
+                        blob_header = read_from_input_queue(size);
+                        blob_header_data = data_view{blob_header.data(), blob_header.size()};
                     }
 
-                    return blob_header_datasize;
-                }
-
-                size_t check_type_and_get_blob_size(const char* expected_type) {
-                    assert(expected_type);
+                    data_view index_data;
+                    const auto blob_size = decode_blob_header(protozero::pbf_message<FileFormat::BlobHeader>(blob_header_data), expected_type, &index_data);
 
-                    const auto size = read_blob_header_size_from_file();
-                    if (size == 0) { // EOF
-                        return 0;
+                    if (blob_info) {
+                        *blob_info = pbf_blob_index_entry{};
+                        if (!index_data.empty()) {
+                            decode_blob_index_data(index_data, *blob_info);
+                        }
                     }
 
-                    const std::string blob_header{read_from_input_queue(size)};
+                    return blob_size;
+                }
 
-                    return decode_blob_header(protozero::pbf_message<FileFormat::BlobHeader>(blob_header), expected_type);
+                // If the indexdata in the BlobHeader tells us which entity
+                // types are in the blob, we can skip blobs without any
+                // types we are interested in without decompressing them.
+                bool can_skip_blob(const pbf_blob_index_entry& blob_info) const noexcept {
+                    return blob_info.types != osmium::osm_entity_bits::nothing &&
+                           (blob_info.types & read_types()) == 0;
                 }
 
-                std::string read_from_input_queue_with_check(size_t size) {
+                static void check_blob_size(size_t size) {
                     if (size > max_uncompressed_blob_size) {
                         throw osmium::pbf_error{std::string{"invalid blob size: "} +
                                                 std::to_string(size)};
                     }
+                }
+
+                std::string read_from_input_queue_with_check(size_t size) {
+                    check_blob_size(size);
                     return read_from_input_queue(size);
                 }
 
+                data_view read_from_mapped_input_with_check(size_t size) {
+                    check_blob_size(size);
+                    return read_from_mapped_input(size);
+                }
+
                 // Parse the header in the PBF OSMHeader blob.
                 void parse_header_blob() {
                     const auto size = check_type_and_get_blob_size("OSMHeader");
-                    osmium::io::Header header{decode_header(read_from_input_queue_with_check(size))};
-                    set_header_value(header);
+                    if (mapped_input()) {
+                        set_header_value(decode_header(read_from_mapped_input_with_check(size)));
+                    } else {
+                        set_header_value(decode_header(read_from_input_queue_with_check(size)));
+                    }
                 }
 
-                void parse_data_blobs() {
-                    while (const auto size = check_type_and_get_blob_size("OSMData")) {
-                        std::string input_buffer{read_from_input_queue_with_check(size)};
+                void decode_data_blob(PBFDataBlobDecoder&& data_blob_parser) {
+                    if (osmium::config::use_pool_threads_for_pbf_parsing()) {
+                        send_to_output_queue(submit_to_pool(std::move(data_blob_parser)));
+                    } else {
+                        send_to_output_queue(data_blob_parser());
+                    }
+                }
 
-                        PBFDataBlobDecoder data_blob_parser{std::move(input_buffer), read_types(), read_metadata()};
+                // Decode only the blobs listed in the blob index.
+                void parse_indexed_data_blobs() {
+                    if (!mapped_input()) {
+                        throw osmium::io_error{"Reading with a PBF blob index only works on uncompressed PBF files with file option pbf_mmap=true"};
+                    }
 
-                        if (osmium::config::use_pool_threads_for_pbf_parsing()) {
-                            send_to_output_queue(get_pool().submit(std::move(data_blob_parser)));
+                    const auto& input = *mapped_input();
+                    if (blob_index()->file_size() != input.size()) {
+                        throw osmium::io_error{"PBF blob index does not match input file"};
+                    }
+
+                    for (const auto& entry : *blob_index()) {
+                        if (entry.offset > input.size() || input.size() - entry.offset < entry.size) {
+                            throw osmium::io_error{"PBF blob index does not match input file"};
+                        }
+                        check_blob_size(entry.size);
+                        m_mapped_offset = entry.offset + entry.size;
+                        mapped_input()->set_offset(m_mapped_offset);
+                        decode_data_blob(PBFDataBlobDecoder{mapped_input(), data_view{input.data() + entry.offset, entry.size}, read_types(), read_metadata(), buffer_pool()});
+                    }
+                }
+
+                void parse_data_blobs() {
+                    pbf_blob_index_entry blob_info;
+                    while (const auto size = check_type_and_get_blob_size("OSMData", &blob_info)) {
+                        if (can_skip_blob(blob_info)) {
+                            if (mapped_input()) {
+                                read_from_mapped_input_with_check(size);
+                            } else {
+                                read_from_input_queue_with_check(size);
+                            }
+                        } else if (mapped_input()) {
+                            decode_data_blob(PBFDataBlobDecoder{mapped_input(), read_from_mapped_input_with_check(size), read_types(), read_metadata(), buffer_pool()});
                         } else {
-                            send_to_output_queue(data_blob_parser());
+                            decode_data_blob(PBFDataBlobDecoder{read_from_input_queue_with_check(size), read_types(), read_metadata(), buffer_pool()});
                         }
                     }
                 }
@@ -211,7 +282,11 @@ namespace osmium {
                     parse_header_blob();
 
                     if (read_types() != osmium::osm_entity_bits::nothing) {
-                        parse_data_blobs();
+                        if (blob_index()) {
+                            parse_indexed_data_blobs();
+                        } else {
+                            parse_data_blobs();
+                        }
                     }
                 }
 
@@ -230,8 +305,96 @@ namespace osmium {
                 return registered_pbf_parser;
             }
 
+            inline void add_to_blob_index_entry(pbf_blob_index_entry& entry, const osmium::memory::Buffer& buffer) {
+                for (auto it = buffer.cbegin<osmium::OSMObject>(); it != buffer.cend<osmium::OSMObject>(); ++it) {
+                    entry.add(osmium::osm_entity_bits::from_item_type(it->type()), it->id());
+                }
+            }
+
         } // namespace detail
 
+        /**
+         * Create an index of all OSMData blobs in a PBF file. Blobs are
+         * decoded (on the thread pool) to find out which entities are in
+         * them unless the file was written with the "pbf_add_index_data"
+         * option in which case the information is taken from the
+         * BlobHeaders. See PBFBlobIndex for how to use the index.
+         *
+         * @param filename Name of the PBF file. It must not be compressed
+         *                 (other than the compression inside the blobs).
+         * @param pool Thread pool to use for decoding the blobs.
+         * @returns The index.
+         * @throws osmium::pbf_error If the file can not be parsed.
+         * @throws std::system_error If the file can not be opened or mapped.
+         */
+        inline PBFBlobIndex build_pbf_blob_index(const std::string& filename, osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) {
+            const int fd = detail::open_for_reading(filename);
+            const auto file_size = osmium::file_size(fd);
+            if (file_size == 0) {
+                detail::reliable_close(fd);
+                throw osmium::pbf_error{"empty file"};
+            }
+            const auto input = std::make_shared<detail::MappedInput>(fd, file_size);
+            detail::reliable_close(fd);
+
+            std::vector<std::future<pbf_blob_index_entry>> futures;
+
+            const char* const data = input->data();
+            std::size_t offset = 0;
+            bool header_done = false;
+            while (file_size - offset >= sizeof(uint32_t)) {
+                const auto header_size = detail::decode_blob_header_size(data + offset);
+                offset += sizeof(uint32_t);
+                if (file_size - offset < header_size) {
+                    throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                }
+
+                detail::data_view index_data;
+                const auto blob_size = detail::decode_blob_header(protozero::pbf_message<detail::FileFormat::BlobHeader>{data + offset, header_size}, header_done ? "OSMData" : "OSMHeader", &index_data);
+                offset += header_size;
+                if (blob_size > detail::max_uncompressed_blob_size) {
+                    throw osmium::pbf_error{std::string{"invalid blob size: "} + std::to_string(blob_size)};
+                }
+                if (file_size - offset < blob_size) {
+                    throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                }
+
+                if (!header_done) {
+                    header_done = true;
+                } else {
+                    const detail::data_view blob{data + offset, blob_size};
+                    pbf_blob_index_entry entry{offset, static_cast<uint32_t>(blob_size)};
+                    if (!index_data.empty() && detail::decode_blob_index_data(index_data, entry)) {
+                        // BlobHeader tells us what's in the blob, no need to decode it
+                        std::promise<pbf_blob_index_entry> promise;
+                        futures.push_back(promise.get_future());
+                        promise.set_value(entry);
+                    } else {
+                        futures.push_back(pool.submit([input, blob, entry]() {
+                            std::string output;
+                            detail::PBFPrimitiveBlockDecoder decoder{detail::decode_blob(blob, output), osmium::osm_entity_bits::all, osmium::io::read_meta::no};
+                            auto buffer = decoder();
+
+                            pbf_blob_index_entry result{entry};
+                            while (buffer.has_nested_buffers()) {
+                                detail::add_to_blob_index_entry(result, *buffer.get_last_nested());
+                            }
+                            detail::add_to_blob_index_entry(result, buffer);
+                            return result;
+                        }));
+                    }
+                }
+                offset += blob_size;
+            }
+
+            PBFBlobIndex index{file_size};
+            for (auto& future : futures) {
+                index.add(future.get());
+            }
+
+            return index;
+        }
+
     } // namespace io
 
 } // namespace osmium
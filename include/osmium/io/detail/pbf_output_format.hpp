@@ -40,12 +40,20 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/detail/queue_util.hpp>
 #include <osmium/io/detail/string_table.hpp>
 #include <osmium/io/detail/zlib.hpp>
+#ifdef OSMIUM_WITH_LZ4
+# include <osmium/io/detail/lz4.hpp>
+#endif
+#ifdef OSMIUM_WITH_ZSTD
+# include <osmium/io/detail/zstd.hpp>
+#endif
 #include <osmium/io/file.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/pbf_blob_index.hpp>
 #include <osmium/memory/buffer.hpp>
 #include <osmium/memory/item_iterator.hpp>
 #include <osmium/osm/box.hpp>
+#include <osmium/osm/entity_bits.hpp>
 #include <osmium/osm/item_type.hpp>
 #include <osmium/osm/location.hpp>
 #include <osmium/osm/metadata_options.hpp>
@@ -71,6 +79,7 @@ DEALINGS IN THE SOFTWARE.
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -81,6 +90,14 @@ namespace osmium {
 
         namespace detail {
 
+            /// Compression used for the blobs in a PBF file.
+            enum class pbf_compression {
+                none = 0,
+                zlib = 1,
+                lz4  = 2, // only available if compiled with OSMIUM_WITH_LZ4
+                zstd = 3  // only available if compiled with OSMIUM_WITH_ZSTD
+            };
+
             struct pbf_output_options {
 
                 /// Which metadata of objects should be added?
@@ -90,14 +107,24 @@ namespace osmium {
                 bool use_dense_nodes = true;
 
                 /**
-                 * Should the PBF blobs contain zlib compressed data?
+                 * How should the PBF blobs be compressed?
                  *
-                 * The zlib compression is optional, it's possible to store the
+                 * The compression is optional, it's possible to store the
                  * blobs in raw format. Disabling the compression can improve
                  * the writing speed a little but the output will be 2x to 3x
-                 * bigger.
+                 * bigger. Zstandard and LZ4 compressed blobs are much faster
+                 * to decompress than zlib compressed ones, but not all
+                 * programs can read them.
+                 */
+                pbf_compression compression = pbf_compression::zlib;
+
+                /**
+                 * Compression level. 0 means the default level of the
+                 * compression library. Use 1 for fastest compression. For
+                 * LZ4 0 means the fast compressor, 1 to 12 the LZ4 HC
+                 * compressor.
                  */
-                bool use_compression = true;
+                int compression_level = 0;
 
                 /// Add the "HistoricalInformation" header flag.
                 bool add_historical_information_flag = false;
@@ -108,6 +135,14 @@ namespace osmium {
                 /// Should node locations be added to ways?
                 bool locations_on_ways = false;
 
+                /**
+                 * Should the types and ID range of the objects in each
+                 * blob be written into the indexdata field of the
+                 * BlobHeader? Readers can use this to skip blobs without
+                 * decompressing them.
+                 */
+                bool add_index_data = false;
+
             }; // struct pbf_output_options
 
             /**
@@ -148,7 +183,11 @@ namespace osmium {
 
                 pbf_blob_type m_blob_type;
 
-                bool m_use_compression;
+                pbf_compression m_compression;
+
+                int m_compression_level;
+
+                std::string m_index_data;
 
             public:
 
@@ -157,13 +196,17 @@ namespace osmium {
                  *
                  * @param msg Protobuf-message containing the blob data
                  * @param type Type of blob.
-                 * @param use_compression Should the output be compressed using
-                 *        zlib?
+                 * @param compression Compression to use for the blob.
+                 * @param compression_level Compression level (0 = default).
+                 * @param index_data Content for the indexdata field of the
+                 *        BlobHeader. Not written if empty.
                  */
-                SerializeBlob(std::string&& msg, pbf_blob_type type, bool use_compression) :
+                SerializeBlob(std::string&& msg, pbf_blob_type type, pbf_compression compression, int compression_level, std::string&& index_data = std::string{}) :
                     m_msg(std::move(msg)),
                     m_blob_type(type),
-                    m_use_compression(use_compression) {
+                    m_compression(compression),
+                    m_compression_level(compression_level),
+                    m_index_data(std::move(index_data)) {
                 }
 
                 /**
@@ -177,11 +220,29 @@ namespace osmium {
                     std::string blob_data;
                     protozero::pbf_builder<FileFormat::Blob> pbf_blob{blob_data};
 
-                    if (m_use_compression) {
-                        pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, int32_t(m_msg.size()));
-                        pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_zlib_data, osmium::io::detail::zlib_compress(m_msg));
-                    } else {
-                        pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_raw, m_msg);
+                    switch (m_compression) {
+                        case pbf_compression::none:
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_raw, m_msg);
+                            break;
+                        case pbf_compression::zlib:
+                            pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, int32_t(m_msg.size()));
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_zlib_data, osmium::io::detail::zlib_compress(m_msg, m_compression_level));
+                            break;
+#ifdef OSMIUM_WITH_LZ4
+                        case pbf_compression::lz4:
+                            pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, int32_t(m_msg.size()));
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_lz4_data, osmium::io::detail::lz4_compress(m_msg, m_compression_level));
+                            break;
+#endif
+#ifdef OSMIUM_WITH_ZSTD
+                        case pbf_compression::zstd:
+                            pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, int32_t(m_msg.size()));
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_zstd_data, osmium::io::detail::zstd_compress(m_msg, m_compression_level == 0 ? ZSTD_CLEVEL_DEFAULT : m_compression_level));
+                            break;
+#endif
+                        default:
+                            // checked in PBFOutputFormat constructor
+                            assert(false);
                     }
 
                     std::string blob_header_data;
@@ -189,11 +250,16 @@ namespace osmium {
 
                     pbf_blob_header.add_string(FileFormat::BlobHeader::required_string_type, m_blob_type == pbf_blob_type::data ? "OSMData" : "OSMHeader");
 
+                    if (!m_index_data.empty()) {
+                        pbf_blob_header.add_bytes(FileFormat::BlobHeader::optional_bytes_indexdata, m_index_data);
+                    }
+
                     // The static_cast is okay, because the size can never
                     // be much larger than max_uncompressed_blob_size. This
-                    // is due to the assert above and the fact that the zlib
-                    // library will not grow deflated data beyond the original
-                    // data plus a few header bytes (https://zlib.net/zlib_tech.html).
+                    // is due to the assert above and the fact that the
+                    // compression libraries will not grow compressed data
+                    // much beyond the original data plus a few header bytes
+                    // (https://zlib.net/zlib_tech.html).
                     pbf_blob_header.add_int32(FileFormat::BlobHeader::required_int32_datasize, static_cast<int32_t>(blob_data.size()));
 
                     const auto size = static_cast<uint32_t>(blob_header_data.size());
@@ -367,6 +433,7 @@ namespace osmium {
                 DenseNodes m_dense_nodes;
                 OSMFormat::PrimitiveGroup m_type = OSMFormat::PrimitiveGroup::unknown;
                 int m_count = 0;
+                pbf_blob_index_entry m_index_entry{};
 
             public:
 
@@ -388,6 +455,7 @@ namespace osmium {
                     m_dense_nodes.clear();
                     m_type = type;
                     m_count = 0;
+                    m_index_entry = pbf_blob_index_entry{};
                 }
 
                 void write_stringtable(protozero::pbf_builder<OSMFormat::StringTable>& pbf_string_table) {
@@ -420,6 +488,23 @@ namespace osmium {
                     return static_cast<uint32_t>(m_stringtable.add(s));
                 }
 
+                void add_to_index(osmium::osm_entity_bits::type type, osmium::object_id_type id) noexcept {
+                    m_index_entry.add(type, id);
+                }
+
+                /// Encode types and ID range of this block for the BlobHeader.
+                std::string index_data() const {
+                    std::string data;
+                    protozero::pbf_builder<FileFormat::IndexData> pbf_index_data{data};
+
+                    pbf_index_data.add_string(FileFormat::IndexData::required_string_format, pbf_index_data_format());
+                    pbf_index_data.add_uint32(FileFormat::IndexData::optional_uint32_types, static_cast<uint32_t>(m_index_entry.types));
+                    pbf_index_data.add_sint64(FileFormat::IndexData::optional_sint64_min_id, m_index_entry.min_id);
+                    pbf_index_data.add_sint64(FileFormat::IndexData::optional_sint64_max_id, m_index_entry.max_id);
+
+                    return data;
+                }
+
                 int count() const noexcept {
                     return m_count;
                 }
@@ -478,7 +563,9 @@ namespace osmium {
                     m_output_queue.push(m_pool.submit(
                         SerializeBlob{std::move(primitive_block_data),
                                       pbf_blob_type::data,
-                                      m_options.use_compression}
+                                      m_options.compression,
+                                      m_options.compression_level,
+                                      m_options.add_index_data ? m_primitive_block.index_data() : std::string{}}
                     ));
                 }
 
@@ -524,6 +611,68 @@ namespace osmium {
                     }
                 }
 
+                static pbf_compression get_compression(const std::string& value) {
+                    if (value.empty() || value == "true" || value == "yes" || value == "zlib") {
+                        return pbf_compression::zlib;
+                    }
+                    if (value == "none" || value == "false" || value == "no") {
+                        return pbf_compression::none;
+                    }
+                    if (value == "lz4") {
+#ifdef OSMIUM_WITH_LZ4
+                        return pbf_compression::lz4;
+#else
+                        throw std::invalid_argument{"PBF compression 'lz4' not available (compile with OSMIUM_WITH_LZ4)"};
+#endif
+                    }
+                    if (value == "zstd") {
+#ifdef OSMIUM_WITH_ZSTD
+                        return pbf_compression::zstd;
+#else
+                        throw std::invalid_argument{"PBF compression 'zstd' not available (compile with OSMIUM_WITH_ZSTD)"};
+#endif
+                    }
+                    throw std::invalid_argument{"Unknown value for 'pbf_compression' option: '" + value + "'"};
+                }
+
+                static int get_compression_level(const std::string& value, pbf_compression compression) {
+                    if (value.empty()) {
+                        return 0;
+                    }
+
+                    char* end = nullptr;
+                    const auto level = std::strtol(value.c_str(), &end, 10);
+                    if (end == nullptr || *end != '\0' || level < 0 || level > 100) {
+                        throw std::invalid_argument{"Invalid value for 'pbf_compression_level' option: '" + value + "'"};
+                    }
+
+                    switch (compression) {
+                        case pbf_compression::zlib:
+                            if (level > zlib_max_compression_level()) {
+                                throw std::invalid_argument{"The 'pbf_compression_level' for zlib must be between 0 and " + std::to_string(zlib_max_compression_level())};
+                            }
+                            break;
+#ifdef OSMIUM_WITH_LZ4
+                        case pbf_compression::lz4:
+                            if (level > LZ4HC_CLEVEL_MAX) {
+                                throw std::invalid_argument{"The 'pbf_compression_level' for lz4 must be between 0 and " + std::to_string(LZ4HC_CLEVEL_MAX)};
+                            }
+                            break;
+#endif
+#ifdef OSMIUM_WITH_ZSTD
+                        case pbf_compression::zstd:
+                            if (level > ::ZSTD_maxCLevel()) {
+                                throw std::invalid_argument{"The 'pbf_compression_level' for zstd must be between 0 and " + std::to_string(::ZSTD_maxCLevel())};
+                            }
+                            break;
+#endif
+                        default:
+                            throw std::invalid_argument{"The 'pbf_compression_level' option can not be used without compression"};
+                    }
+
+                    return static_cast<int>(level);
+                }
+
                 void switch_primitive_block_type(OSMFormat::PrimitiveGroup type) {
                     if (!m_primitive_block.can_add(type)) {
                         store_primitive_block();
@@ -542,11 +691,13 @@ namespace osmium {
                     }
 
                     m_options.use_dense_nodes = file.is_not_false("pbf_dense_nodes");
-                    m_options.use_compression = file.get("pbf_compression") != "none" && file.is_not_false("pbf_compression");
+                    m_options.compression = get_compression(file.get("pbf_compression"));
+                    m_options.compression_level = get_compression_level(file.get("pbf_compression_level"), m_options.compression);
                     m_options.add_metadata = osmium::metadata_options{file.get("add_metadata")};
                     m_options.add_historical_information_flag = file.has_multiple_object_versions();
                     m_options.add_visible_flag = file.has_multiple_object_versions();
                     m_options.locations_on_ways = file.is_true("locations_on_ways");
+                    m_options.add_index_data = file.is_true("pbf_add_index_data");
                 }
 
                 void write_header(const osmium::io::Header& header) final {
@@ -602,7 +753,8 @@ namespace osmium {
                     m_output_queue.push(m_pool.submit(
                         SerializeBlob{std::move(data),
                                       pbf_blob_type::header,
-                                      m_options.use_compression}
+                                      m_options.compression,
+                                      m_options.compression_level}
                         ));
                 }
 
@@ -617,11 +769,13 @@ namespace osmium {
                 void node(const osmium::Node& node) {
                     if (m_options.use_dense_nodes) {
                         switch_primitive_block_type(OSMFormat::PrimitiveGroup::optional_DenseNodes_dense);
+                        m_primitive_block.add_to_index(osmium::osm_entity_bits::node, node.id());
                         m_primitive_block.add_dense_node(node);
                         return;
                     }
 
                     switch_primitive_block_type(OSMFormat::PrimitiveGroup::repeated_Node_nodes);
+                    m_primitive_block.add_to_index(osmium::osm_entity_bits::node, node.id());
                     protozero::pbf_builder<OSMFormat::Node> pbf_node{m_primitive_block.group(), OSMFormat::PrimitiveGroup::repeated_Node_nodes};
 
                     pbf_node.add_sint64(OSMFormat::Node::required_sint64_id, node.id());
@@ -633,6 +787,7 @@ namespace osmium {
 
                 void way(const osmium::Way& way) {
                     switch_primitive_block_type(OSMFormat::PrimitiveGroup::repeated_Way_ways);
+                    m_primitive_block.add_to_index(osmium::osm_entity_bits::way, way.id());
                     protozero::pbf_builder<OSMFormat::Way> pbf_way{m_primitive_block.group(), OSMFormat::PrimitiveGroup::repeated_Way_ways};
 
                     pbf_way.add_int64(OSMFormat::Way::required_int64_id, way.id());
@@ -666,6 +821,7 @@ namespace osmium {
 
                 void relation(const osmium::Relation& relation) {
                     switch_primitive_block_type(OSMFormat::PrimitiveGroup::repeated_Relation_relations);
+                    m_primitive_block.add_to_index(osmium::osm_entity_bits::relation, relation.id());
                     protozero::pbf_builder<OSMFormat::Relation> pbf_relation{m_primitive_block.group(), OSMFormat::PrimitiveGroup::repeated_Relation_relations};
 
                     pbf_relation.add_int64(OSMFormat::Relation::required_int64_id, relation.id());
@@ -50,7 +50,9 @@ namespace osmium {
                     optional_bytes_raw       = 1,
                     optional_int32_raw_size  = 2,
                     optional_bytes_zlib_data = 3,
-                    optional_bytes_lzma_data = 4
+                    optional_bytes_lzma_data = 4,
+                    optional_bytes_lz4_data  = 6,
+                    optional_bytes_zstd_data = 7
                 };
 
                 enum class BlobHeader : protozero::pbf_tag_type {
@@ -59,6 +61,16 @@ namespace osmium {
                     required_int32_datasize  = 3
                 };
 
+                // Not part of the OSM PBF format specification. This is
+                // the content Osmium writes into the BlobHeader indexdata
+                // field if the "pbf_add_index_data" option is set.
+                enum class IndexData : protozero::pbf_tag_type {
+                    required_string_format = 1,
+                    optional_uint32_types  = 2,
+                    optional_sint64_min_id = 3,
+                    optional_sint64_max_id = 4
+                };
+
             } // namespace FileFormat
 
             // directly translated from
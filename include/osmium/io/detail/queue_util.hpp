@@ -37,8 +37,12 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/thread/queue.hpp>
 
 #include <cassert>
+#include <condition_variable>
+#include <cstddef>
 #include <exception>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -97,6 +101,76 @@ namespace osmium {
                 return !buffer;
             }
 
+            /**
+             * Counts how many tasks have finished. Used by the Reader in
+             * unordered mode to wait until any buffer decoded on the
+             * thread pool is ready instead of waiting for a specific one.
+             */
+            class completion_signal {
+
+                std::mutex m_mutex{};
+                std::condition_variable m_cv{};
+                std::size_t m_count = 0;
+
+            public:
+
+                void notify() {
+                    {
+                        const std::lock_guard<std::mutex> lock{m_mutex};
+                        ++m_count;
+                    }
+                    m_cv.notify_all();
+                }
+
+                std::size_t count() {
+                    const std::lock_guard<std::mutex> lock{m_mutex};
+                    return m_count;
+                }
+
+                /// Wait until notify() has been called after count() returned count.
+                void wait_for_change(std::size_t count) {
+                    std::unique_lock<std::mutex> lock{m_mutex};
+                    m_cv.wait(lock, [&]() {
+                        return m_count != count;
+                    });
+                }
+
+            }; // class completion_signal
+
+            /**
+             * Wraps a task creating a buffer so that it can be run on the
+             * thread pool and notifies the completion_signal after the
+             * result is available in the future.
+             */
+            template <typename TFunc>
+            class signalling_task {
+
+                TFunc m_func;
+                std::promise<osmium::memory::Buffer> m_promise{};
+                std::shared_ptr<completion_signal> m_signal;
+
+            public:
+
+                signalling_task(TFunc func, std::shared_ptr<completion_signal> signal) :
+                    m_func(std::move(func)),
+                    m_signal(std::move(signal)) {
+                }
+
+                std::future<osmium::memory::Buffer> get_future() {
+                    return m_promise.get_future();
+                }
+
+                void operator()() {
+                    try {
+                        m_promise.set_value(m_func());
+                    } catch (...) {
+                        m_promise.set_exception(std::current_exception());
+                    }
+                    m_signal->notify();
+                }
+
+            }; // class signalling_task
+
             template <typename T>
             class queue_wrapper {
 
@@ -134,6 +208,39 @@ namespace osmium {
                     return m_has_reached_end_of_data;
                 }
 
+                /**
+                 * Get the next future from the queue without waiting for
+                 * its result. Returns false if the queue is empty or the
+                 * end of data has been reached.
+                 *
+                 * If you use this you have to call set_end_of_data() once
+                 * you see the end of data marker in the result.
+                 */
+                bool try_pop_future(std::future<T>& data_future) {
+                    if (m_has_reached_end_of_data) {
+                        return false;
+                    }
+                    return m_queue.try_pop(data_future);
+                }
+
+                /**
+                 * Like try_pop_future() but waits until there is a future
+                 * in the queue.
+                 *
+                 * @pre !has_reached_end_of_data()
+                 */
+                std::future<T> wait_and_pop_future() {
+                    assert(!m_has_reached_end_of_data);
+                    std::future<T> data_future;
+                    m_queue.wait_and_pop(data_future);
+                    assert(data_future.valid());
+                    return data_future;
+                }
+
+                void set_end_of_data() noexcept {
+                    m_has_reached_end_of_data = true;
+                }
+
                 T pop() {
                     T data;
                     if (!m_has_reached_end_of_data) {
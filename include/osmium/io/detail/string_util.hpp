@@ -253,6 +253,30 @@ namespace osmium {
                 }
             }
 
+            inline void append_json_encoded_string(std::string& out, const char* data) {
+                static const char* lookup_hex = "0123456789abcdef";
+
+                for (; *data != '\0'; ++data) {
+                    switch (*data) {
+                        case '"':  out += "\\\"";  break;
+                        case '\\': out += "\\\\"; break;
+                        case '\b': out += "\\b";  break;
+                        case '\f': out += "\\f";  break;
+                        case '\n': out += "\\n";  break;
+                        case '\r': out += "\\r";  break;
+                        case '\t': out += "\\t";  break;
+                        default:
+                            if (static_cast<unsigned char>(*data) < 0x20U) {
+                                out += "\\u00";
+                                append_2_hex_digits(out, static_cast<unsigned char>(*data), lookup_hex);
+                            } else {
+                                out += *data;
+                            }
+                            break;
+                    }
+                }
+            }
+
             inline void append_debug_encoded_string(std::string& out, const char* data, const char* prefix, const char* suffix) {
                 static const char* lookup_hex = "0123456789ABCDEF";
                 const char* end = data + std::strlen(data);
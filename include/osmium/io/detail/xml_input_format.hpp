@@ -37,6 +37,7 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/builder/osm_object_builder.hpp>
 #include <osmium/io/detail/input_format.hpp>
 #include <osmium/io/detail/queue_util.hpp>
+#include <osmium/io/detail/xml_splitter.hpp>
 #include <osmium/io/error.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
@@ -55,10 +56,14 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/osm/types_from_string.hpp>
 #include <osmium/osm/way.hpp>
 #include <osmium/thread/util.hpp>
+#include <osmium/util/compatibility.hpp>
+#include <osmium/util/config.hpp>
 
 #include <expat.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <exception>
 #include <future>
@@ -66,6 +71,7 @@ DEALINGS IN THE SOFTWARE.
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace osmium {
 
@@ -125,7 +131,441 @@ namespace osmium {
 
         namespace detail {
 
-            class XMLParser : public Parser {
+            /**
+             * Where the data in a chunk created by the XMLSplitter came
+             * from in the original document. The chunk starts with offset
+             * bytes of added markup (all on the first line), the rest is
+             * copied from the document starting at the given line and
+             * column.
+             */
+            struct xml_document_position {
+
+                std::size_t offset = 0;
+                uint64_t line = 1;
+                uint64_t column = 0;
+
+                /// Convert line and column in the chunk to the document.
+                void to_document(uint64_t& chunk_line, uint64_t& chunk_column) const noexcept {
+                    if (chunk_line == 1) {
+                        chunk_column = column + (chunk_column > offset ? chunk_column - offset : 0);
+                        chunk_line = line;
+                    } else {
+                        chunk_line += line - 1;
+                    }
+                }
+
+            }; // struct xml_document_position
+
+            /**
+             * A small non-validating XML parser for the subset of XML used
+             * in OSM files. It is an alternative to Expat for complete
+             * documents in memory, such as the chunks created when the
+             * input is split at top-level objects.
+             *
+             * The document is modified in place: Names and attribute values
+             * are null-terminated and entities are decoded where they are,
+             * so the handler gets pointers into the document and nothing
+             * is copied. The handler gets the same calls as from Expat:
+             * start_element(name, attrs), end_element(name), and
+             * characters(text, len).
+             *
+             * Comments, processing instructions, and CDATA sections are
+             * understood, DOCTYPE declarations are not. There are no checks
+             * for invalid characters in names or duplicate attributes.
+             */
+            template <typename THandler>
+            class XMLPullParser {
+
+                THandler& m_handler;
+
+                char* m_begin = nullptr;
+                char* m_end = nullptr;
+
+                std::vector<const char*> m_attrs{};
+                std::vector<const char*> m_elements{};
+
+                bool m_root_seen = false;
+
+                xml_document_position m_position{};
+
+                static bool is_space(const char c) noexcept {
+                    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+                }
+
+                static bool is_name_end(const char c) noexcept {
+                    return is_space(c) || c == '/' || c == '>' || c == '=' || c == '\0';
+                }
+
+                OSMIUM_NORETURN void error(const char* pos, const char* message) const {
+                    uint64_t line = 1;
+                    const char* line_start = m_begin;
+                    for (const char* p = m_begin; p < pos; ++p) {
+                        if (*p == '\n') {
+                            ++line;
+                            line_start = p + 1;
+                        }
+                    }
+                    auto column = static_cast<uint64_t>(pos - line_start);
+                    m_position.to_document(line, column);
+
+                    osmium::xml_error e{std::string{"XML parsing error at line "}
+                                        + std::to_string(line)
+                                        + ", column "
+                                        + std::to_string(column)
+                                        + ": "
+                                        + message};
+                    e.line = line;
+                    e.column = column;
+                    throw e;
+                }
+
+                char* skip_space(char* p) const noexcept {
+                    while (p < m_end && is_space(*p)) {
+                        ++p;
+                    }
+                    return p;
+                }
+
+                char* skip_name(char* p) const noexcept {
+                    while (p < m_end && !is_name_end(*p)) {
+                        ++p;
+                    }
+                    return p;
+                }
+
+                // Returns a pointer to the first character after the
+                // marker or throws if the marker isn't found.
+                char* skip_after(char* p, const char* marker) const {
+                    const auto len = std::strlen(marker);
+                    char* end = std::search(p, m_end, marker, marker + len);
+                    if (end == m_end) {
+                        error(p, "unclosed token");
+                    }
+                    return end + len;
+                }
+
+                static void append_utf8(char*& out, const uint32_t c) noexcept {
+                    if (c < 0x80U) {
+                        *out++ = static_cast<char>(c);
+                    } else if (c < 0x800U) {
+                        *out++ = static_cast<char>(0xc0U | (c >> 6U));
+                        *out++ = static_cast<char>(0x80U | (c & 0x3fU));
+                    } else if (c < 0x10000U) {
+                        *out++ = static_cast<char>(0xe0U | (c >> 12U));
+                        *out++ = static_cast<char>(0x80U | ((c >> 6U) & 0x3fU));
+                        *out++ = static_cast<char>(0x80U | (c & 0x3fU));
+                    } else {
+                        *out++ = static_cast<char>(0xf0U | (c >> 18U));
+                        *out++ = static_cast<char>(0x80U | ((c >> 12U) & 0x3fU));
+                        *out++ = static_cast<char>(0x80U | ((c >> 6U) & 0x3fU));
+                        *out++ = static_cast<char>(0x80U | (c & 0x3fU));
+                    }
+                }
+
+                // Decode the entity or character reference starting at p
+                // (which points to the '&') and write the result to out.
+                // The result is never longer than the reference. Returns
+                // a pointer to the first character after the reference.
+                char* decode_reference(char* p, char* end, char*& out) const {
+                    char* const start = p;
+                    ++p;
+                    char* const semicolon = std::find(p, end, ';');
+                    if (semicolon == end) {
+                        error(start, "not well-formed (invalid token)");
+                    }
+                    const auto len = semicolon - p;
+
+                    if (*p == '#') {
+                        ++p;
+                        uint32_t c = 0;
+                        const bool hex = (*p == 'x');
+                        if (hex) {
+                            ++p;
+                        }
+                        if (p == semicolon) {
+                            error(start, "not well-formed (invalid token)");
+                        }
+                        for (; p < semicolon; ++p) {
+                            uint32_t digit = 0;
+                            if (*p >= '0' && *p <= '9') {
+                                digit = static_cast<uint32_t>(*p - '0');
+                            } else if (hex && *p >= 'a' && *p <= 'f') {
+                                digit = static_cast<uint32_t>(*p - 'a' + 10);
+                            } else if (hex && *p >= 'A' && *p <= 'F') {
+                                digit = static_cast<uint32_t>(*p - 'A' + 10);
+                            } else {
+                                error(start, "not well-formed (invalid token)");
+                            }
+                            c = c * (hex ? 16U : 10U) + digit;
+                            if (c > 0x10ffffU) {
+                                error(start, "reference to invalid character number");
+                            }
+                        }
+                        if (c == 0 || (c >= 0xd800U && c <= 0xdfffU)) {
+                            error(start, "reference to invalid character number");
+                        }
+                        append_utf8(out, c);
+                    } else if (len == 2 && p[0] == 'l' && p[1] == 't') {
+                        *out++ = '<';
+                    } else if (len == 2 && p[0] == 'g' && p[1] == 't') {
+                        *out++ = '>';
+                    } else if (len == 3 && !std::strncmp(p, "amp", 3)) {
+                        *out++ = '&';
+                    } else if (len == 4 && !std::strncmp(p, "quot", 4)) {
+                        *out++ = '"';
+                    } else if (len == 4 && !std::strncmp(p, "apos", 4)) {
+                        *out++ = '\'';
+                    } else {
+                        error(start, "undefined entity");
+                    }
+
+                    return semicolon + 1;
+                }
+
+                // Decode the text or attribute value between p and end in
+                // place. Line ends are normalized and, in attribute
+                // values, whitespace characters are replaced by spaces as
+                // required by the XML spec. Returns the new end.
+                char* decode(char* p, char* const end, const bool attribute) const {
+                    // Fast path: Nothing to do until the first special
+                    // character.
+                    while (p < end && *p != '&' && *p != '\r' &&
+                           !(attribute && (*p == '\n' || *p == '\t'))) {
+                        ++p;
+                    }
+
+                    char* out = p;
+                    while (p < end) {
+                        const char c = *p;
+                        if (c == '&') {
+                            p = decode_reference(p, end, out);
+                        } else if (c == '\r') {
+                            *out++ = attribute ? ' ' : '\n';
+                            ++p;
+                            if (p < end && *p == '\n') {
+                                ++p;
+                            }
+                        } else if (attribute && (c == '\n' || c == '\t')) {
+                            *out++ = ' ';
+                            ++p;
+                        } else {
+                            *out++ = c;
+                            ++p;
+                        }
+                    }
+
+                    return out;
+                }
+
+                char* start_tag(char* p) {
+                    if (m_root_seen && m_elements.empty()) {
+                        error(p, "junk after document element");
+                    }
+                    m_root_seen = true;
+
+                    char* const name = p + 1;
+                    char* const name_end = skip_name(name);
+                    if (name_end == name) {
+                        error(p, "not well-formed (invalid token)");
+                    }
+
+                    m_attrs.clear();
+                    bool empty_element = false;
+                    p = name_end;
+                    while (true) {
+                        char* const space = p;
+                        p = skip_space(p);
+                        if (p >= m_end) {
+                            error(p, "unclosed token");
+                        }
+                        if (*p == '>') {
+                            ++p;
+                            break;
+                        }
+                        if (*p == '/') {
+                            if (p + 1 < m_end && p[1] == '>') {
+                                empty_element = true;
+                                p += 2;
+                                break;
+                            }
+                            error(p, "not well-formed (invalid token)");
+                        }
+                        if (p == space) {
+                            error(p, "not well-formed (invalid token)");
+                        }
+
+                        char* const attr_name = p;
+                        char* const attr_name_end = skip_name(p);
+                        p = skip_space(attr_name_end);
+                        if (attr_name_end == attr_name || p >= m_end || *p != '=') {
+                            error(p, "not well-formed (invalid token)");
+                        }
+                        p = skip_space(p + 1);
+                        if (p >= m_end || (*p != '"' && *p != '\'')) {
+                            error(p, "not well-formed (invalid token)");
+                        }
+
+                        char* const value = p + 1;
+                        char* const value_end = static_cast<char*>(std::memchr(value, *p, static_cast<std::size_t>(m_end - value)));
+                        if (!value_end) {
+                            error(p, "unclosed token");
+                        }
+                        const char* const lt = static_cast<const char*>(std::memchr(value, '<', static_cast<std::size_t>(value_end - value)));
+                        if (lt) {
+                            error(lt, "not well-formed (invalid token)");
+                        }
+
+                        *decode(value, value_end, true) = '\0';
+                        *attr_name_end = '\0';
+                        m_attrs.push_back(attr_name);
+                        m_attrs.push_back(value);
+
+                        p = value_end + 1;
+                    }
+
+                    *name_end = '\0';
+                    m_attrs.push_back(nullptr);
+
+                    m_handler.start_element(name, m_attrs.data());
+                    if (empty_element) {
+                        m_handler.end_element(name);
+                    } else {
+                        m_elements.push_back(name);
+                    }
+
+                    return p;
+                }
+
+                char* end_tag(char* p) {
+                    char* const start = p;
+                    char* const name = p + 2;
+                    char* const name_end = skip_name(name);
+                    p = skip_space(name_end);
+                    if (p >= m_end || *p != '>') {
+                        error(p, "not well-formed (invalid token)");
+                    }
+
+                    const auto len = static_cast<std::size_t>(name_end - name);
+                    if (m_elements.empty() ||
+                        std::strlen(m_elements.back()) != len ||
+                        std::strncmp(m_elements.back(), name, len) != 0) {
+                        error(start, "mismatched tag");
+                    }
+
+                    *name_end = '\0';
+                    m_handler.end_element(m_elements.back());
+                    m_elements.pop_back();
+
+                    return p + 1;
+                }
+
+                char* text(char* p) {
+                    auto* end = static_cast<char*>(std::memchr(p, '<', static_cast<std::size_t>(m_end - p)));
+                    if (!end) {
+                        end = m_end;
+                    }
+
+                    if (m_elements.empty()) {
+                        if (skip_space(p) < end) {
+                            error(p, m_root_seen ? "junk after document element" : "syntax error");
+                        }
+                        return end;
+                    }
+
+                    char* const decoded_end = decode(p, end, false);
+                    if (decoded_end > p) {
+                        m_handler.characters(p, static_cast<int>(decoded_end - p));
+                    }
+
+                    return end;
+                }
+
+                char* cdata(char* p) {
+                    char* const start = p + 9;
+                    char* const end = skip_after(start, "]]>") - 3;
+                    if (m_elements.empty()) {
+                        error(p, "syntax error");
+                    }
+
+                    // Only line ends have to be normalized in CDATA sections.
+                    char* out = start;
+                    for (char* q = start; q < end; ++q) {
+                        if (*q == '\r') {
+                            *out++ = '\n';
+                            if (q + 1 < end && q[1] == '\n') {
+                                ++q;
+                            }
+                        } else {
+                            *out++ = *q;
+                        }
+                    }
+                    if (out > start) {
+                        m_handler.characters(start, static_cast<int>(out - start));
+                    }
+
+                    return end + 3;
+                }
+
+            public:
+
+                explicit XMLPullParser(THandler& handler) :
+                    m_handler(handler) {
+                }
+
+                /**
+                 * Set where the data comes from in the original document,
+                 * so that errors are reported with document positions.
+                 */
+                void set_document_position(const xml_document_position& position) noexcept {
+                    m_position = position;
+                }
+
+                /**
+                 * Parse the complete document in data. The data will be
+                 * modified.
+                 *
+                 * @throws osmium::xml_error If the document is not
+                 *         well-formed.
+                 * @throws Any exception thrown by the handler.
+                 */
+                void operator()(std::string& data) {
+                    m_begin = &*data.begin();
+                    m_end = m_begin + data.size();
+
+                    char* p = m_begin;
+                    while (p < m_end) {
+                        if (*p != '<') {
+                            p = text(p);
+                        } else if (p + 1 < m_end && p[1] == '/') {
+                            p = end_tag(p);
+                        } else if (p + 1 < m_end && p[1] == '?') {
+                            p = skip_after(p + 2, "?>");
+                        } else if (p + 3 < m_end && !std::strncmp(p, "<!--", 4)) {
+                            p = skip_after(p + 4, "-->");
+                        } else if (p + 8 < m_end && !std::strncmp(p, "<![CDATA[", 9)) {
+                            p = cdata(p);
+                        } else if (p + 1 < m_end && p[1] == '!') {
+                            error(p, "DOCTYPE declarations are not supported");
+                        } else {
+                            p = start_tag(p);
+                        }
+                    }
+
+                    if (!m_root_seen || !m_elements.empty()) {
+                        error(m_end, "no element found");
+                    }
+                }
+
+            }; // class XMLPullParser
+
+            /**
+             * Parses OSM XML data and builds the OSM objects into a buffer.
+             * The data is normally parsed with Expat, complete documents can
+             * also be parsed with the XMLPullParser. This is used by the
+             * XMLParser and, when the input is split at top-level objects,
+             * by the XMLChunkParser tasks.
+             */
+            class XMLObjectParser {
 
                 enum {
                     initial_buffer_size = 1024UL * 1024UL
@@ -171,6 +611,10 @@ namespace osmium {
 
                 std::string m_comment_text;
 
+                osmium::osm_entity_bits::type m_read_types;
+
+                bool m_header_is_done = false;
+
                 /**
                  * A C++ wrapper for the Expat parser that makes sure no memory
                  * is leaked.
@@ -181,7 +625,7 @@ namespace osmium {
                     std::exception_ptr m_exception_ptr{};
 
                     template <typename TFunc>
-                    void member_wrap(XMLParser& xml_parser, TFunc&& func) noexcept {
+                    void member_wrap(XMLObjectParser& xml_parser, TFunc&& func) noexcept {
                         if (m_exception_ptr) {
                             return;
                         }
@@ -196,24 +640,24 @@ namespace osmium {
                     template <typename TFunc>
                     static void wrap(void* data, TFunc&& func) noexcept {
                         assert(data);
-                        auto& xml_parser = *static_cast<XMLParser*>(data);
-                        xml_parser.m_expat_xml_parser->member_wrap(xml_parser, std::forward<TFunc>(func));
+                        auto& xml_parser = *static_cast<XMLObjectParser*>(data);
+                        xml_parser.m_expat_xml_parser.member_wrap(xml_parser, std::forward<TFunc>(func));
                     }
 
                     static void XMLCALL start_element_wrapper(void* data, const XML_Char* element, const XML_Char** attrs) noexcept {
-                        wrap(data, [&](XMLParser& xml_parser) {
+                        wrap(data, [&](XMLObjectParser& xml_parser) {
                             xml_parser.start_element(element, attrs);
                         });
                     }
 
                     static void XMLCALL end_element_wrapper(void* data, const XML_Char* element) noexcept {
-                        wrap(data, [&](XMLParser& xml_parser) {
+                        wrap(data, [&](XMLObjectParser& xml_parser) {
                             xml_parser.end_element(element);
                         });
                     }
 
                     static void XMLCALL character_data_wrapper(void* data, const XML_Char* text, int len) noexcept {
-                        wrap(data, [&](XMLParser& xml_parser) {
+                        wrap(data, [&](XMLObjectParser& xml_parser) {
                             xml_parser.characters(text, len);
                         });
                     }
@@ -232,7 +676,7 @@ namespace osmium {
                             const XML_Char* /*systemId*/,
                             const XML_Char* /*publicId*/,
                             const XML_Char* /*notationName*/) noexcept {
-                        wrap(data, [&](XMLParser& /*xml_parser*/) {
+                        wrap(data, [&](XMLObjectParser& /*xml_parser*/) {
                             throw osmium::xml_error{"XML entities are not supported"};
                         });
                     }
@@ -272,7 +716,9 @@ namespace osmium {
 
                 }; // class ExpatXMLParser
 
-                ExpatXMLParser* m_expat_xml_parser{nullptr};
+                ExpatXMLParser m_expat_xml_parser{this};
+
+                friend class XMLPullParser<XMLObjectParser>;
 
                 template <typename T>
                 static void check_attributes(const XML_Char** attrs, T&& check) {
@@ -350,8 +796,12 @@ namespace osmium {
                     m_tl_builder->add_tag(k, v);
                 }
 
-                void mark_header_as_done() {
-                    set_header_value(m_header);
+                osmium::osm_entity_bits::type read_types() const noexcept {
+                    return m_read_types;
+                }
+
+                void mark_header_as_done() noexcept {
+                    m_header_is_done = true;
                 }
 
                 void top_level_element(const XML_Char* element, const XML_Char** attrs) {
@@ -677,7 +1127,6 @@ namespace osmium {
                                 m_tl_builder.reset();
                                 m_node_builder.reset();
                                 m_buffer.commit();
-                                flush_buffer();
                             }
                             break;
                         case context::way:
@@ -687,7 +1136,6 @@ namespace osmium {
                                 m_wnl_builder.reset();
                                 m_way_builder.reset();
                                 m_buffer.commit();
-                                flush_buffer();
                             }
                             break;
                         case context::relation:
@@ -697,7 +1145,6 @@ namespace osmium {
                                 m_rml_builder.reset();
                                 m_relation_builder.reset();
                                 m_buffer.commit();
-                                flush_buffer();
                             }
                             break;
                         case context::tag:
@@ -713,7 +1160,6 @@ namespace osmium {
                                 m_changeset_discussion_builder.reset();
                                 m_changeset_builder.reset();
                                 m_buffer.commit();
-                                flush_buffer();
                             }
                             break;
                         case context::discussion:
@@ -749,17 +1195,280 @@ namespace osmium {
                     }
                 }
 
-                void flush_buffer() {
-                    if (m_buffer.has_nested_buffers()) {
-                        std::unique_ptr<osmium::memory::Buffer> buffer_ptr{m_buffer.get_last_nested()};
-                        send_to_output_queue(std::move(*buffer_ptr));
+            public:
+
+                explicit XMLObjectParser(const osmium::osm_entity_bits::type read_types) :
+                    m_read_types(read_types) {
+                }
+
+                XMLObjectParser(const XMLObjectParser&) = delete;
+                XMLObjectParser& operator=(const XMLObjectParser&) = delete;
+
+                XMLObjectParser(XMLObjectParser&&) = delete;
+                XMLObjectParser& operator=(XMLObjectParser&&) = delete;
+
+                ~XMLObjectParser() noexcept = default;
+
+                /**
+                 * Parse the next block of data. Set last to true for the
+                 * last block.
+                 */
+                void operator()(const std::string& data, const bool last) {
+                    m_expat_xml_parser(data, last);
+                }
+
+                /**
+                 * Parse a complete document with the XMLPullParser instead
+                 * of Expat. The data will be modified.
+                 */
+                void parse_document(std::string& data, const xml_document_position& position = xml_document_position{}) {
+                    XMLPullParser<XMLObjectParser> parser{*this};
+                    parser.set_document_position(position);
+                    parser(data);
+                }
+
+                /**
+                 * Has the header been completely read? This is the case
+                 * once the first OSM object or the end of the document
+                 * has been seen.
+                 */
+                bool header_is_done() const noexcept {
+                    return m_header_is_done;
+                }
+
+                const osmium::io::Header& header() const noexcept {
+                    return m_header;
+                }
+
+                /// Are there any full buffers to be taken out?
+                bool has_full_buffer() const noexcept {
+                    return m_buffer.has_nested_buffers();
+                }
+
+                /**
+                 * Take out the oldest full buffer.
+                 *
+                 * @pre has_full_buffer()
+                 */
+                osmium::memory::Buffer get_full_buffer() {
+                    std::unique_ptr<osmium::memory::Buffer> buffer_ptr{m_buffer.get_last_nested()};
+                    return std::move(*buffer_ptr);
+                }
+
+                /**
+                 * Take out the current buffer. It can contain nested
+                 * full buffers.
+                 */
+                osmium::memory::Buffer release_buffer() {
+                    return std::move(m_buffer);
+                }
+
+            }; // class XMLObjectParser
+
+            /**
+             * Task parsing a chunk of complete top-level OSM objects. The
+             * chunk has to be wrapped in the top-level element and, if
+             * needed, the change section it was found in, so that it is a
+             * complete XML document. It is parsed with Expat or the
+             * XMLPullParser. The resulting buffer can contain nested buffers.
+             */
+            class XMLChunkParser {
+
+                std::string m_data;
+                xml_document_position m_position;
+                osmium::osm_entity_bits::type m_read_types;
+                bool m_pull_parser;
+
+            public:
+
+                XMLChunkParser(std::string&& data, const xml_document_position& position, const osmium::osm_entity_bits::type read_types, const bool pull_parser) :
+                    m_data(std::move(data)),
+                    m_position(position),
+                    m_read_types(read_types),
+                    m_pull_parser(pull_parser) {
+                }
+
+                osmium::memory::Buffer operator()() {
+                    XMLObjectParser parser{m_read_types};
+                    if (m_pull_parser) {
+                        parser.parse_document(m_data, m_position);
+                        return parser.release_buffer();
                     }
+
+                    try {
+                        parser(m_data, true);
+                    } catch (const osmium::xml_error& e) {
+                        if (e.line == 0) {
+                            throw;
+                        }
+                        // Expat only knows positions in the chunk.
+                        uint64_t line = e.line;
+                        uint64_t column = e.column;
+                        m_position.to_document(line, column);
+                        osmium::xml_error error{std::string{"XML parsing error at line "}
+                                                + std::to_string(line)
+                                                + ", column "
+                                                + std::to_string(column)
+                                                + ": "
+                                                + e.error_string};
+                        error.line = line;
+                        error.column = column;
+                        error.error_code = e.error_code;
+                        error.error_string = e.error_string;
+                        throw error;
+                    }
+                    return parser.release_buffer();
+                }
+
+            }; // class XMLChunkParser
+
+            /**
+             * The XML parser. Normally all data goes through one Expat
+             * parser on the parser thread.
+             *
+             * In parallel mode (see osmium::config::use_parallel_xml_parsing())
+             * or when the pull parser is used (see
+             * osmium::config::use_xml_pull_parser()) the XMLSplitter cuts
+             * the input at the boundaries of the top-level OSM objects.
+             * Everything outside these objects (XML declaration, top-level
+             * element, change sections, bounds, ...) still goes through the
+             * Expat parser on the parser thread which takes care of the
+             * header. The objects are collected into chunks which are
+             * parsed by XMLChunkParser tasks, on the thread pool in
+             * parallel mode, with Expat or the XMLPullParser. The resulting
+             * buffers are sent to the output queue in order. Whitespace
+             * between the objects is kept in the chunks, so that errors
+             * in them can be reported with their line and column in the
+             * document. If the splitter finds something it
+             * can't handle (such as a DOCTYPE declaration), the rest of the
+             * input is parsed in the normal way.
+             */
+            class XMLParser : public Parser {
+
+                enum {
+                    max_chunk_size = 1024UL * 1024UL
+                };
+
+                XMLObjectParser m_parser;
+
+                bool m_parallel;
+
+                bool m_pull_parser;
+
+                void parse_data(const std::string& data, const bool last) {
+                    m_parser(data, last);
+                    if (m_parser.header_is_done()) {
+                        set_header_value(m_parser.header());
+                    }
+                    while (m_parser.has_full_buffer()) {
+                        send_to_output_queue(m_parser.get_full_buffer());
+                    }
+                }
+
+                void run_sequential() {
+                    while (!input_done()) {
+                        const std::string data{get_input()};
+                        parse_data(data, input_done());
+                        if (read_types() == osmium::osm_entity_bits::nothing && header_is_done()) {
+                            break;
+                        }
+                    }
+                }
+
+                void run_split() {
+                    XMLSplitter splitter;
+                    std::string chunk;
+                    std::string chunk_end;
+
+                    // Position in the document of the current piece and
+                    // of the data in the current chunk.
+                    xml_document_position position;
+                    xml_document_position chunk_position;
+
+                    const auto advance = [&position](const char* data, std::size_t size) {
+                        const char* const end = data + size;
+                        for (const char* p = data; p != end; ++p) {
+                            if (*p == '\n') {
+                                ++position.line;
+                                position.column = 0;
+                            } else {
+                                ++position.column;
+                            }
+                        }
+                    };
+
+                    const auto submit_chunk = [&]() {
+                        if (!chunk.empty()) {
+                            chunk += chunk_end;
+                            XMLChunkParser chunk_parser{std::move(chunk), chunk_position, read_types(), m_pull_parser};
+                            if (m_parallel) {
+                                send_to_output_queue(submit_to_pool(std::move(chunk_parser)));
+                            } else {
+                                send_to_output_queue(chunk_parser());
+                            }
+                            chunk.clear();
+                        }
+                    };
+
+                    while (!input_done()) {
+                        splitter.append(get_input());
+
+                        auto type = splitter.next();
+                        for (; type != XMLSplitter::piece_type::need_more_data &&
+                               type != XMLSplitter::piece_type::unsupported; type = splitter.next()) {
+                            if (type == XMLSplitter::piece_type::text) {
+                                const std::string text{splitter.piece_data(), splitter.piece_size()};
+                                // Only whitespace between objects doesn't
+                                // end the chunk.
+                                if (text.find('<') != std::string::npos) {
+                                    submit_chunk();
+                                } else if (!chunk.empty()) {
+                                    chunk += text;
+                                }
+                                parse_data(text, false);
+                                advance(text.data(), text.size());
+                                continue;
+                            }
+
+                            set_header_value(m_parser.header());
+                            if (chunk.empty()) {
+                                const auto top = splitter.top_level_name();
+                                const auto section = splitter.section_name();
+                                chunk = "<" + top + " version=\"0.6\">";
+                                chunk_end = "</" + top + ">";
+                                if (!section.empty()) {
+                                    chunk += "<" + section + ">";
+                                    chunk_end.insert(0, "</" + section + ">");
+                                }
+                                chunk_position = position;
+                                chunk_position.offset = chunk.size();
+                            }
+                            chunk.append(splitter.piece_data(), splitter.piece_size());
+                            advance(splitter.piece_data(), splitter.piece_size());
+                            if (chunk.size() >= max_chunk_size) {
+                                submit_chunk();
+                            }
+                        }
+
+                        if (type == XMLSplitter::piece_type::unsupported) {
+                            submit_chunk();
+                            parse_data(splitter.rest(), input_done());
+                            run_sequential();
+                            return;
+                        }
+                    }
+
+                    submit_chunk();
+                    parse_data(splitter.rest(), true);
                 }
 
             public:
 
-                explicit XMLParser(parser_arguments& args) :
-                    Parser(args) {
+                explicit XMLParser(parser_arguments& args, const bool parallel = false, const bool pull_parser = false) :
+                    Parser(args),
+                    m_parser(args.read_which_entities),
+                    m_parallel(parallel),
+                    m_pull_parser(pull_parser) {
                 }
 
                 XMLParser(const XMLParser&) = delete;
@@ -773,21 +1482,21 @@ namespace osmium {
                 void run() final {
                     osmium::thread::set_thread_name("_osmium_xml_in");
 
-                    ExpatXMLParser parser{this};
-                    m_expat_xml_parser = &parser;
-
-                    while (!input_done()) {
-                        const std::string data{get_input()};
-                        parser(data, input_done());
-                        if (read_types() == osmium::osm_entity_bits::nothing && header_is_done()) {
-                            break;
-                        }
+                    if ((m_parallel || m_pull_parser) && read_types() != osmium::osm_entity_bits::nothing) {
+                        run_split();
+                    } else {
+                        run_sequential();
                     }
 
-                    mark_header_as_done();
+                    set_header_value(m_parser.header());
 
-                    if (m_buffer.committed() > 0) {
-                        send_to_output_queue(std::move(m_buffer));
+                    osmium::memory::Buffer buffer{m_parser.release_buffer()};
+                    while (buffer.has_nested_buffers()) {
+                        std::unique_ptr<osmium::memory::Buffer> buffer_ptr{buffer.get_last_nested()};
+                        send_to_output_queue(std::move(*buffer_ptr));
+                    }
+                    if (buffer.committed() > 0) {
+                        send_to_output_queue(std::move(buffer));
                     }
                 }
 
@@ -798,7 +1507,9 @@ namespace osmium {
             const bool registered_xml_parser = ParserFactory::instance().register_parser(
                 file_format::xml,
                 [](parser_arguments& args) {
-                    return std::unique_ptr<Parser>(new XMLParser{args});
+                    return std::unique_ptr<Parser>(new XMLParser{args,
+                                                               osmium::config::use_parallel_xml_parsing(),
+                                                               osmium::config::use_xml_pull_parser()});
             });
 
             // dummy function to silence the unused variable warning from above
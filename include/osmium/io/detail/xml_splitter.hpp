@@ -0,0 +1,354 @@
+#ifndef OSMIUM_IO_DETAIL_XML_SPLITTER_HPP
+#define OSMIUM_IO_DETAIL_XML_SPLITTER_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+#include <cassert>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            /**
+             * Cuts an OSM XML document into the top-level OSM objects
+             * (<node>, <way>, <relation>, and <changeset> elements directly
+             * inside the <osm> or <osmChange> element or inside a
+             * <create>, <modify>, or <delete> section) and the text
+             * around them. Input is added in blocks with append(), the
+             * pieces are then read with next().
+             *
+             * This is not a complete XML parser. It only understands
+             * enough XML to find the element boundaries reliably: tags,
+             * quoted attribute values, comments, CDATA sections, and
+             * processing instructions. If it finds something it doesn't
+             * understand (such as a DOCTYPE declaration or an encoding
+             * other than UTF-8), next() returns piece_type::unsupported
+             * and the caller has to parse the rest of the document (see
+             * rest()) in the normal way.
+             */
+            class XMLSplitter {
+
+            public:
+
+                enum class piece_type {
+                    need_more_data, // call append() and try again
+                    text,           // anything outside of OSM objects
+                    object,         // one complete OSM object element
+                    unsupported     // splitting is not possible
+                };
+
+            private:
+
+                std::string m_data{};
+
+                // Start of the current piece in m_data.
+                std::size_t m_start = 0;
+
+                // Scanning position in m_data.
+                std::size_t m_pos = 0;
+
+                // Last piece returned from next().
+                std::size_t m_piece_start = 0;
+                std::size_t m_piece_end = 0;
+
+                // Names of the open elements outside of objects.
+                std::vector<std::string> m_names{};
+
+                // Element depth inside the current object, 0 if we are
+                // not inside an object.
+                std::size_t m_object_depth = 0;
+
+                bool m_unsupported = false;
+
+                static bool is_space(const char c) noexcept {
+                    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+                }
+
+                static bool is_object_name(const std::string& name) noexcept {
+                    return name == "node" || name == "way" ||
+                           name == "relation" || name == "changeset";
+                }
+
+                static bool is_section_name(const std::string& name) noexcept {
+                    return name == "create" || name == "modify" || name == "delete";
+                }
+
+                bool starts_with(const std::size_t pos, const char* str) const noexcept {
+                    return m_data.compare(pos, std::strlen(str), str) == 0;
+                }
+
+                // Find the position after the end marker of a comment,
+                // CDATA section, or processing instruction starting at
+                // pos. Returns std::string::npos if it isn't there yet.
+                std::size_t find_after(const std::size_t pos, const char* end_marker) const noexcept {
+                    const auto end = m_data.find(end_marker, pos);
+                    if (end == std::string::npos) {
+                        return end;
+                    }
+                    return end + std::strlen(end_marker);
+                }
+
+                // Find the '>' ending the tag starting at pos taking
+                // quoted attribute values into account. Returns
+                // std::string::npos if it isn't there yet.
+                std::size_t find_tag_end(std::size_t pos) const noexcept {
+                    while (true) {
+                        pos = m_data.find_first_of("\"'>", pos);
+                        if (pos == std::string::npos || m_data[pos] == '>') {
+                            return pos;
+                        }
+                        pos = m_data.find(m_data[pos], pos + 1);
+                        if (pos == std::string::npos) {
+                            return pos;
+                        }
+                        ++pos;
+                    }
+                }
+
+                std::string tag_name(const std::size_t pos) const {
+                    const auto end = m_data.find_first_of(" \t\r\n/>", pos);
+                    assert(end != std::string::npos);
+                    return m_data.substr(pos, end - pos);
+                }
+
+                bool is_object_start(const std::string& name) const noexcept {
+                    if (!is_object_name(name)) {
+                        return false;
+                    }
+                    if (m_names.size() == 1) {
+                        return m_names[0] == "osm" || m_names[0] == "osmChange";
+                    }
+                    return m_names.size() == 2 &&
+                           m_names[0] == "osmChange" &&
+                           is_section_name(m_names[1]);
+                }
+
+                // Checks the encoding in the XML declaration. Everything
+                // but UTF-8 (and the compatible US-ASCII) is unsupported.
+                bool is_supported_declaration(const std::size_t pos, const std::size_t end) const {
+                    const std::string decl{m_data.substr(pos, end - pos)};
+                    const auto enc = decl.find("encoding");
+                    if (enc == std::string::npos) {
+                        return true;
+                    }
+                    const auto quote = decl.find_first_of("\"'", enc);
+                    if (quote == std::string::npos) {
+                        return false;
+                    }
+                    std::string value;
+                    for (auto it = decl.begin() + static_cast<std::ptrdiff_t>(quote) + 1; it != decl.end() && *it != decl[quote]; ++it) {
+                        value += static_cast<char>(std::toupper(static_cast<unsigned char>(*it)));
+                    }
+                    return value == "UTF-8" || value == "UTF8" || value == "US-ASCII";
+                }
+
+                piece_type set_piece(const piece_type type, const std::size_t end) noexcept {
+                    m_piece_start = m_start;
+                    m_piece_end = end;
+                    m_start = end;
+                    m_pos = end;
+                    return type;
+                }
+
+                piece_type unsupported() noexcept {
+                    m_unsupported = true;
+                    return piece_type::unsupported;
+                }
+
+            public:
+
+                /**
+                 * Add more input data.
+                 */
+                void append(const std::string& data) {
+                    if (m_start > 0) {
+                        m_data.erase(0, m_start);
+                        m_pos -= m_start;
+                        m_start = 0;
+                    }
+                    m_piece_start = 0;
+                    m_piece_end = 0;
+                    m_data.append(data);
+                }
+
+                /**
+                 * Find the next piece. If a text or object piece is
+                 * found, it can be accessed with piece_data() and
+                 * piece_size() until the next call to next() or append().
+                 */
+                piece_type next() {
+                    if (m_unsupported) {
+                        return piece_type::unsupported;
+                    }
+
+                    while (true) {
+                        const auto pos = m_data.find('<', m_pos);
+                        if (pos == std::string::npos) {
+                            m_pos = m_data.size();
+                            return piece_type::need_more_data;
+                        }
+
+                        // We need at least enough data to recognize
+                        // comments and CDATA sections.
+                        const auto available = m_data.size() - pos;
+                        if (available < 2 || (m_data[pos + 1] == '!' && available < 9)) {
+                            m_pos = pos;
+                            return piece_type::need_more_data;
+                        }
+
+                        std::size_t end = 0;
+                        if (starts_with(pos, "<!--")) {
+                            end = find_after(pos + 4, "-->");
+                        } else if (starts_with(pos, "<![CDATA[")) {
+                            end = find_after(pos + 9, "]]>");
+                        } else if (starts_with(pos, "<?")) {
+                            end = find_after(pos + 2, "?>");
+                            if (end != std::string::npos && starts_with(pos, "<?xml ") &&
+                                !is_supported_declaration(pos, end)) {
+                                return unsupported();
+                            }
+                        } else if (starts_with(pos, "<!")) {
+                            // DOCTYPE declarations can contain entity
+                            // declarations which we can't handle here.
+                            return unsupported();
+                        } else {
+                            end = find_tag_end(pos + 1);
+                        }
+
+                        if (end == std::string::npos) {
+                            m_pos = pos;
+                            return piece_type::need_more_data;
+                        }
+
+                        if (m_data[pos + 1] == '!' || m_data[pos + 1] == '?') {
+                            m_pos = end;
+                            continue;
+                        }
+
+                        const bool end_tag = m_data[pos + 1] == '/';
+                        const bool empty_element = !end_tag && m_data[end - 1] == '/';
+                        m_pos = end + 1;
+
+                        if (m_object_depth > 0) {
+                            if (end_tag) {
+                                if (--m_object_depth == 0) {
+                                    return set_piece(piece_type::object, end + 1);
+                                }
+                            } else if (!empty_element) {
+                                ++m_object_depth;
+                            }
+                            continue;
+                        }
+
+                        if (end_tag) {
+                            if (m_names.empty()) {
+                                return unsupported();
+                            }
+                            m_names.pop_back();
+                            continue;
+                        }
+
+                        const std::string name{tag_name(pos + 1)};
+                        if (!is_object_start(name)) {
+                            if (!empty_element) {
+                                m_names.push_back(name);
+                            }
+                            continue;
+                        }
+
+                        // Return the text before the object first.
+                        if (pos > m_start) {
+                            return set_piece(piece_type::text, pos);
+                        }
+
+                        if (empty_element) {
+                            return set_piece(piece_type::object, end + 1);
+                        }
+                        m_object_depth = 1;
+                    }
+                }
+
+                const char* piece_data() const noexcept {
+                    return m_data.data() + m_piece_start;
+                }
+
+                std::size_t piece_size() const noexcept {
+                    return m_piece_end - m_piece_start;
+                }
+
+                /**
+                 * Name of the top-level element (usually "osm" or
+                 * "osmChange") or empty string if it wasn't found yet.
+                 */
+                std::string top_level_name() const {
+                    return m_names.empty() ? std::string{} : m_names[0];
+                }
+
+                /**
+                 * Name of the change section ("create", "modify", or
+                 * "delete") the last object was found in or empty string
+                 * if it wasn't in a section.
+                 */
+                std::string section_name() const {
+                    return m_names.size() > 1 ? m_names[1] : std::string{};
+                }
+
+                /**
+                 * Return all data from the end of the last piece that
+                 * was returned and clear the internal buffer.
+                 */
+                std::string rest() {
+                    std::string data{m_data.substr(m_start)};
+                    m_data.clear();
+                    m_start = 0;
+                    m_pos = 0;
+                    m_piece_start = 0;
+                    m_piece_end = 0;
+                    return data;
+                }
+
+            }; // class XMLSplitter
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_XML_SPLITTER_HPP
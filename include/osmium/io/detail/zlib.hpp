@@ -43,10 +43,15 @@ DEALINGS IN THE SOFTWARE.
 # include <protozero/types.hpp>
 #endif
 
-#include <zlib.h>
+#ifdef OSMIUM_WITH_LIBDEFLATE
+# include <libdeflate.h>
+#else
+# include <zlib.h>
+#endif
 
 #include <cassert>
 #include <limits>
+#include <memory>
 #include <string>
 
 namespace osmium {
@@ -55,6 +60,111 @@ namespace osmium {
 
         namespace detail {
 
+#ifdef OSMIUM_WITH_LIBDEFLATE
+
+            /// Highest compression level supported by zlib_compress().
+            constexpr int zlib_max_compression_level() noexcept {
+                return 12;
+            }
+
+            struct libdeflate_compressor_deleter {
+                void operator()(libdeflate_compressor* compressor) const noexcept {
+                    ::libdeflate_free_compressor(compressor);
+                }
+            };
+
+            struct libdeflate_decompressor_deleter {
+                void operator()(libdeflate_decompressor* decompressor) const noexcept {
+                    ::libdeflate_free_decompressor(decompressor);
+                }
+            };
+
+            /**
+             * Get the libdeflate compressor for the given level. The
+             * compressors are allocated once per thread and level and
+             * then re-used, because allocating them is expensive.
+             */
+            inline libdeflate_compressor* get_libdeflate_compressor(int level) {
+                static thread_local std::unique_ptr<libdeflate_compressor, libdeflate_compressor_deleter> compressors[zlib_max_compression_level() + 1];
+
+                assert(level >= 0 && level <= zlib_max_compression_level());
+                auto& compressor = compressors[level];
+                if (!compressor) {
+                    compressor.reset(::libdeflate_alloc_compressor(level));
+                    if (!compressor) {
+                        throw io_error{"failed to allocate libdeflate compressor"};
+                    }
+                }
+
+                return compressor.get();
+            }
+
+            /**
+             * Compress data in zlib format using libdeflate.
+             *
+             * @param input Data to compress.
+             * @param level Compression level (1 to 12, 0 for default).
+             * @returns Compressed data.
+             */
+            inline std::string zlib_compress(const std::string& input, int level = 0) {
+                auto* compressor = get_libdeflate_compressor(level == 0 ? 6 : level);
+
+                std::string output(::libdeflate_zlib_compress_bound(compressor, input.size()), '\0');
+
+                const auto output_size = ::libdeflate_zlib_compress(compressor,
+                                                                    input.data(),
+                                                                    input.size(),
+                                                                    &*output.begin(),
+                                                                    output.size());
+
+                if (output_size == 0) {
+                    throw io_error{"failed to compress data"};
+                }
+
+                output.resize(output_size);
+
+                return output;
+            }
+
+            /**
+             * Uncompress data in zlib format using libdeflate.
+             *
+             * @param input Compressed input data.
+             * @param input_size Size of compressed input data.
+             * @param raw_size Size of uncompressed data.
+             * @param output Uncompressed result data.
+             * @returns Pointer and size to incompressed data.
+             */
+            inline protozero::data_view zlib_uncompress_string(const char* input, unsigned long input_size, unsigned long raw_size, std::string& output) { // NOLINT(google-runtime-int)
+                static thread_local std::unique_ptr<libdeflate_decompressor, libdeflate_decompressor_deleter> decompressor{::libdeflate_alloc_decompressor()};
+
+                if (!decompressor) {
+                    throw io_error{"failed to allocate libdeflate decompressor"};
+                }
+
+                output.resize(raw_size);
+
+                const auto result = ::libdeflate_zlib_decompress(decompressor.get(),
+                                                                 input,
+                                                                 input_size,
+                                                                 &*output.begin(),
+                                                                 raw_size,
+                                                                 nullptr);
+
+                if (result != LIBDEFLATE_SUCCESS) {
+                    throw io_error{"failed to uncompress data"};
+                }
+
+                return protozero::data_view{output.data(), output.size()};
+            }
+
+#else
+
+            /// Highest compression level supported by zlib_compress().
+            constexpr int zlib_max_compression_level() noexcept {
+                return Z_BEST_COMPRESSION;
+            }
+
             /**
              * Compress data using zlib.
              *
@@ -62,19 +172,22 @@ namespace osmium {
              * what fits in an unsigned long, on Windows this is usually 32bit.
              *
              * @param input Data to compress.
+             * @param level Compression level (1 to 9, 0 for default).
              * @returns Compressed data.
              */
-            inline std::string zlib_compress(const std::string& input) {
+            inline std::string zlib_compress(const std::string& input, int level = 0) {
                 assert(input.size() < std::numeric_limits<unsigned long>::max());
+                assert(level >= 0 && level <= zlib_max_compression_level());
                 unsigned long output_size = ::compressBound(static_cast<unsigned long>(input.size())); // NOLINT(google-runtime-int)
 
                 std::string output(output_size, '\0');
 
-                const auto result = ::compress(
+                const auto result = ::compress2(
                     reinterpret_cast<unsigned char*>(&*output.begin()),
                     &output_size,
                     reinterpret_cast<const unsigned char*>(input.data()),
-                    static_cast<unsigned long>(input.size()) // NOLINT(google-runtime-int)
+                    static_cast<unsigned long>(input.size()), // NOLINT(google-runtime-int)
+                    level == 0 ? Z_DEFAULT_COMPRESSION : level
                 );
 
                 if (result != Z_OK) {
@@ -114,6 +227,8 @@ namespace osmium {
                 return protozero::data_view{output.data(), output.size()};
             }
 
+#endif
+
         } // namespace detail
 
     } // namespace io
@@ -225,6 +225,12 @@ namespace osmium {
                 } else if (suffixes.back() == "blackhole") {
                     m_file_format = file_format::blackhole;
                     suffixes.pop_back();
+                } else if (suffixes.back() == "geojsonseq") {
+                    m_file_format = file_format::geojsonseq;
+                    suffixes.pop_back();
+                } else if (suffixes.back() == "columnar") {
+                    m_file_format = file_format::columnar;
+                    suffixes.pop_back();
                 }
 
                 if (suffixes.empty()) {
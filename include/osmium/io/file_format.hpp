@@ -40,15 +40,17 @@ namespace osmium {
     namespace io {
 
         enum class file_format {
-            unknown   = 0,
-            xml       = 1,
-            pbf       = 2,
-            opl       = 3,
-            json      = 4,
-            o5m       = 5,
-            debug     = 6,
-            blackhole = 7,
-            last      = 7 // must have the same value as the last real value
+            unknown    = 0,
+            xml        = 1,
+            pbf        = 2,
+            opl        = 3,
+            json       = 4,
+            o5m        = 5,
+            debug      = 6,
+            blackhole  = 7,
+            geojsonseq = 8,
+            columnar   = 9,
+            last       = 9 // must have the same value as the last real value
         };
 
         enum class read_meta {
@@ -56,6 +58,15 @@ namespace osmium {
             yes = 1
         };
 
+        /**
+         * Should the Reader return buffers in the order of the data in
+         * the file or as soon as they are available?
+         */
+        enum class read_order {
+            ordered   = 0,
+            unordered = 1
+        };
+
         inline const char* as_string(const file_format format) noexcept {
             switch (format) {
                 case file_format::xml:
@@ -72,6 +83,10 @@ namespace osmium {
                     return "DEBUG";
                 case file_format::blackhole:
                     return "BLACKHOLE";
+                case file_format::geojsonseq:
+                    return "GEOJSONSEQ";
+                case file_format::columnar:
+                    return "COLUMNAR";
                 default: // file_format::unknown
                     break;
             }
@@ -47,14 +47,24 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/error.hpp>
 #include <osmium/io/file_compression.hpp>
 #include <osmium/io/writer_options.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/util/config.hpp>
 
 #include <zlib.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
 #include <limits>
 #include <string>
+#include <system_error>
+#include <utility>
 
 #ifndef _MSC_VER
 # include <unistd.h>
@@ -315,13 +325,537 @@ namespace osmium {
 
         }; // class GzipBufferDecompressor
 
+        namespace detail {
+
+            /**
+             * The parallel gzip compressor writes each chunk as a separate
+             * gzip member. The header of each member contains an extra
+             * field (subfield ID "OM") with the size of the whole member as
+             * 32bit little-endian integer, so that the decompressor can
+             * find the members without decompressing anything. This is the
+             * same idea as in the BGZF format used in bioinformatics.
+             * Standard gzip tools ignore the extra field.
+             */
+            enum gzip_member_constants : std::size_t {
+                gzip_member_header_size = 10 + 2 + 4 + 4,
+                gzip_member_trailer_size = 8
+            };
+
+            inline void append_uint32_le(std::string& out, uint32_t value) {
+                out += static_cast<char>(value & 0xffU);
+                out += static_cast<char>((value >> 8U) & 0xffU);
+                out += static_cast<char>((value >> 16U) & 0xffU);
+                out += static_cast<char>((value >> 24U) & 0xffU);
+            }
+
+            inline uint32_t get_uint32_le(const char* data) noexcept {
+                const auto* d = reinterpret_cast<const unsigned char*>(data);
+                return static_cast<uint32_t>(d[0]) |
+                       (static_cast<uint32_t>(d[1]) << 8U) |
+                       (static_cast<uint32_t>(d[2]) << 16U) |
+                       (static_cast<uint32_t>(d[3]) << 24U);
+            }
+
+            /**
+             * Returns the size of the gzip member starting at data if it
+             * has the header written by the parallel gzip compressor, 0
+             * otherwise. At least gzip_member_header_size bytes must be
+             * available.
+             */
+            inline std::size_t get_gzip_member_size(const char* data) noexcept {
+                static const char header[] = "\x1f\x8b\x08\x04";
+                if (std::memcmp(data, header, 4) != 0 ||
+                    data[10] != 8 || data[11] != 0 ||
+                    data[12] != 'O' || data[13] != 'M' ||
+                    data[14] != 4 || data[15] != 0) {
+                    return 0;
+                }
+                const auto size = get_uint32_le(data + 16);
+                if (size < gzip_member_header_size + gzip_member_trailer_size) {
+                    return 0;
+                }
+                return size;
+            }
+
+            /**
+             * Compress data into a complete gzip member with the header
+             * described above.
+             */
+            inline std::string gzip_compress_member(const std::string& input, const int level) {
+                z_stream zstream{};
+                int result = deflateInit2(&zstream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+                if (result != Z_OK) {
+                    throw gzip_error{"gzip error: compression init failed", result};
+                }
+
+                std::string output(gzip_member_header_size, '\0');
+                const auto bound = deflateBound(&zstream, static_cast<unsigned long>(input.size())); // NOLINT(google-runtime-int)
+                output.resize(gzip_member_header_size + bound + gzip_member_trailer_size);
+
+                zstream.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(input.data()));
+                zstream.avail_in = static_cast<unsigned int>(input.size());
+                zstream.next_out = reinterpret_cast<unsigned char*>(&output[gzip_member_header_size]);
+                zstream.avail_out = static_cast<unsigned int>(bound);
+                result = deflate(&zstream, Z_FINISH);
+                const auto compressed_size = zstream.total_out;
+                deflateEnd(&zstream);
+                if (result != Z_STREAM_END) {
+                    throw gzip_error{"gzip error: compression failed", result};
+                }
+
+                output.resize(gzip_member_header_size + compressed_size);
+                const auto crc = crc32(0, reinterpret_cast<const unsigned char*>(input.data()), static_cast<unsigned int>(input.size()));
+                append_uint32_le(output, static_cast<uint32_t>(crc));
+                append_uint32_le(output, static_cast<uint32_t>(input.size()));
+
+                std::string header{"\x1f\x8b\x08\x04\0\0\0\0\0\xff\x08\0OM\x04\0", 16};
+                append_uint32_le(header, static_cast<uint32_t>(output.size()));
+                std::copy(header.begin(), header.end(), output.begin());
+
+                return output;
+            }
+
+            /**
+             * Incremental gzip decoder working on data in memory. Input
+             * can be given in pieces of any size. Several gzip members
+             * are decoded one after the other.
+             */
+            class gzip_stream_decoder {
+
+                z_stream m_zstream{};
+                bool m_initialized = false;
+                bool m_in_member = false;
+
+                [[noreturn]] void throw_error(const char* msg, int result) const {
+                    std::string message{"gzip error: "};
+                    message += msg;
+                    if (m_zstream.msg) {
+                        message += ": ";
+                        message += m_zstream.msg;
+                    }
+                    throw osmium::gzip_error{message, result};
+                }
+
+            public:
+
+                gzip_stream_decoder() = default;
+
+                gzip_stream_decoder(const gzip_stream_decoder&) = delete;
+                gzip_stream_decoder& operator=(const gzip_stream_decoder&) = delete;
+
+                gzip_stream_decoder(gzip_stream_decoder&&) = delete;
+                gzip_stream_decoder& operator=(gzip_stream_decoder&&) = delete;
+
+                ~gzip_stream_decoder() noexcept {
+                    if (m_initialized) {
+                        inflateEnd(&m_zstream);
+                    }
+                }
+
+                /**
+                 * Decode the input and append the decoded data to the
+                 * output.
+                 *
+                 * @throws gzip_error If the data is corrupt.
+                 */
+                void decode(const char* data, std::size_t size, std::string& output) {
+                    while (size > 0) {
+                        if (!m_initialized) {
+                            const int result = inflateInit2(&m_zstream, MAX_WBITS | 16); // NOLINT(hicpp-signed-bitwise)
+                            if (result != Z_OK) {
+                                throw_error("decompression init failed", result);
+                            }
+                            m_initialized = true;
+                        } else if (!m_in_member) {
+                            inflateReset(&m_zstream);
+                        }
+                        m_in_member = true;
+
+                        const auto chunk = std::min(size, static_cast<std::size_t>(std::numeric_limits<unsigned int>::max()));
+                        m_zstream.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(data));
+                        m_zstream.avail_in = static_cast<unsigned int>(chunk);
+
+                        int result = Z_OK;
+                        do {
+                            const auto old_size = output.size();
+                            const std::size_t grow_by = std::min(std::max(static_cast<std::size_t>(Decompressor::input_buffer_size), chunk * 4),
+                                                                 static_cast<std::size_t>(std::numeric_limits<unsigned int>::max()));
+                            output.resize(old_size + grow_by);
+                            m_zstream.next_out = reinterpret_cast<unsigned char*>(&output[old_size]);
+                            m_zstream.avail_out = static_cast<unsigned int>(grow_by);
+                            result = inflate(&m_zstream, Z_NO_FLUSH);
+                            output.resize(old_size + grow_by - m_zstream.avail_out);
+                            if (result == Z_BUF_ERROR && m_zstream.avail_in == 0) {
+                                // No progress possible, needs more input.
+                                result = Z_OK;
+                                break;
+                            }
+                            if (result != Z_OK && result != Z_STREAM_END) {
+                                throw_error("inflate failed", result);
+                            }
+                        } while (result == Z_OK && (m_zstream.avail_in > 0 || m_zstream.avail_out == 0));
+
+                        const auto used = chunk - m_zstream.avail_in;
+                        data += used;
+                        size -= used;
+
+                        if (result == Z_STREAM_END) {
+                            // Another member might follow.
+                            m_in_member = false;
+                        }
+                    }
+                }
+
+                /**
+                 * Call this after all input has been given to decode().
+                 *
+                 * @throws gzip_error If the input ended in the middle of
+                 *                    a member.
+                 */
+                void finish() {
+                    if (m_in_member) {
+                        throw osmium::gzip_error{"gzip error: unexpected end of data", Z_BUF_ERROR};
+                    }
+                }
+
+            }; // class gzip_stream_decoder
+
+            /// Task compressing one chunk into a gzip member.
+            class gzip_compress_chunk {
+
+                std::string m_data;
+                int m_level;
+
+            public:
+
+                gzip_compress_chunk(std::string&& data, int level) :
+                    m_data(std::move(data)),
+                    m_level(level) {
+                }
+
+                std::string operator()() const {
+                    return gzip_compress_member(m_data, m_level);
+                }
+
+            }; // class gzip_compress_chunk
+
+            /// Task decoding a run of complete gzip members.
+            class gzip_decode_chunk {
+
+                std::string m_data;
+
+            public:
+
+                explicit gzip_decode_chunk(std::string&& data) :
+                    m_data(std::move(data)) {
+                }
+
+                std::string operator()() const {
+                    std::string output;
+                    gzip_stream_decoder decoder;
+                    decoder.decode(m_data.data(), m_data.size(), output);
+                    decoder.finish();
+                    return output;
+                }
+
+            }; // class gzip_decode_chunk
+
+        } // namespace detail
+
+        /**
+         * Compressor writing gzip files like pigz does: The data is cut
+         * into chunks which are compressed in parallel on the thread pool
+         * into independent gzip members. The members are written to the
+         * file in order. Any gzip decompressor can read the result, the
+         * GzipParallelDecompressor can also decompress it in parallel.
+         *
+         * This is used instead of the GzipCompressor when writing files
+         * if the environment variable OSMIUM_USE_PARALLEL_GZIP is set to
+         * true.
+         */
+        class GzipParallelCompressor : public Compressor {
+
+            enum : std::size_t {
+                chunk_size = 1024UL * 1024UL
+            };
+
+            int m_fd;
+            osmium::thread::Pool& m_pool;
+            int m_level;
+            std::string m_chunk{};
+            std::deque<std::future<std::string>> m_results{};
+
+            std::size_t max_pending() const noexcept {
+                return 2 * static_cast<std::size_t>(m_pool.num_threads());
+            }
+
+            void write_front() {
+                const std::string data{m_results.front().get()};
+                m_results.pop_front();
+                osmium::io::detail::reliable_write(m_fd, data.data(), data.size());
+            }
+
+            void submit_chunk() {
+                m_results.push_back(m_pool.submit(detail::gzip_compress_chunk{std::move(m_chunk), m_level}));
+                m_chunk.clear();
+                while (m_results.size() > max_pending() ||
+                       (!m_results.empty() && m_results.front().wait_for(std::chrono::seconds{0}) == std::future_status::ready)) {
+                    write_front();
+                }
+            }
+
+        public:
+
+            GzipParallelCompressor(const int fd, const fsync sync, osmium::thread::Pool& pool, const int level = Z_DEFAULT_COMPRESSION) :
+                Compressor(sync),
+                m_fd(fd),
+                m_pool(pool),
+                m_level(level) {
+                if (fd < 0) {
+                    throw std::system_error{EBADF, std::system_category(), "invalid file descriptor"};
+                }
+            }
+
+            GzipParallelCompressor(const int fd, const fsync sync) :
+                GzipParallelCompressor(fd, sync, osmium::thread::Pool::default_instance()) {
+            }
+
+            GzipParallelCompressor(const GzipParallelCompressor&) = delete;
+            GzipParallelCompressor& operator=(const GzipParallelCompressor&) = delete;
+
+            GzipParallelCompressor(GzipParallelCompressor&&) = delete;
+            GzipParallelCompressor& operator=(GzipParallelCompressor&&) = delete;
+
+            ~GzipParallelCompressor() noexcept final {
+                try {
+                    close();
+                } catch (...) {
+                    // Ignore any exceptions because destructor must not throw.
+                }
+            }
+
+            void write(const std::string& data) final {
+                assert(m_fd >= 0);
+                m_chunk += data;
+                if (m_chunk.size() >= chunk_size) {
+                    submit_chunk();
+                }
+            }
+
+            void close() final {
+                if (m_fd >= 0) {
+                    const int fd = m_fd;
+                    try {
+                        // Always write at least one member, an empty file
+                        // is not a valid gzip file.
+                        if (!m_chunk.empty() || m_results.empty()) {
+                            submit_chunk();
+                        }
+                        while (!m_results.empty()) {
+                            write_front();
+                        }
+                    } catch (...) {
+                        m_fd = -1;
+                        m_results.clear();
+                        if (fd != 1) {
+                            osmium::io::detail::reliable_close(fd);
+                        }
+                        throw;
+                    }
+                    m_fd = -1;
+
+                    // Do not sync or close stdout
+                    if (fd == 1) {
+                        return;
+                    }
+
+                    if (do_fsync()) {
+                        osmium::io::detail::reliable_fsync(fd);
+                    }
+                    osmium::io::detail::reliable_close(fd);
+                }
+            }
+
+        }; // class GzipParallelCompressor
+
+        /**
+         * Decompressor for gzip files consisting of many members. Members
+         * written by the GzipParallelCompressor carry their size in the
+         * header, they are decompressed in parallel on the thread pool.
+         * Once a member without that information is found (for instance
+         * in files written by standard gzip), the rest of the file is
+         * decompressed sequentially.
+         *
+         * This is used instead of the GzipDecompressor when reading files
+         * if the environment variable OSMIUM_USE_PARALLEL_GZIP is set to
+         * true.
+         */
+        class GzipParallelDecompressor : public Decompressor {
+
+            enum : std::size_t {
+                chunk_size = Decompressor::input_buffer_size
+            };
+
+            int m_fd;
+            osmium::thread::Pool& m_pool;
+            std::string m_input{};
+            std::deque<std::future<std::string>> m_results{};
+            detail::gzip_stream_decoder m_sequential_decoder{};
+            std::size_t m_offset = 0;
+            bool m_eof = false;
+            bool m_sequential = false;
+
+            std::size_t max_pending() const noexcept {
+                return 2 * static_cast<std::size_t>(m_pool.num_threads());
+            }
+
+            std::string read_input() {
+                std::string data;
+                data.resize(chunk_size);
+                const auto nread = osmium::io::detail::reliable_read(m_fd, &*data.begin(), chunk_size);
+                data.resize(static_cast<std::string::size_type>(nread));
+                m_offset += data.size();
+                set_offset(m_offset);
+                return data;
+            }
+
+            // Find how many bytes at the beginning of the input consist
+            // of complete members with known sizes.
+            std::size_t complete_members_size() {
+                std::size_t pos = 0;
+                while (m_input.size() - pos >= detail::gzip_member_header_size) {
+                    const auto size = detail::get_gzip_member_size(m_input.data() + pos);
+                    if (size == 0) {
+                        m_sequential = true;
+                        break;
+                    }
+                    if (m_input.size() - pos < size) {
+                        break;
+                    }
+                    pos += size;
+                }
+                return pos;
+            }
+
+            void fill_and_split() {
+                std::string data{read_input()};
+                if (data.empty()) {
+                    m_eof = true;
+                    if (!m_input.empty()) {
+                        // Incomplete or unknown data at the end, leave it to
+                        // the sequential decoder to deal with.
+                        m_sequential = true;
+                    }
+                    return;
+                }
+
+                m_input += data;
+                const auto size = complete_members_size();
+                if (size > 0) {
+                    m_results.push_back(m_pool.submit(detail::gzip_decode_chunk{m_input.substr(0, size)}));
+                    m_input.erase(0, size);
+                }
+            }
+
+        public:
+
+            GzipParallelDecompressor(const int fd, osmium::thread::Pool& pool) :
+                m_fd(fd),
+                m_pool(pool) {
+                if (fd < 0) {
+                    throw std::system_error{EBADF, std::system_category(), "invalid file descriptor"};
+                }
+            }
+
+            explicit GzipParallelDecompressor(const int fd) :
+                GzipParallelDecompressor(fd, osmium::thread::Pool::default_instance()) {
+            }
+
+            GzipParallelDecompressor(const GzipParallelDecompressor&) = delete;
+            GzipParallelDecompressor& operator=(const GzipParallelDecompressor&) = delete;
+
+            GzipParallelDecompressor(GzipParallelDecompressor&&) = delete;
+            GzipParallelDecompressor& operator=(GzipParallelDecompressor&&) = delete;
+
+            ~GzipParallelDecompressor() noexcept final {
+                try {
+                    close();
+                } catch (...) {
+                    // Ignore any exceptions because destructor must not throw.
+                }
+            }
+
+            std::string read() final {
+                while (true) {
+                    // Results are returned in order. Before waiting for the
+                    // first one we queue up enough work for all threads.
+                    if (!m_results.empty() && (m_eof || m_sequential || m_results.size() >= max_pending())) {
+                        std::string output{m_results.front().get()};
+                        m_results.pop_front();
+                        if (!output.empty()) {
+                            return output;
+                        }
+                        continue;
+                    }
+
+                    if (m_sequential) {
+                        std::string data;
+                        if (!m_input.empty()) {
+                            data.swap(m_input);
+                        } else if (!m_eof) {
+                            data = read_input();
+                            if (data.empty()) {
+                                m_eof = true;
+                            }
+                        }
+                        if (data.empty()) {
+                            m_sequential_decoder.finish();
+                            return std::string{};
+                        }
+                        std::string output;
+                        m_sequential_decoder.decode(data.data(), data.size(), output);
+                        if (!output.empty()) {
+                            return output;
+                        }
+                        continue;
+                    }
+
+                    if (m_eof) {
+                        return std::string{};
+                    }
+
+                    fill_and_split();
+                }
+            }
+
+            void close() final {
+                m_results.clear();
+                if (m_fd >= 0) {
+                    const int fd = m_fd;
+                    m_fd = -1;
+                    osmium::io::detail::reliable_close(fd);
+                }
+            }
+
+        }; // class GzipParallelDecompressor
+
         namespace detail {
 
             // we want the register_compression() function to run, setting
             // the variable is only a side-effect, it will never be used
             const bool registered_gzip_compression = osmium::io::CompressionFactory::instance().register_compression(osmium::io::file_compression::gzip,
-                [](const int fd, const fsync sync) { return new osmium::io::GzipCompressor{fd, sync}; },
-                [](const int fd) { return new osmium::io::GzipDecompressor{fd}; },
+                [](const int fd, const fsync sync) -> osmium::io::Compressor* {
+                    if (osmium::config::use_parallel_gzip()) {
+                        return new osmium::io::GzipParallelCompressor{fd, sync};
+                    }
+                    return new osmium::io::GzipCompressor{fd, sync};
+                },
+                [](const int fd) -> osmium::io::Decompressor* {
+                    if (osmium::config::use_parallel_gzip()) {
+                        return new osmium::io::GzipParallelDecompressor{fd};
+                    }
+                    return new osmium::io::GzipDecompressor{fd};
+                },
                 [](const char* buffer, const std::size_t size) { return new osmium::io::GzipBufferDecompressor{buffer, size}; }
             );
 
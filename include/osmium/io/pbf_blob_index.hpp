@@ -0,0 +1,301 @@
+#ifndef OSMIUM_IO_PBF_BLOB_INDEX_HPP
+#define OSMIUM_IO_PBF_BLOB_INDEX_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+
+*/
+
+#include <osmium/io/detail/read_write.hpp>
+#include <osmium/io/error.hpp>
+#include <osmium/osm/entity_bits.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/util/file.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace io {
+
+        /**
+         * Information about one OSMData blob in a PBF file.
+         */
+        struct pbf_blob_index_entry {
+
+            /// Offset of the Blob (not the BlobHeader) in the file.
+            uint64_t offset = 0;
+
+            /// Size of the Blob in bytes.
+            uint32_t size = 0;
+
+            /// Types of all OSM entities in this blob.
+            osmium::osm_entity_bits::type types = osmium::osm_entity_bits::nothing;
+
+            /// Smallest ID of any OSM entity in this blob.
+            osmium::object_id_type min_id = std::numeric_limits<osmium::object_id_type>::max();
+
+            /// Largest ID of any OSM entity in this blob.
+            osmium::object_id_type max_id = std::numeric_limits<osmium::object_id_type>::min();
+
+            pbf_blob_index_entry() noexcept = default;
+
+            pbf_blob_index_entry(uint64_t blob_offset, uint32_t blob_size) noexcept :
+                offset(blob_offset),
+                size(blob_size) {
+            }
+
+            /// Add an entity with the given type and ID to this entry.
+            void add(osmium::osm_entity_bits::type type, osmium::object_id_type id) noexcept {
+                types |= type;
+                min_id = std::min(min_id, id);
+                max_id = std::max(max_id, id);
+            }
+
+            /**
+             * Can this blob contain entities of any of the given types
+             * with an ID in the range [from_id, to_id]?
+             */
+            bool matches(osmium::osm_entity_bits::type read_types,
+                         osmium::object_id_type from_id,
+                         osmium::object_id_type to_id) const noexcept {
+                return (types & read_types) != 0 &&
+                       min_id <= to_id &&
+                       max_id >= from_id;
+            }
+
+        }; // struct pbf_blob_index_entry
+
+        /**
+         * An index of the OSMData blobs in a PBF file with their offsets,
+         * sizes, the types of entities in them and the ID range of those
+         * entities. Use osmium::io::build_pbf_blob_index() (from
+         * osmium/io/pbf_input.hpp) to create it. It can be stored in a
+         * sidecar file next to the PBF file with write() and read back
+         * with read() so that it only has to be created once.
+         *
+         * An index (or a subset of it created with select()) can be given
+         * as an additional argument to the Reader constructor. The Reader
+         * will then only read the blobs listed in the index. This only
+         * works with uncompressed PBF files read with the "pbf_mmap=true"
+         * file option.
+         *
+         * The sidecar file contains the magic string "OSMPBFIX", the
+         * size of the PBF file as 64 bit integer, the number of entries
+         * as 64 bit integer, and then for each entry the offset (64 bit),
+         * size (32 bit), entity types (32 bit), min ID (64 bit) and max
+         * ID (64 bit). All integers are stored in host byte order.
+         */
+        class PBFBlobIndex {
+
+            std::vector<pbf_blob_index_entry> m_entries;
+            std::size_t m_file_size = 0;
+
+            static constexpr const char* magic() noexcept {
+                return "OSMPBFIX";
+            }
+
+            enum : std::size_t {
+                magic_size = 8,
+                header_size = magic_size + 2 * sizeof(uint64_t),
+                entry_size = sizeof(uint64_t) + 2 * sizeof(uint32_t) + 2 * sizeof(int64_t)
+            };
+
+            template <typename T>
+            static void append(std::string& data, T value) {
+                data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+            }
+
+            template <typename T>
+            static T extract(const char** data) noexcept {
+                T value;
+                std::memcpy(&value, *data, sizeof(T));
+                *data += sizeof(T);
+                return value;
+            }
+
+        public:
+
+            using const_iterator = std::vector<pbf_blob_index_entry>::const_iterator;
+
+            PBFBlobIndex() = default;
+
+            /**
+             * Create an empty index for a PBF file of the given size.
+             */
+            explicit PBFBlobIndex(std::size_t file_size) :
+                m_file_size(file_size) {
+            }
+
+            /// The size of the PBF file this index was created for.
+            std::size_t file_size() const noexcept {
+                return m_file_size;
+            }
+
+            /// The number of blobs in this index.
+            std::size_t size() const noexcept {
+                return m_entries.size();
+            }
+
+            bool empty() const noexcept {
+                return m_entries.empty();
+            }
+
+            const_iterator begin() const noexcept {
+                return m_entries.cbegin();
+            }
+
+            const_iterator end() const noexcept {
+                return m_entries.cend();
+            }
+
+            const pbf_blob_index_entry& operator[](std::size_t n) const noexcept {
+                return m_entries[n];
+            }
+
+            /**
+             * Add an entry to the index. Entries must be added in the order
+             * of the blobs in the file.
+             */
+            void add(const pbf_blob_index_entry& entry) {
+                m_entries.push_back(entry);
+            }
+
+            /**
+             * Create a new index with only those blobs that contain
+             * entities of (any of) the specified types and in the
+             * specified ID range. Blobs are never split, so some entities
+             * outside the range or of other types might still be read.
+             *
+             * @param read_types Entity types needed.
+             * @param from_id Smallest ID needed.
+             * @param to_id Largest ID needed.
+             */
+            PBFBlobIndex select(osmium::osm_entity_bits::type read_types,
+                                osmium::object_id_type from_id = std::numeric_limits<osmium::object_id_type>::min(),
+                                osmium::object_id_type to_id = std::numeric_limits<osmium::object_id_type>::max()) const {
+                PBFBlobIndex index{m_file_size};
+
+                std::copy_if(m_entries.cbegin(), m_entries.cend(), std::back_inserter(index.m_entries), [&](const pbf_blob_index_entry& entry) {
+                    return entry.matches(read_types, from_id, to_id);
+                });
+
+                return index;
+            }
+
+            /**
+             * Write the index to a sidecar file.
+             *
+             * @param filename Name of the sidecar file.
+             * @throws std::system_error if the file can't be written.
+             */
+            void write(const std::string& filename) const {
+                std::string data{magic(), magic_size};
+                data.reserve(header_size + m_entries.size() * entry_size);
+
+                append<uint64_t>(data, m_file_size);
+                append<uint64_t>(data, m_entries.size());
+                for (const auto& entry : m_entries) {
+                    append<uint64_t>(data, entry.offset);
+                    append<uint32_t>(data, entry.size);
+                    append<uint32_t>(data, static_cast<uint32_t>(entry.types));
+                    append<int64_t>(data, entry.min_id);
+                    append<int64_t>(data, entry.max_id);
+                }
+
+                const int fd = osmium::io::detail::open_for_writing(filename, osmium::io::overwrite::allow);
+                osmium::io::detail::reliable_write(fd, data.data(), data.size());
+                osmium::io::detail::reliable_close(fd);
+            }
+
+            /**
+             * Read an index from a sidecar file.
+             *
+             * @param filename Name of the sidecar file.
+             * @throws std::system_error if the file can't be read.
+             * @throws osmium::io_error if the file is not a valid index.
+             */
+            static PBFBlobIndex read(const std::string& filename) {
+                const int fd = osmium::io::detail::open_for_reading(filename);
+                std::string data(osmium::file_size(fd), '\0');
+
+                std::size_t offset = 0;
+                while (offset < data.size()) {
+                    const auto nread = osmium::io::detail::reliable_read(fd, &data[offset], static_cast<unsigned int>(std::min<std::size_t>(data.size() - offset, 1024UL * 1024UL)));
+                    if (nread == 0) {
+                        break;
+                    }
+                    offset += static_cast<std::size_t>(nread);
+                }
+                osmium::io::detail::reliable_close(fd);
+
+                if (offset != data.size() || data.size() < header_size || data.compare(0, magic_size, magic()) != 0) {
+                    throw osmium::io_error{"Not a valid PBF blob index file: '" + filename + "'"};
+                }
+
+                const char* ptr = data.data() + magic_size;
+                PBFBlobIndex index{static_cast<std::size_t>(extract<uint64_t>(&ptr))};
+                const auto count = extract<uint64_t>(&ptr);
+
+                if ((data.size() - header_size) / entry_size != count ||
+                    (data.size() - header_size) % entry_size != 0) {
+                    throw osmium::io_error{"Not a valid PBF blob index file: '" + filename + "'"};
+                }
+
+                index.m_entries.reserve(static_cast<std::size_t>(count));
+                for (uint64_t n = 0; n < count; ++n) {
+                    pbf_blob_index_entry entry;
+                    entry.offset = extract<uint64_t>(&ptr);
+                    entry.size = extract<uint32_t>(&ptr);
+                    entry.types = static_cast<osmium::osm_entity_bits::type>(extract<uint32_t>(&ptr));
+                    entry.min_id = extract<int64_t>(&ptr);
+                    entry.max_id = extract<int64_t>(&ptr);
+                    index.m_entries.push_back(entry);
+                }
+
+                return index;
+            }
+
+        }; // class PBFBlobIndex
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_PBF_BLOB_INDEX_HPP
@@ -35,20 +35,27 @@ DEALINGS IN THE SOFTWARE.
 
 #include <osmium/io/compression.hpp>
 #include <osmium/io/detail/input_format.hpp>
+#include <osmium/io/detail/mapped_input.hpp>
 #include <osmium/io/detail/queue_util.hpp>
 #include <osmium/io/detail/read_thread.hpp>
 #include <osmium/io/detail/read_write.hpp>
 #include <osmium/io/error.hpp>
 #include <osmium/io/file.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/pbf_blob_index.hpp>
 #include <osmium/memory/buffer.hpp>
+#include <osmium/memory/buffer_pool.hpp>
 #include <osmium/osm/entity_bits.hpp>
 #include <osmium/thread/pool.hpp>
 #include <osmium/thread/util.hpp>
 #include <osmium/util/config.hpp>
+#include <osmium/util/file.hpp>
 
 #include <cerrno>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
+#include <deque>
 #include <fcntl.h>
 #include <future>
 #include <memory>
@@ -111,6 +118,8 @@ namespace osmium {
 
             detail::future_string_queue_type m_input_queue;
 
+            std::shared_ptr<detail::MappedInput> m_mapped_input{};
+
             std::unique_ptr<osmium::io::Decompressor> m_decompressor;
 
             osmium::io::detail::ReadThreadManager m_read_thread_manager;
@@ -128,6 +137,26 @@ namespace osmium {
             osmium::osm_entity_bits::type m_read_which_entities = osmium::osm_entity_bits::all;
             osmium::io::read_meta m_read_metadata = osmium::io::read_meta::yes;
 
+            std::shared_ptr<const osmium::io::PBFBlobIndex> m_blob_index{};
+
+            std::shared_ptr<osmium::memory::BufferPool> m_buffer_pool{};
+
+            osmium::io::read_order m_read_order = osmium::io::read_order::ordered;
+
+            // Futures taken from the osmdata queue that are not ready yet
+            // together with their sequence numbers. Only used when reading
+            // with read_order::unordered.
+            std::deque<std::pair<std::size_t, std::future<osmium::memory::Buffer>>> m_pending_buffers{};
+            std::size_t m_max_pending_buffers = 0;
+            bool m_end_of_data_seen = false;
+
+            // Notified by the decoding tasks when they are done. Only used
+            // when reading with read_order::unordered.
+            std::shared_ptr<detail::completion_signal> m_completion{};
+
+            std::size_t m_next_sequence_number = 0;
+            std::size_t m_sequence_number = 0;
+
             void set_option(osmium::thread::Pool& pool) noexcept {
                 m_pool = &pool;
             }
@@ -140,6 +169,126 @@ namespace osmium {
                 m_read_metadata = value;
             }
 
+            void set_option(const osmium::io::PBFBlobIndex& index) {
+                m_blob_index = std::make_shared<const osmium::io::PBFBlobIndex>(index);
+            }
+
+            void set_option(const std::shared_ptr<osmium::memory::BufferPool>& buffer_pool) noexcept {
+                m_buffer_pool = buffer_pool;
+            }
+
+            void set_option(osmium::io::read_order value) noexcept {
+                m_read_order = value;
+            }
+
+            static bool is_unordered(osmium::io::read_order value) noexcept {
+                return value == osmium::io::read_order::unordered;
+            }
+
+            template <typename T>
+            static bool is_unordered(const T& /*value*/) noexcept {
+                return false;
+            }
+
+            /**
+             * In unordered mode the futures taken out of the osmdata queue
+             * count against the configured queue size, so the queue itself
+             * only gets half of it and the rest is left for
+             * m_max_pending_buffers.
+             */
+            template <typename... TArgs>
+            static std::size_t osmdata_queue_size(const TArgs&... args) noexcept {
+                bool unordered = false;
+                (void)std::initializer_list<int>{
+                    (unordered = unordered || is_unordered(args), 0)...
+                };
+
+                const auto size = detail::get_osmdata_queue_size();
+                return unordered ? size / 2 : size;
+            }
+
+            osmium::memory::Buffer pop_ordered() {
+                m_sequence_number = m_next_sequence_number++;
+                return m_osmdata_queue_wrapper.pop();
+            }
+
+            /**
+             * Get the next buffer that is available regardless of its
+             * position in the queue. Data is decoded in parallel on the
+             * thread pool and buffers are returned in the order the
+             * decoding tasks finish, so one slow block doesn't hold up
+             * all others.
+             *
+             * At most m_max_pending_buffers futures are taken from the
+             * osmdata queue, so the queue still limits how much data is
+             * decoded ahead of the consumer.
+             */
+            osmium::memory::Buffer pop_unordered() {
+                while (true) {
+                    std::future<osmium::memory::Buffer> data_future;
+                    while (!m_end_of_data_seen &&
+                           m_pending_buffers.size() < m_max_pending_buffers &&
+                           m_osmdata_queue_wrapper.try_pop_future(data_future)) {
+                        m_pending_buffers.emplace_back(m_next_sequence_number++, std::move(data_future));
+                    }
+
+                    // Get the count before looking at the futures, so that
+                    // we don't miss a task finishing in between.
+                    const auto completed = m_completion->count();
+
+                    for (auto it = m_pending_buffers.begin(); it != m_pending_buffers.end(); ++it) {
+                        if (it->second.wait_for(std::chrono::seconds{0}) != std::future_status::ready) {
+                            continue;
+                        }
+                        const auto sequence_number = it->first;
+                        auto future = std::move(it->second);
+                        m_pending_buffers.erase(it);
+
+                        auto buffer = future.get();
+                        if (detail::at_end_of_data(buffer)) {
+                            // The end of data marker is always the last
+                            // element, but there might be unfinished
+                            // buffers before it.
+                            m_end_of_data_seen = true;
+                            m_osmdata_queue_wrapper.set_end_of_data();
+                            break;
+                        }
+                        m_sequence_number = sequence_number;
+                        return buffer;
+                    }
+
+                    if (m_end_of_data_seen && m_pending_buffers.empty()) {
+                        return osmium::memory::Buffer{};
+                    }
+
+                    if (m_pending_buffers.empty()) {
+                        m_pending_buffers.emplace_back(m_next_sequence_number++, m_osmdata_queue_wrapper.wait_and_pop_future());
+                    } else {
+                        // Nothing is ready yet. Futures not created on the
+                        // thread pool are ready when they are put into the
+                        // queue, so one of the pending futures is from a
+                        // decoding task. Wait until any such task is done.
+                        m_completion->wait_for_change(completed);
+                    }
+                }
+            }
+
+            // Wait for all futures already taken from the queue, so that
+            // the queue can be drained.
+            void drain_pending_buffers() noexcept {
+                for (auto& pending : m_pending_buffers) {
+                    try {
+                        auto buffer = pending.second.get();
+                        if (detail::at_end_of_data(buffer)) {
+                            m_osmdata_queue_wrapper.set_end_of_data();
+                        }
+                    } catch (...) {
+                        // Ignore any exceptions.
+                    }
+                }
+                m_pending_buffers.clear();
+            }
+
             // This function will run in a separate thread.
             static void parser_thread(osmium::thread::Pool& pool,
                                       const detail::ParserFactory::create_parser_type& creator,
@@ -147,7 +296,11 @@ namespace osmium {
                                       detail::future_buffer_queue_type& osmdata_queue,
                                       std::promise<osmium::io::Header>&& header_promise,
                                       osmium::osm_entity_bits::type read_which_entities,
-                                      osmium::io::read_meta read_metadata) {
+                                      osmium::io::read_meta read_metadata,
+                                      std::shared_ptr<detail::MappedInput> mapped_input,
+                                      std::shared_ptr<const osmium::io::PBFBlobIndex> blob_index,
+                                      std::shared_ptr<osmium::memory::BufferPool> buffer_pool,
+                                      std::shared_ptr<detail::completion_signal> completion) {
                 std::promise<osmium::io::Header> promise{std::move(header_promise)};
                 osmium::io::detail::parser_arguments args = {
                     pool,
@@ -155,7 +308,11 @@ namespace osmium {
                     osmdata_queue,
                     promise,
                     read_which_entities,
-                    read_metadata
+                    read_metadata,
+                    mapped_input,
+                    blob_index,
+                    buffer_pool,
+                    completion
                 };
                 creator(args)->parse();
             }
@@ -229,6 +386,50 @@ namespace osmium {
                 return osmium::io::detail::open_for_reading(filename);
             }
 
+            /**
+             * Should the input file be memory mapped instead of read through
+             * the read thread? This is only done if the user asked for it
+             * with the "pbf_mmap" file option and only for uncompressed PBF
+             * files on disk.
+             */
+            bool use_mapped_input() const {
+                return m_file.format() == file_format::pbf &&
+                       m_file.compression() == file_compression::none &&
+                       m_file.is_true("pbf_mmap") &&
+                       !m_file.filename().empty() &&
+                       m_file.filename() != "-" &&
+                       m_file.filename().find("://") == std::string::npos;
+            }
+
+            /**
+             * Open the input and create the decompressor for it. If the
+             * input is memory mapped, the decompressor created here never
+             * returns any data, because the parser gets all the data from
+             * the mapping.
+             */
+            std::unique_ptr<osmium::io::Decompressor> open_input() {
+                const auto& factory = osmium::io::CompressionFactory::instance();
+
+                if (m_file.buffer()) {
+                    return factory.create_decompressor(m_file.compression(), m_file.buffer(), m_file.buffer_size());
+                }
+
+                const int fd = open_input_file_or_url(m_file.filename(), &m_childpid);
+
+                if (use_mapped_input()) {
+                    const auto size = osmium::file_size(fd);
+                    if (size > 0) {
+                        m_mapped_input = std::make_shared<detail::MappedInput>(fd, size);
+                        osmium::io::detail::reliable_close(fd);
+                        auto decompressor = factory.create_decompressor(file_compression::none, m_mapped_input->data(), 0);
+                        decompressor->set_file_size(size);
+                        return decompressor;
+                    }
+                }
+
+                return factory.create_decompressor(m_file.compression(), fd);
+            }
+
         public:
 
             /**
@@ -250,6 +451,31 @@ namespace osmium {
              *      etc.) is not read possibly speeding up the read. Not all
              *      file formats use this setting.
              *
+             * * osmium::io::PBFBlobIndex: Only read the blobs listed in
+             *      this index. Only works for uncompressed PBF files read
+             *      with the "pbf_mmap=true" file option.
+             *
+             * * osmium::io::read_order: Set to
+             *      osmium::io::read_order::unordered if you don't need the
+             *      buffers in the order of the data in the file. Buffers
+             *      are returned as soon as they have been decoded then,
+             *      so one slow block doesn't stall the others. Only makes
+             *      a difference for formats decoded in parallel (PBF).
+             *      Use sequence_number() to find out where a buffer
+             *      belongs.
+             *
+             * * std::shared_ptr<osmium::memory::BufferPool>: Take buffers
+             *      for the data from this pool. Give buffers back to the
+             *      pool with recycle() once you are done with them so that
+             *      their memory can be re-used. The pool can be shared
+             *      between several readers. Currently only used by the
+             *      PBF parser.
+             *
+             * Uncompressed PBF files can be memory mapped instead of read
+             * through a pipeline of buffers. The blobs are then decoded
+             * directly from the mapping which saves a lot of copying. Set
+             * the file option "pbf_mmap=true" to enable this.
+             *
              * @throws osmium::io_error If there was an error.
              * @throws std::system_error If the file could not be opened.
              */
@@ -258,11 +484,9 @@ namespace osmium {
                 m_file(file.check()),
                 m_creator(detail::ParserFactory::instance().get_creator_function(m_file)),
                 m_input_queue(detail::get_input_queue_size(), "raw_input"),
-                m_decompressor(m_file.buffer() ?
-                    osmium::io::CompressionFactory::instance().create_decompressor(file.compression(), m_file.buffer(), m_file.buffer_size()) :
-                    osmium::io::CompressionFactory::instance().create_decompressor(file.compression(), open_input_file_or_url(m_file.filename(), &m_childpid))),
+                m_decompressor(open_input()),
                 m_read_thread_manager(*m_decompressor, m_input_queue),
-                m_osmdata_queue(detail::get_osmdata_queue_size(), "parser_results"),
+                m_osmdata_queue(osmdata_queue_size(args...), "parser_results"),
                 m_osmdata_queue_wrapper(m_osmdata_queue),
                 m_file_size(m_decompressor->file_size()) {
 
@@ -274,9 +498,14 @@ namespace osmium {
                     m_pool = &thread::Pool::default_instance();
                 }
 
+                if (m_read_order == osmium::io::read_order::unordered) {
+                    m_completion = std::make_shared<detail::completion_signal>();
+                    m_max_pending_buffers = detail::get_osmdata_queue_size() - osmdata_queue_size(args...);
+                }
+
                 std::promise<osmium::io::Header> header_promise;
                 m_header_future = header_promise.get_future();
-                m_thread = osmium::thread::thread_handler{parser_thread, std::ref(*m_pool), std::ref(m_creator), std::ref(m_input_queue), std::ref(m_osmdata_queue), std::move(header_promise), m_read_which_entities, m_read_metadata};
+                m_thread = osmium::thread::thread_handler{parser_thread, std::ref(*m_pool), std::ref(m_creator), std::ref(m_input_queue), std::ref(m_osmdata_queue), std::move(header_promise), m_read_which_entities, m_read_metadata, m_mapped_input, m_blob_index, m_buffer_pool, m_completion};
             }
 
             template <typename... TArgs>
@@ -316,6 +545,7 @@ namespace osmium {
 
                 m_read_thread_manager.stop();
 
+                drain_pending_buffers();
                 m_osmdata_queue_wrapper.drain();
 
                 try {
@@ -400,7 +630,7 @@ namespace osmium {
                     // without data is not an error, it just means we have to
                     // keep getting the next buffer until there is one with data.
                     while (true) {
-                        buffer = m_osmdata_queue_wrapper.pop();
+                        buffer = m_read_order == osmium::io::read_order::ordered ? pop_ordered() : pop_unordered();
                         if (detail::at_end_of_data(buffer)) {
                             m_status = status::eof;
                             m_read_thread_manager.close();
@@ -421,6 +651,34 @@ namespace osmium {
                 }
             }
 
+            /**
+             * The sequence number of the block the last buffer returned by
+             * read() belongs to. Blocks are numbered in the order they
+             * appear in the input file starting from 0. If a block results
+             * in several buffers, they all get the same sequence number
+             * and are returned in order.
+             *
+             * This is mostly useful when reading with
+             * osmium::io::read_order::unordered to restore the original
+             * order later. Numbers can be missing in the sequence if
+             * blocks contain no data.
+             */
+            std::size_t sequence_number() const noexcept {
+                return m_sequence_number;
+            }
+
+            /**
+             * Give a buffer you got from read() back to the reader once you
+             * don't need it any more. If the reader was created with a
+             * buffer pool, the memory of the buffer will be re-used for
+             * new data, otherwise this does nothing.
+             */
+            void recycle(osmium::memory::Buffer&& buffer) {
+                if (m_buffer_pool) {
+                    m_buffer_pool->put(std::move(buffer));
+                }
+            }
+
             /**
              * Has the end of file been reached? This is set after the last
              * data has been read. It is also set by calling close().
@@ -452,6 +710,9 @@ namespace osmium {
              * do an expensive system call.
              */
             std::size_t offset() const noexcept {
+                if (m_mapped_input) {
+                    return m_mapped_input->offset();
+                }
                 return m_decompressor->offset();
             }
 
@@ -0,0 +1,159 @@
+#ifndef OSMIUM_MEMORY_BUFFER_POOL_HPP
+#define OSMIUM_MEMORY_BUFFER_POOL_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/memory/buffer.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace memory {
+
+        /**
+         * A thread-safe pool of buffers whose memory can be re-used.
+         *
+         * Buffers that are not needed any more can be given back to the
+         * pool with put(). Instead of allocating new memory, get() will
+         * hand out one of those buffers (cleared) if available. This
+         * avoids many large allocations and deallocations on different
+         * threads, which can lead to memory fragmentation.
+         *
+         * Only buffers with internal memory management are kept in the
+         * pool, nested buffers are kept as separate buffers. If the pool
+         * already contains max_buffers buffers, additional buffers given
+         * back to it are freed.
+         *
+         * Usually you don't use this directly but give a pool to the
+         * osmium::io::Reader and call osmium::io::Reader::recycle() on
+         * each buffer you got from the reader once you are done with it.
+         */
+        class BufferPool {
+
+            mutable std::mutex m_mutex{};
+            std::vector<Buffer> m_buffers{};
+            std::size_t m_max_buffers;
+
+        public:
+
+            enum {
+                default_max_buffers = 64
+            };
+
+            /**
+             * Create a buffer pool.
+             *
+             * @param max_buffers The maximum number of buffers kept in the
+             *                    pool.
+             */
+            explicit BufferPool(std::size_t max_buffers = default_max_buffers) :
+                m_max_buffers(max_buffers) {
+            }
+
+            BufferPool(const BufferPool&) = delete;
+            BufferPool& operator=(const BufferPool&) = delete;
+
+            BufferPool(BufferPool&&) = delete;
+            BufferPool& operator=(BufferPool&&) = delete;
+
+            ~BufferPool() noexcept = default;
+
+            /// The number of buffers currently in the pool.
+            std::size_t size() const {
+                const std::lock_guard<std::mutex> lock{m_mutex};
+                return m_buffers.size();
+            }
+
+            /**
+             * Get an empty buffer. Returns a buffer from the pool if there
+             * is one, otherwise a newly allocated buffer. Buffers from the
+             * pool keep the capacity they had, so the capacity of the
+             * returned buffer can be (much) larger than requested.
+             *
+             * @param capacity The minimum capacity of the buffer.
+             * @param auto_grow Should the buffer grow automatically?
+             */
+            Buffer get(std::size_t capacity, Buffer::auto_grow auto_grow = Buffer::auto_grow::yes) {
+                Buffer buffer;
+
+                {
+                    const std::lock_guard<std::mutex> lock{m_mutex};
+                    if (m_buffers.empty()) {
+                        return Buffer{capacity, auto_grow};
+                    }
+                    buffer = std::move(m_buffers.back());
+                    m_buffers.pop_back();
+                }
+
+                buffer.m_auto_grow = auto_grow;
+                buffer.m_full = nullptr;
+                if (buffer.capacity() < capacity) {
+                    buffer.grow(capacity);
+                }
+
+                return buffer;
+            }
+
+            /**
+             * Give a buffer back to the pool. The content of the buffer
+             * is discarded. Invalid buffers and buffers with external
+             * memory management are ignored.
+             */
+            void put(Buffer&& buffer) {
+                while (buffer.has_nested_buffers()) {
+                    put(std::move(*buffer.get_last_nested()));
+                }
+
+                if (!buffer.m_memory) {
+                    return;
+                }
+
+                buffer.clear();
+
+                const std::lock_guard<std::mutex> lock{m_mutex};
+                if (m_buffers.size() < m_max_buffers) {
+                    m_buffers.push_back(std::move(buffer));
+                }
+            }
+
+        }; // class BufferPool
+
+    } // namespace memory
+
+} // namespace osmium
+
+#endif // OSMIUM_MEMORY_BUFFER_POOL_HPP
@@ -0,0 +1,225 @@
+#ifndef OSMIUM_PARALLEL_VISITOR_HPP
+#define OSMIUM_PARALLEL_VISITOR_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/io/reader.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/visitor.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace detail {
+
+        /**
+         * Holds one handler per worker thread. A task takes a handler
+         * out, applies it to a buffer and puts it back. There are at
+         * least as many handlers as there are pool threads, so usually
+         * there is a free one. If not, acquire() blocks until another
+         * task releases its handler.
+         */
+        template <typename THandler>
+        class handler_set {
+
+            std::vector<THandler> m_handlers;
+            std::vector<std::size_t> m_free;
+            std::mutex m_mutex;
+            std::condition_variable m_released;
+
+        public:
+
+            template <typename THandlerFactory>
+            handler_set(THandlerFactory&& factory, std::size_t count) {
+                m_handlers.reserve(count);
+                m_free.reserve(count);
+                for (std::size_t i = 0; i < count; ++i) {
+                    m_handlers.push_back(factory());
+                    m_free.push_back(i);
+                }
+            }
+
+            std::size_t acquire() {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_released.wait(lock, [this]() {
+                    return !m_free.empty();
+                });
+                const auto n = m_free.back();
+                m_free.pop_back();
+                return n;
+            }
+
+            void release(std::size_t n) {
+                {
+                    const std::lock_guard<std::mutex> lock{m_mutex};
+                    m_free.push_back(n);
+                }
+                m_released.notify_one();
+            }
+
+            THandler& operator[](std::size_t n) noexcept {
+                return m_handlers[n];
+            }
+
+            std::vector<THandler>& handlers() noexcept {
+                return m_handlers;
+            }
+
+        }; // class handler_set
+
+        template <typename THandler>
+        class apply_buffer_task {
+
+            handler_set<THandler>* m_handlers;
+            osmium::memory::Buffer m_buffer;
+
+        public:
+
+            apply_buffer_task(handler_set<THandler>& handlers, osmium::memory::Buffer&& buffer) :
+                m_handlers(&handlers),
+                m_buffer(std::move(buffer)) {
+            }
+
+            osmium::memory::Buffer operator()() {
+                const auto n = m_handlers->acquire();
+                try {
+                    auto& handler = (*m_handlers)[n];
+                    for (auto it = m_buffer.cbegin(); it != m_buffer.cend(); ++it) {
+                        osmium::apply_item(*it, handler);
+                    }
+                } catch (...) {
+                    m_handlers->release(n);
+                    throw;
+                }
+                m_handlers->release(n);
+                return std::move(m_buffer);
+            }
+
+        }; // class apply_buffer_task
+
+    } // namespace detail
+
+    /**
+     * Read all data from the reader and apply handlers to it in parallel
+     * on the threads of the pool.
+     *
+     * The handler factory is called to create one handler per pool
+     * thread. Each buffer from the reader is given to exactly one of the
+     * handlers. Buffers are processed in no particular order, so this
+     * only works for handlers that don't depend on the order of the data
+     * (counting, statistics, filtering into unsorted output, ...). The
+     * handlers have to be derived from osmium::handler::Handler.
+     *
+     * After all data has been processed, flush() is called on all
+     * handlers and then all handlers are merged into the first one by
+     * calling `merge(first, other)` for every other handler. The first
+     * handler is returned.
+     *
+     * Buffers are given back to the reader with Reader::recycle() after
+     * they have been processed, so if the reader was created with a
+     * buffer pool their memory will be re-used.
+     *
+     * Note that each handler is called from different threads over its
+     * lifetime (but never from more than one at the same time). Any
+     * state shared between handlers must be protected by the caller.
+     *
+     * @param reader The reader to read from.
+     * @param factory Function returning a new handler.
+     * @param merge Function called as merge(THandler&, THandler&) to
+     *              merge the second handler into the first.
+     * @param pool The thread pool to use.
+     * @returns The merged handler.
+     */
+    template <typename THandlerFactory, typename TMerge>
+    typename std::decay<typename std::result_of<THandlerFactory()>::type>::type
+    apply_parallel(osmium::io::Reader& reader, THandlerFactory&& factory, TMerge&& merge, osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) {
+        using handler_type = typename std::decay<typename std::result_of<THandlerFactory()>::type>::type;
+
+        const auto num_handlers = static_cast<std::size_t>(pool.num_threads());
+        detail::handler_set<handler_type> handlers{std::forward<THandlerFactory>(factory), num_handlers};
+
+        // Limit number of buffers in flight so that we don't read the
+        // whole file into memory if the handlers are slower than the
+        // reader.
+        const std::size_t max_pending = 2 * num_handlers;
+        std::deque<std::future<osmium::memory::Buffer>> pending;
+
+        try {
+            while (auto buffer = reader.read()) {
+                pending.push_back(pool.submit(detail::apply_buffer_task<handler_type>{handlers, std::move(buffer)}));
+                while (pending.size() > max_pending || (!pending.empty() && pending.front().wait_for(std::chrono::seconds{0}) == std::future_status::ready)) {
+                    reader.recycle(pending.front().get());
+                    pending.pop_front();
+                }
+            }
+
+            while (!pending.empty()) {
+                reader.recycle(pending.front().get());
+                pending.pop_front();
+            }
+        } catch (...) {
+            // The tasks still running reference the handlers, so we have
+            // to wait for them before leaving this function.
+            for (auto& future : pending) {
+                if (future.valid()) {
+                    future.wait();
+                }
+            }
+            throw;
+        }
+
+        auto& all = handlers.handlers();
+        for (auto& handler : all) {
+            osmium::apply_flush(handler);
+        }
+
+        for (std::size_t i = 1; i < all.size(); ++i) {
+            merge(all.front(), all[i]);
+        }
+
+        return std::move(all.front());
+    }
+
+} // namespace osmium
+
+#endif // OSMIUM_PARALLEL_VISITOR_HPP
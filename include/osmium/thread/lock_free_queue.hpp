@@ -0,0 +1,344 @@
+#ifndef OSMIUM_THREAD_LOCK_FREE_QUEUE_HPP
+#define OSMIUM_THREAD_LOCK_FREE_QUEUE_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility> // IWYU pragma: keep
+
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+# include <iostream>
+#endif
+
+namespace osmium {
+
+    namespace thread {
+
+        namespace detail {
+
+            /**
+             * Used while waiting on a lock-free queue: Call func() until
+             * it returns true, first spinning for a short time, then
+             * yielding to other threads. Returns false if func() did not
+             * succeed, the caller should then block.
+             */
+            template <typename TFunc>
+            bool queue_spin(TFunc&& func) {
+                for (unsigned int count = 0; count < 128; ++count) {
+                    if (func()) {
+                        return true;
+                    }
+                    if (count >= 64) {
+                        std::this_thread::yield();
+                    }
+                }
+                return false;
+            }
+
+        } // namespace detail
+
+        /**
+         * A thread-safe bounded queue based on a ring buffer without
+         * locks. (This is the well-known multi-producer/multi-consumer
+         * algorithm by Dmitry Vyukov.) It has the same interface as the
+         * osmium::thread::Queue class and can be used instead of it by
+         * defining OSMIUM_USE_LOCK_FREE_QUEUE before including any
+         * Osmium headers.
+         *
+         * Threads waiting in push() or wait_and_pop() spin for a short
+         * while and then sleep on a condition variable. The mutex is only
+         * used if there are sleeping threads, but every push and pop
+         * needs a full memory fence to check for them.
+         *
+         * Unlike the osmium::thread::Queue this queue can not be
+         * unbounded. If a max_size of 0 is given, default_max_size is
+         * used. The algorithm needs at least two slots, so a max_size of
+         * 1 is rounded up to 2.
+         *
+         * T must be default constructible and move assignable.
+         */
+        template <typename T>
+        class LockFreeQueue {
+
+            struct cell {
+                std::atomic<std::size_t> sequence;
+                T value;
+            };
+
+        public:
+
+            enum : std::size_t {
+                default_max_size = 1024
+            };
+
+        private:
+
+            /// Maximum size of this queue. If the queue is full pushing to
+            /// the queue will block.
+            const std::size_t m_max_size;
+
+            /// Name of this queue (for debugging only).
+            const std::string m_name;
+
+            std::unique_ptr<cell[]> m_cells;
+
+            // Head and tail are kept on different cache lines so that
+            // producers and consumers don't get in each other's way.
+            // (Padding is used instead of alignas() because over-aligned
+            // types can not be safely allocated with new before C++17.)
+            char m_padding1[64] = {};
+            std::atomic<std::size_t> m_enqueue_pos{0};
+            char m_padding2[64] = {};
+            std::atomic<std::size_t> m_dequeue_pos{0};
+            char m_padding3[64] = {};
+
+            // Only used by threads blocking because the queue is empty
+            // or full and by threads waking them up.
+            std::mutex m_mutex;
+            std::condition_variable m_not_empty;
+            std::condition_variable m_not_full;
+            std::atomic<int> m_waiting_poppers{0};
+            std::atomic<int> m_waiting_pushers{0};
+
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+            /// The largest size the queue has been so far.
+            std::atomic<std::size_t> m_largest_size{0};
+
+            /// The number of times push() was called on the queue.
+            std::atomic<int> m_push_counter{0};
+
+            /// The number of times the queue was full and a thread pushing
+            /// to the queue was blocked.
+            std::atomic<int> m_full_counter{0};
+
+            /**
+             * The number of times wait_and_pop(with_timeout)() was called
+             * on the queue.
+             */
+            std::atomic<int> m_pop_counter{0};
+
+            /// The number of times the queue was empty and a thread
+            /// popping from the queue had to wait.
+            std::atomic<int> m_empty_counter{0};
+
+            void update_largest_size() noexcept {
+                const auto current = size();
+                auto largest = m_largest_size.load(std::memory_order_relaxed);
+                while (largest < current &&
+                       !m_largest_size.compare_exchange_weak(largest, current, std::memory_order_relaxed)) {
+                }
+            }
+#endif
+
+            bool try_push(T& value) {
+                auto pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                while (true) {
+                    cell& c = m_cells[pos % m_max_size];
+                    const auto seq = c.sequence.load(std::memory_order_acquire);
+                    if (seq == pos) {
+                        if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            c.value = std::move(value);
+                            c.sequence.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (seq < pos) {
+                        return false; // full
+                    } else {
+                        pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            bool try_pop_impl(T& value) {
+                auto pos = m_dequeue_pos.load(std::memory_order_relaxed);
+                while (true) {
+                    cell& c = m_cells[pos % m_max_size];
+                    const auto seq = c.sequence.load(std::memory_order_acquire);
+                    if (seq == pos + 1) {
+                        if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            value = std::move(c.value);
+                            c.value = T{};
+                            c.sequence.store(pos + m_max_size, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (seq < pos + 1) {
+                        return false; // empty
+                    } else {
+                        pos = m_dequeue_pos.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // The fence here and the one in block_until() make sure that
+            // either the waiting thread sees the change to the queue or
+            // this thread sees the waiting thread.
+            static void wake_up(std::mutex& mutex, std::condition_variable& cv, const std::atomic<int>& waiting) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (waiting.load(std::memory_order_relaxed) > 0) {
+                    // Taking the mutex makes sure the waiting thread is
+                    // either not checking the queue any more or not yet.
+                    {
+                        const std::lock_guard<std::mutex> lock{mutex};
+                    }
+                    cv.notify_one();
+                }
+            }
+
+            template <typename TFunc>
+            void block_until(std::condition_variable& cv, std::atomic<int>& waiting, TFunc&& func) {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                ++waiting;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                cv.wait(lock, std::forward<TFunc>(func));
+                --waiting;
+            }
+
+        public:
+
+            /**
+             * Construct a multithreaded queue.
+             *
+             * @param max_size Maximum number of elements in the queue. Set to
+             *                 0 for the default size.
+             * @param name Optional name for this queue. (Used for debugging.)
+             */
+            explicit LockFreeQueue(std::size_t max_size = 0, std::string name = "") :
+                m_max_size(max_size == 0 ? static_cast<std::size_t>(default_max_size) : (max_size < 2 ? 2 : max_size)),
+                m_name(std::move(name)),
+                m_cells(new cell[m_max_size]) {
+                for (std::size_t i = 0; i < m_max_size; ++i) {
+                    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            LockFreeQueue(const LockFreeQueue&) = delete;
+            LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+            LockFreeQueue(LockFreeQueue&&) = delete;
+            LockFreeQueue& operator=(LockFreeQueue&&) = delete;
+
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+            ~LockFreeQueue() {
+                std::cerr << "queue '" << m_name
+                          << "' with max_size=" << m_max_size
+                          << " had largest size " << m_largest_size
+                          << " and was full " << m_full_counter
+                          << " times in " << m_push_counter
+                          << " push() calls and was empty " << m_empty_counter
+                          << " times in " << m_pop_counter
+                          << " pop() calls\n";
+            }
+#else
+            ~LockFreeQueue() = default;
+#endif
+
+            /**
+             * Push an element onto the queue. If the queue is full, this
+             * call will block.
+             */
+            void push(T value) {
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                ++m_push_counter;
+#endif
+                const auto func = [&]() {
+                    return try_push(value);
+                };
+                if (!detail::queue_spin(func)) {
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                    ++m_full_counter;
+#endif
+                    block_until(m_not_full, m_waiting_pushers, func);
+                }
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                update_largest_size();
+#endif
+                wake_up(m_mutex, m_not_empty, m_waiting_poppers);
+            }
+
+            void wait_and_pop(T& value) {
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                ++m_pop_counter;
+#endif
+                const auto func = [&]() {
+                    return try_pop_impl(value);
+                };
+                if (!detail::queue_spin(func)) {
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                    ++m_empty_counter;
+#endif
+                    block_until(m_not_empty, m_waiting_poppers, func);
+                }
+                wake_up(m_mutex, m_not_full, m_waiting_pushers);
+            }
+
+            bool try_pop(T& value) {
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                ++m_pop_counter;
+#endif
+                if (try_pop_impl(value)) {
+                    wake_up(m_mutex, m_not_full, m_waiting_pushers);
+                    return true;
+                }
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                ++m_empty_counter;
+#endif
+                return false;
+            }
+
+            bool empty() const noexcept {
+                return size() == 0;
+            }
+
+            /**
+             * The number of elements in the queue. This is only a snapshot
+             * if other threads are using the queue at the same time.
+             */
+            std::size_t size() const noexcept {
+                const auto dequeue_pos = m_dequeue_pos.load(std::memory_order_acquire);
+                const auto enqueue_pos = m_enqueue_pos.load(std::memory_order_acquire);
+                return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+            }
+
+        }; // class LockFreeQueue
+
+    } // namespace thread
+
+} // namespace osmium
+
+#endif // OSMIUM_THREAD_LOCK_FREE_QUEUE_HPP
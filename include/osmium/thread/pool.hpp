@@ -38,8 +38,14 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/thread/util.hpp>
 #include <osmium/util/config.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <type_traits>
 #include <utility>
@@ -119,13 +125,101 @@ namespace osmium {
 
             }; // class thread_joiner
 
+            /**
+             * Per-worker task deque used in work stealing mode. The owner
+             * takes tasks from the back, other workers steal from the
+             * front.
+             */
+            struct worker_queue {
+                std::mutex mutex;
+                std::deque<function_wrapper> tasks;
+            };
+
+            /// Identifies the pool and worker the current thread belongs to.
+            /// The index is only used in work stealing mode.
+            struct worker_context {
+                const Pool* pool = nullptr;
+                std::size_t index = 0;
+            };
+
+            static worker_context& current_worker() noexcept {
+                static thread_local worker_context context;
+                return context;
+            }
+
             osmium::thread::Queue<function_wrapper> m_work_queue;
+
+            // These are only used in work stealing mode. They must be
+            // declared before m_joiner so that they are still alive
+            // while the worker threads are joined.
+            std::vector<std::unique_ptr<worker_queue>> m_worker_queues{};
+            std::atomic<std::size_t> m_local_tasks{0};
+            std::mutex m_wake_mutex{};
+            std::condition_variable m_wake{};
+            bool m_work_stealing;
+
             std::vector<std::thread> m_threads{};
             thread_joiner m_joiner;
             int m_num_threads;
 
+            void wake_workers() {
+                if (m_work_stealing) {
+                    {
+                        std::lock_guard<std::mutex> lock{m_wake_mutex};
+                    }
+                    m_wake.notify_all();
+                }
+            }
+
+            void push_local(std::size_t index, function_wrapper&& task) {
+                {
+                    auto& queue = *m_worker_queues[index];
+                    std::lock_guard<std::mutex> lock{queue.mutex};
+                    queue.tasks.push_back(std::move(task));
+                    ++m_local_tasks;
+                }
+                {
+                    std::lock_guard<std::mutex> lock{m_wake_mutex};
+                }
+                m_wake.notify_one();
+            }
+
+            bool pop_local(std::size_t index, function_wrapper& task) {
+                auto& queue = *m_worker_queues[index];
+                std::lock_guard<std::mutex> lock{queue.mutex};
+                if (queue.tasks.empty()) {
+                    return false;
+                }
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                --m_local_tasks;
+                return true;
+            }
+
+            bool steal(std::size_t index, function_wrapper& task) {
+                const auto size = m_worker_queues.size();
+                for (std::size_t n = 1; n < size; ++n) {
+                    auto& queue = *m_worker_queues[(index + n) % size];
+                    std::lock_guard<std::mutex> lock{queue.mutex};
+                    if (!queue.tasks.empty()) {
+                        task = std::move(queue.tasks.front());
+                        queue.tasks.pop_front();
+                        --m_local_tasks;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            bool find_task(std::size_t index, function_wrapper& task) {
+                return pop_local(index, task) ||
+                       m_work_queue.try_pop(task) ||
+                       steal(index, task);
+            }
+
             void worker_thread() {
                 osmium::thread::set_thread_name("_osmium_worker");
+                current_worker().pool = this;
                 while (true) {
                     function_wrapper task;
                     m_work_queue.wait_and_pop(task);
@@ -137,6 +231,32 @@ namespace osmium {
                 }
             }
 
+            void work_stealing_worker_thread(std::size_t index) {
+                osmium::thread::set_thread_name("_osmium_worker");
+                auto& context = current_worker();
+                context.pool = this;
+                context.index = index;
+                while (true) {
+                    function_wrapper task;
+                    if (find_task(index, task)) {
+                        if (task && task()) {
+                            // Shut down, but run the tasks still in our
+                            // own deque first, nobody else might pick
+                            // them up.
+                            while (pop_local(index, task)) {
+                                task();
+                            }
+                            return;
+                        }
+                        continue;
+                    }
+                    std::unique_lock<std::mutex> lock{m_wake_mutex};
+                    m_wake.wait_for(lock, std::chrono::milliseconds{10}, [this] {
+                        return m_local_tasks > 0 || !m_work_queue.empty();
+                    });
+                }
+            }
+
         public:
 
             enum {
@@ -147,6 +267,17 @@ namespace osmium {
                 default_queue_size = 0U
             };
 
+            /// How tasks are distributed to the worker threads.
+            enum class scheduling {
+                shared_queue = 0,
+                work_stealing = 1
+            };
+
+            static scheduling default_scheduling() noexcept {
+                return osmium::config::use_work_stealing_pool() ? scheduling::work_stealing
+                                                                : scheduling::shared_queue;
+            }
+
             /**
              * Create thread pool with the given number of threads. If
              * num_threads is 0, the number of threads is read from
@@ -161,15 +292,33 @@ namespace osmium {
              *
              * If max_queue_size is 0, the queue size is read from
              * the environment variable OSMIUM_MAX_WORK_QUEUE_SIZE.
+             *
+             * If scheduling is work_stealing, each worker thread gets its
+             * own task deque. Tasks submitted from inside a pool task go
+             * into the deque of the worker running it instead of the shared
+             * work queue, and idle workers steal tasks from the other
+             * workers' deques. Tasks submitted from outside the pool still
+             * go through the shared (bounded) work queue. The default is
+             * read from the environment variable OSMIUM_POOL_WORK_STEALING.
              */
-            explicit Pool(int num_threads = default_num_threads, std::size_t max_queue_size = default_queue_size) :
+            explicit Pool(int num_threads = default_num_threads, std::size_t max_queue_size = default_queue_size, scheduling sched = default_scheduling()) :
                 m_work_queue(max_queue_size > 0 ? max_queue_size : detail::get_work_queue_size(), "work"),
+                m_work_stealing(sched == scheduling::work_stealing),
                 m_joiner(m_threads),
                 m_num_threads(detail::get_pool_size(num_threads, osmium::config::get_pool_threads(), std::thread::hardware_concurrency())) {
 
                 try {
+                    if (m_work_stealing) {
+                        for (int i = 0; i < m_num_threads; ++i) {
+                            m_worker_queues.emplace_back(new worker_queue{});
+                        }
+                    }
                     for (int i = 0; i < m_num_threads; ++i) {
-                        m_threads.emplace_back(&Pool::worker_thread, this);
+                        if (m_work_stealing) {
+                            m_threads.emplace_back(&Pool::work_stealing_worker_thread, this, static_cast<std::size_t>(i));
+                        } else {
+                            m_threads.emplace_back(&Pool::worker_thread, this);
+                        }
                     }
                 } catch (...) {
                     shutdown_all_workers();
@@ -187,6 +336,7 @@ namespace osmium {
                     // The special function wrapper makes a worker shut down.
                     m_work_queue.push(function_wrapper{0});
                 }
+                wake_workers();
             }
 
             Pool(const Pool&) = delete;
@@ -203,12 +353,26 @@ namespace osmium {
                 return m_num_threads;
             }
 
+            bool work_stealing() const noexcept {
+                return m_work_stealing;
+            }
+
+            /**
+             * Is the current thread one of the worker threads of this
+             * pool? Code running in a task can use this to find out
+             * whether it would deadlock waiting for other tasks on the
+             * same pool.
+             */
+            bool is_worker_thread() const noexcept {
+                return current_worker().pool == this;
+            }
+
             std::size_t queue_size() const {
-                return m_work_queue.size();
+                return m_work_queue.size() + m_local_tasks;
             }
 
             bool queue_empty() const {
-                return m_work_queue.empty();
+                return m_work_queue.empty() && m_local_tasks == 0;
             }
 
             template <typename TFunction>
@@ -217,7 +381,18 @@ namespace osmium {
 
                 std::packaged_task<result_type()> task{std::forward<TFunction>(func)};
                 std::future<result_type> future_result{task.get_future()};
-                m_work_queue.push(std::move(task));
+
+                if (m_work_stealing) {
+                    const auto& context = current_worker();
+                    if (context.pool == this) {
+                        push_local(context.index, function_wrapper{std::move(task)});
+                    } else {
+                        m_work_queue.push(std::move(task));
+                        wake_workers();
+                    }
+                } else {
+                    m_work_queue.push(std::move(task));
+                }
 
                 return future_result;
             }
@@ -41,6 +41,10 @@ DEALINGS IN THE SOFTWARE.
 #include <string>
 #include <utility> // IWYU pragma: keep
 
+#ifdef OSMIUM_USE_LOCK_FREE_QUEUE
+# include <osmium/thread/lock_free_queue.hpp>
+#endif
+
 #ifdef OSMIUM_DEBUG_QUEUE_SIZE
 # include <atomic>
 # include <iostream>
@@ -50,6 +54,17 @@ namespace osmium {
 
     namespace thread {
 
+#ifdef OSMIUM_USE_LOCK_FREE_QUEUE
+
+        /**
+         * If OSMIUM_USE_LOCK_FREE_QUEUE is defined, the lock-free ring
+         * buffer implementation is used for all queues.
+         */
+        template <typename T>
+        using Queue = LockFreeQueue<T>;
+
+#else
+
         /**
          *  A thread-safe queue.
          */
@@ -226,6 +241,8 @@ namespace osmium {
 
         }; // class Queue
 
+#endif
+
     } // namespace thread
 
 } // namespace osmium
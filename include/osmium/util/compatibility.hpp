@@ -51,4 +51,11 @@ DEALINGS IN THE SOFTWARE.
 # define OSMIUM_DEPRECATED
 #endif
 
+// Hint to the CPU that the memory at this address will be read soon
+#ifdef __GNUC__
+# define OSMIUM_PREFETCH(address) __builtin_prefetch(address)
+#else
+# define OSMIUM_PREFETCH(address)
+#endif
+
 #endif // OSMIUM_UTIL_COMPATIBILITY_HPP
@@ -55,6 +55,21 @@ namespace osmium {
         }
 #endif
 
+        /**
+         * Returns true if the environment variable is set to "on", "true",
+         * "yes", or "1" (case-insensitive).
+         */
+        inline bool env_is_true(const char* var) noexcept {
+            const auto env = getenv_wrapper(var);
+            if (env) {
+                return !strcasecmp(env, "on") ||
+                       !strcasecmp(env, "true") ||
+                       !strcasecmp(env, "yes") ||
+                       !strcasecmp(env, "1");
+            }
+            return false;
+        }
+
     } // namespace detail
 
     namespace config {
@@ -80,6 +95,30 @@ namespace osmium {
             return true;
         }
 
+        inline bool use_work_stealing_pool() noexcept {
+            return osmium::detail::env_is_true("OSMIUM_POOL_WORK_STEALING");
+        }
+
+        inline bool use_parallel_bzip2() noexcept {
+            return osmium::detail::env_is_true("OSMIUM_USE_PARALLEL_BZIP2");
+        }
+
+        inline bool use_parallel_gzip() noexcept {
+            return osmium::detail::env_is_true("OSMIUM_USE_PARALLEL_GZIP");
+        }
+
+        inline bool use_parallel_xml_parsing() noexcept {
+            return osmium::detail::env_is_true("OSMIUM_USE_PARALLEL_XML_PARSING");
+        }
+
+        inline bool use_xml_pull_parser() noexcept {
+            return osmium::detail::env_is_true("OSMIUM_USE_XML_PULL_PARSER");
+        }
+
+        inline bool use_parallel_o5m_decoding() noexcept {
+            return osmium::detail::env_is_true("OSMIUM_USE_PARALLEL_O5M_DECODING");
+        }
+
         inline std::size_t get_max_queue_size(const char* queue_name, const std::size_t default_value) noexcept {
             assert(queue_name);
             std::string name{"OSMIUM_MAX_"};
@@ -39,6 +39,7 @@ DEALINGS IN THE SOFTWARE.
 #include <cassert>
 #include <cerrno>
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 #include <system_error>
 
@@ -96,10 +97,19 @@ namespace osmium {
 
         public:
 
+            /**
+             * The write_private_huge mode is the same as write_private,
+             * but on Linux the kernel is asked to back the mapping with
+             * transparent huge pages (using madvise(MADV_HUGEPAGE)). This
+             * reduces TLB misses for large mappings accessed in random
+             * order. Only anonymous mappings can use huge pages. If they
+             * are not available, normal pages are used.
+             */
             enum class mapping_mode {
-                readonly      = 0,
-                write_private = 1,
-                write_shared  = 2
+                readonly           = 0,
+                write_private      = 1,
+                write_shared       = 2,
+                write_private_huge = 3
             };
 
         private:
@@ -127,6 +137,12 @@ namespace osmium {
 
             void make_invalid() noexcept;
 
+            void advise_huge_pages() noexcept;
+
+#ifdef __linux__
+            void resize_huge(std::size_t new_size);
+#endif
+
 #ifdef _WIN32
             using flag_type = DWORD;
 #else
@@ -543,8 +559,58 @@ inline void osmium::util::MemoryMapping::make_invalid() noexcept {
     m_addr = MAP_FAILED; // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
 }
 
+#ifdef __linux__
+inline void osmium::util::MemoryMapping::resize_huge(std::size_t new_size) {
+    // Try to resize in place first.
+    void* addr = ::mremap(m_addr, m_size, new_size, 0);
+
+    if (addr == MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+        // Otherwise move the mapping to an address aligned to the (usual)
+        // huge page size. If the new address is not aligned, the kernel has
+        // to split all huge pages into normal pages when moving them. We
+        // get an aligned address range by mapping more memory than needed
+        // and giving back the parts before and after the aligned range.
+        constexpr std::uintptr_t huge_page_size = 2UL * 1024UL * 1024UL;
+        const std::size_t pagesize = osmium::get_pagesize();
+        const std::size_t size = (new_size + pagesize - 1) / pagesize * pagesize;
+
+        void* area = ::mmap(nullptr, size + huge_page_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0); // NOLINT(hicpp-signed-bitwise)
+        if (area == MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+            throw std::system_error{errno, std::system_category(), "mmap failed"};
+        }
+        const auto start = reinterpret_cast<std::uintptr_t>(area);
+        const auto aligned = (start + huge_page_size - 1) & ~(huge_page_size - 1);
+        if (aligned > start) {
+            ::munmap(area, aligned - start);
+        }
+        ::munmap(reinterpret_cast<void*>(aligned + size), start + huge_page_size - aligned);
+
+        addr = ::mremap(m_addr, m_size, new_size, MREMAP_MAYMOVE | MREMAP_FIXED, reinterpret_cast<void*>(aligned)); // NOLINT(hicpp-signed-bitwise)
+        if (addr == MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+            const int error = errno;
+            ::munmap(reinterpret_cast<void*>(aligned), size);
+            throw std::system_error{error, std::system_category(), "mremap failed"};
+        }
+    }
+
+    m_addr = addr;
+    m_size = new_size;
+    advise_huge_pages();
+}
+#endif
+
 #pragma GCC diagnostic pop
 
+inline void osmium::util::MemoryMapping::advise_huge_pages() noexcept {
+#ifdef MADV_HUGEPAGE
+    if (m_mapping_mode == mapping_mode::write_private_huge) {
+        // Errors are ignored on purpose. If the kernel doesn't support
+        // transparent huge pages, we get normal pages.
+        ::madvise(m_addr, m_size, MADV_HUGEPAGE);
+    }
+#endif
+}
+
 // for BSD systems
 #ifndef MAP_ANONYMOUS
 # define MAP_ANONYMOUS MAP_ANON
@@ -577,6 +643,7 @@ inline osmium::util::MemoryMapping::MemoryMapping(std::size_t size, mapping_mode
     if (!is_valid()) {
         throw std::system_error{errno, std::system_category(), "mmap failed"};
     }
+    advise_huge_pages();
 }
 
 inline osmium::util::MemoryMapping::MemoryMapping(MemoryMapping&& other) noexcept :
@@ -617,6 +684,10 @@ inline void osmium::util::MemoryMapping::resize(std::size_t new_size) {
     assert(new_size > 0 && "can not resize to zero size");
     if (m_fd == -1) { // anonymous mapping
 #ifdef __linux__
+        if (m_mapping_mode == mapping_mode::write_private_huge) {
+            resize_huge(new_size);
+            return;
+        }
         m_addr = ::mremap(m_addr, m_size, new_size, MREMAP_MAYMOVE);
         if (!is_valid()) {
             throw std::system_error{errno, std::system_category(), "mremap failed"};
@@ -668,6 +739,7 @@ inline DWORD osmium::util::MemoryMapping::get_protection() const noexcept {
         case mapping_mode::readonly:
             return PAGE_READONLY;
         case mapping_mode::write_private:
+        case mapping_mode::write_private_huge:
             return PAGE_WRITECOPY;
         default: // mapping_mode::write_shared
             break;
@@ -680,6 +752,7 @@ inline DWORD osmium::util::MemoryMapping::get_flags() const noexcept {
         case mapping_mode::readonly:
             return FILE_MAP_READ;
         case mapping_mode::write_private:
+        case mapping_mode::write_private_huge:
             return FILE_MAP_COPY;
         default: // mapping_mode::write_shared
             break;
@@ -722,6 +795,10 @@ inline void osmium::util::MemoryMapping::make_invalid() noexcept {
     m_addr = nullptr;
 }
 
+inline void osmium::util::MemoryMapping::advise_huge_pages() noexcept {
+    // Huge pages are not supported on Windows.
+}
+
 // GetLastError() returns a DWORD (A 32-bit unsigned integer), but the error
 // code for std::system_error is an int. So we convert this here and hope
 // it all works.
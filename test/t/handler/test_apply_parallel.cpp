@@ -0,0 +1,121 @@
+#include "catch.hpp"
+
+#include "utils.hpp"
+
+#include <osmium/handler.hpp>
+#include <osmium/io/xml_input.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/parallel_visitor.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+    struct CountHandler : public osmium::handler::Handler {
+
+        int nodes = 0;
+        int ways = 0;
+        int relations = 0;
+        int flushed = 0;
+
+        void node(const osmium::Node& /*node*/) noexcept {
+            ++nodes;
+        }
+
+        void way(const osmium::Way& /*way*/) noexcept {
+            ++ways;
+        }
+
+        void relation(const osmium::Relation& /*relation*/) noexcept {
+            ++relations;
+        }
+
+        void flush() noexcept {
+            ++flushed;
+        }
+
+    }; // struct CountHandler
+
+    void merge_counts(CountHandler& a, const CountHandler& b) noexcept {
+        a.nodes += b.nodes;
+        a.ways += b.ways;
+        a.relations += b.relations;
+        a.flushed += b.flushed;
+    }
+
+    struct ThrowingHandler : public osmium::handler::Handler {
+
+        void way(const osmium::Way& /*way*/) {
+            throw std::runtime_error{"way"};
+        }
+
+    }; // struct ThrowingHandler
+
+} // anonymous namespace
+
+TEST_CASE("apply_parallel with handler factory and merge") {
+    osmium::thread::Pool pool{3};
+    osmium::io::Reader reader{with_data_dir("t/relations/data.osm")};
+
+    int factory_calls = 0;
+    const auto result = osmium::apply_parallel(reader, [&]() {
+        ++factory_calls;
+        return CountHandler{};
+    }, merge_counts, pool);
+    reader.close();
+
+    REQUIRE(factory_calls == 3);
+    REQUIRE(result.nodes == 5);
+    REQUIRE(result.ways == 2);
+    REQUIRE(result.relations == 3);
+    REQUIRE(result.flushed == 3);
+}
+
+TEST_CASE("apply_parallel with default pool") {
+    osmium::io::Reader reader{with_data_dir("t/relations/data.osm")};
+
+    const auto result = osmium::apply_parallel(reader, []() {
+        return CountHandler{};
+    }, merge_counts);
+    reader.close();
+
+    REQUIRE(result.nodes == 5);
+    REQUIRE(result.ways == 2);
+    REQUIRE(result.relations == 3);
+}
+
+TEST_CASE("apply_parallel passes on exceptions from handlers") {
+    osmium::thread::Pool pool{2};
+    osmium::io::Reader reader{with_data_dir("t/relations/data.osm")};
+
+    REQUIRE_THROWS_AS(osmium::apply_parallel(reader, []() {
+        return ThrowingHandler{};
+    }, [](ThrowingHandler& /*a*/, const ThrowingHandler& /*b*/) {
+    }, pool), const std::runtime_error&);
+    reader.close();
+}
+
+TEST_CASE("handler_set blocks in acquire() until a handler is released") {
+    osmium::detail::handler_set<CountHandler> handlers{[]() {
+        return CountHandler{};
+    }, 1};
+
+    const auto n = handlers.acquire();
+    std::atomic<bool> acquired{false};
+    std::thread thread{[&]() {
+        handlers.release(handlers.acquire());
+        acquired = true;
+    }};
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    REQUIRE_FALSE(acquired);
+    handlers.release(n);
+    thread.join();
+    REQUIRE(acquired);
+}
@@ -0,0 +1,118 @@
+#include "catch.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/handler/node_locations_for_ways.hpp>
+#include <osmium/index/map/compressed_mem.hpp>
+#include <osmium/index/map/dense_mem_array.hpp>
+#include <osmium/index/map/flex_mem.hpp>
+#include <osmium/index/map/sparse_mem_array.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/visitor.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+using map_type = osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>;
+
+static osmium::memory::Buffer example_buffer() {
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+
+    for (int i = 1; i <= 200; ++i) {
+        osmium::builder::add_node(buffer, _id(i), _location(i * 0.1, i * -0.2));
+    }
+    osmium::builder::add_node(buffer, _id(-5), _location(8.0, 9.0));
+
+    for (int i = 1; i < 200; i += 3) {
+        osmium::builder::add_way(buffer, _id(i), _nodes({i, i + 1, 200 - i, i}));
+    }
+    osmium::builder::add_way(buffer, _id(1000), _nodes({3, -5, 4}));
+
+    return buffer;
+}
+
+static std::vector<osmium::Location> way_locations(const osmium::memory::Buffer& buffer) {
+    std::vector<osmium::Location> locations;
+    for (const auto& way : buffer.select<osmium::Way>()) {
+        for (const auto& node_ref : way.nodes()) {
+            locations.push_back(node_ref.location());
+        }
+    }
+    return locations;
+}
+
+template <typename TIndex>
+static void test_batch_lookup() {
+    TIndex index_pos;
+    TIndex index_neg;
+    osmium::handler::NodeLocationsForWays<map_type, map_type> handler{index_pos, index_neg};
+
+    auto buffer = example_buffer();
+    osmium::apply(buffer, handler);
+    const auto expected = way_locations(buffer);
+    REQUIRE(expected[1] == osmium::Location(0.2, -0.4));
+    REQUIRE(expected[expected.size() - 2] == osmium::Location(8.0, 9.0));
+
+    TIndex batch_index_pos;
+    TIndex batch_index_neg;
+    osmium::handler::NodeLocationsForWays<map_type, map_type> batch_handler{batch_index_pos, batch_index_neg};
+
+    auto batch_buffer = example_buffer();
+    batch_handler.process_buffer(batch_buffer);
+    REQUIRE(way_locations(batch_buffer) == expected);
+}
+
+TEST_CASE("Batch lookup in NodeLocationsForWays with DenseMemArray") {
+    test_batch_lookup<osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("Batch lookup in NodeLocationsForWays with FlexMem") {
+    test_batch_lookup<osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("Batch lookup in NodeLocationsForWays with SparseMemArray") {
+    test_batch_lookup<osmium::index::map::SparseMemArray<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("Batch lookup in NodeLocationsForWays with CompressedMem") {
+    test_batch_lookup<osmium::index::map::CompressedMem<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("Batch lookup in FlexMem in dense mode") {
+    osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location> index{true};
+    index.set(3, osmium::Location{1.0, 2.0});
+    index.set(70000, osmium::Location{3.0, 4.0});
+
+    const std::vector<osmium::unsigned_object_id_type> ids = {3, 4, 70000, 5000000};
+    std::vector<osmium::Location> locations(ids.size());
+    index.get_noexcept_batch(ids.data(), ids.size(), locations.data());
+
+    REQUIRE(locations[0] == osmium::Location(1.0, 2.0));
+    REQUIRE(locations[1] == osmium::Location{});
+    REQUIRE(locations[2] == osmium::Location(3.0, 4.0));
+    REQUIRE(locations[3] == osmium::Location{});
+}
+
+TEST_CASE("Batch lookup in NodeLocationsForWays with missing node") {
+    using index_type = osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location>;
+
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+    osmium::builder::add_node(buffer, _id(1), _location(1.0, 1.0));
+    osmium::builder::add_way(buffer, _id(1), _nodes({1, 2}));
+    osmium::builder::add_way(buffer, _id(2), _nodes({1, 1}));
+
+    index_type index;
+    osmium::handler::NodeLocationsForWays<index_type> handler{index};
+    REQUIRE_THROWS_AS(handler.process_buffer(buffer), const osmium::not_found&);
+
+    const auto locations = way_locations(buffer);
+    REQUIRE(locations[0] == osmium::Location(1.0, 1.0));
+    REQUIRE(locations[1] == osmium::Location{});
+    REQUIRE(locations[3] == osmium::Location(1.0, 1.0));
+
+    handler.ignore_errors();
+    handler.process_buffer(buffer);
+}
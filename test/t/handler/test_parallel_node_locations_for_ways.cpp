@@ -0,0 +1,235 @@
+#include "catch.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/handler/node_locations_for_ways.hpp>
+#include <osmium/handler/parallel_node_locations_for_ways.hpp>
+#include <osmium/index/map/compressed_mem.hpp>
+#include <osmium/index/map/dense_mem_array.hpp>
+#include <osmium/index/map/sparse_mem_array.hpp>
+#include <osmium/io/opl_input.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/visitor.hpp>
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+using map_type = osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>;
+
+static osmium::Location location_for(int id) {
+    return osmium::Location{id * 0.001, id * -0.002};
+}
+
+// Buffers with nodes 1 to 5000 (or in reverse order) and -1 to -10 and
+// then buffers with ways referencing those nodes.
+static std::vector<osmium::memory::Buffer> example_buffers(bool reverse) {
+    std::vector<osmium::memory::Buffer> buffers;
+
+    for (int b = 0; b < 10; ++b) {
+        buffers.emplace_back(1024, osmium::memory::Buffer::auto_grow::yes);
+        for (int i = 1; i <= 500; ++i) {
+            const int id = reverse ? 5001 - (b * 500 + i) : b * 500 + i;
+            osmium::builder::add_node(buffers.back(), _id(id), _location(location_for(id)));
+        }
+    }
+
+    buffers.emplace_back(1024, osmium::memory::Buffer::auto_grow::yes);
+    for (int i = 1; i <= 10; ++i) {
+        osmium::builder::add_node(buffers.back(), _id(-i), _location(location_for(i + 5000)));
+    }
+
+    for (int b = 0; b < 10; ++b) {
+        buffers.emplace_back(1024, osmium::memory::Buffer::auto_grow::yes);
+        for (int i = 1; i <= 100; ++i) {
+            const int id = b * 100 + i;
+            osmium::builder::add_way(buffers.back(), _id(id), _nodes({id, id + 1, 5000 - id, -(id % 10 + 1)}));
+        }
+    }
+
+    return buffers;
+}
+
+static std::vector<osmium::Location> way_locations(const std::vector<osmium::memory::Buffer>& buffers) {
+    std::vector<osmium::Location> locations;
+    for (const auto& buffer : buffers) {
+        for (const auto& way : buffer.select<osmium::Way>()) {
+            for (const auto& node_ref : way.nodes()) {
+                locations.push_back(node_ref.location());
+            }
+        }
+    }
+    return locations;
+}
+
+template <typename TIndex>
+static void test_parallel(bool reverse) {
+    osmium::thread::Pool pool{4};
+
+    auto buffers = example_buffers(reverse);
+
+    std::vector<osmium::Location> expected;
+    {
+        TIndex index_pos;
+        TIndex index_neg;
+        osmium::handler::NodeLocationsForWays<map_type, map_type> handler{index_pos, index_neg};
+        auto copy = example_buffers(reverse);
+        for (auto& buffer : copy) {
+            osmium::apply(buffer, handler);
+        }
+        expected = way_locations(copy);
+    }
+    REQUIRE(expected[0] == location_for(1));
+    REQUIRE(expected[3] == location_for(5002));
+
+    TIndex index_pos;
+    TIndex index_neg;
+    osmium::handler::ParallelNodeLocationsForWays<map_type, map_type> handler{index_pos, index_neg, pool};
+
+    std::vector<std::future<osmium::memory::Buffer>> futures;
+    for (auto& buffer : buffers) {
+        futures.push_back(handler(std::move(buffer)));
+    }
+
+    std::vector<osmium::memory::Buffer> results;
+    for (auto& future : futures) {
+        results.push_back(future.get());
+    }
+
+    REQUIRE(results.size() == 21);
+    REQUIRE(index_pos.get(4711) == location_for(4711));
+    REQUIRE(way_locations(results) == expected);
+}
+
+TEST_CASE("Parallel node locations with dense index") {
+    test_parallel<osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>>(false);
+}
+
+TEST_CASE("Parallel node locations with dense index and reversed node order") {
+    test_parallel<osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>>(true);
+}
+
+TEST_CASE("Parallel node locations with sparse index and reversed node order") {
+    test_parallel<osmium::index::map::SparseMemArray<osmium::unsigned_object_id_type, osmium::Location>>(true);
+}
+
+TEST_CASE("Parallel node locations with compressed index") {
+    test_parallel<osmium::index::map::CompressedMem<osmium::unsigned_object_id_type, osmium::Location>>(false);
+}
+
+TEST_CASE("Parallel node locations with missing node") {
+    osmium::thread::Pool pool{2};
+    osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location> index;
+    osmium::handler::dummy_type dummy;
+
+    osmium::memory::Buffer nodes{1024, osmium::memory::Buffer::auto_grow::yes};
+    osmium::builder::add_node(nodes, _id(1), _location(1.0, 2.0));
+
+    osmium::memory::Buffer ways{1024, osmium::memory::Buffer::auto_grow::yes};
+    osmium::builder::add_way(ways, _id(1), _nodes({1, 2}));
+
+    SECTION("error") {
+        osmium::handler::ParallelNodeLocationsForWays<map_type> handler{index, dummy, pool};
+        auto future_nodes = handler(std::move(nodes));
+        auto future_ways = handler(std::move(ways));
+        future_nodes.get();
+        REQUIRE_THROWS_AS(future_ways.get(), const osmium::not_found&);
+    }
+
+    SECTION("ignore errors") {
+        osmium::handler::ParallelNodeLocationsForWays<map_type> handler{index, dummy, pool};
+        handler.ignore_errors();
+        auto future_nodes = handler(std::move(nodes));
+        auto future_ways = handler(std::move(ways));
+        future_nodes.get();
+        const auto buffer = future_ways.get();
+        const auto& way = buffer.get<osmium::Way>(0);
+        REQUIRE(way.nodes()[0].location() == osmium::Location(1.0, 2.0));
+        REQUIRE_FALSE(way.nodes()[1].location());
+    }
+}
+
+TEST_CASE("Parallel node locations don't wait for earlier node buffers if index is large enough") {
+    osmium::thread::Pool pool{1};
+    osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location> index;
+    osmium::handler::dummy_type dummy;
+    osmium::handler::ParallelNodeLocationsForWays<map_type> handler{index, dummy, pool};
+
+    // Grows the index to more than 110 entries. The dummy index for the
+    // negative IDs doesn't grow.
+    osmium::memory::Buffer nodes1{1024, osmium::memory::Buffer::auto_grow::yes};
+    for (int id = 1; id <= 100; ++id) {
+        osmium::builder::add_node(nodes1, _id(id), _location(location_for(id)));
+    }
+    osmium::builder::add_node(nodes1, _id(-1), _location(location_for(1)));
+    handler(std::move(nodes1)).get();
+
+    osmium::memory::Buffer nodes2{1024, osmium::memory::Buffer::auto_grow::yes};
+    for (int id = 101; id <= 105; ++id) {
+        osmium::builder::add_node(nodes2, _id(id), _location(location_for(id)));
+    }
+    osmium::builder::add_node(nodes2, _id(-2), _location(location_for(2)));
+
+    osmium::memory::Buffer nodes3{1024, osmium::memory::Buffer::auto_grow::yes};
+    for (int id = 106; id <= 110; ++id) {
+        osmium::builder::add_node(nodes3, _id(id), _location(location_for(id)));
+    }
+
+    // Block the only pool thread, so the tasks storing the nodes can't
+    // finish. Handing over the buffers must not wait for them.
+    std::promise<void> unblock;
+    const std::shared_future<void> unblocked{unblock.get_future()};
+    auto blocker = pool.submit([unblocked] { unblocked.wait(); });
+
+    auto submitted = std::async(std::launch::async, [&] {
+        auto future2 = handler(std::move(nodes2));
+        auto future3 = handler(std::move(nodes3));
+        return std::make_pair(std::move(future2), std::move(future3));
+    });
+    const bool did_not_wait = submitted.wait_for(std::chrono::seconds{5}) == std::future_status::ready;
+    unblock.set_value();
+
+    auto futures = submitted.get();
+    futures.first.get();
+    futures.second.get();
+    blocker.get();
+
+    REQUIRE(did_not_wait);
+    REQUIRE(index.get(103) == location_for(103));
+    REQUIRE(index.get(108) == location_for(108));
+}
+
+TEST_CASE("Parallel node locations reading from file") {
+    const std::string data{"n1 x1 y2\nn2 x3 y4\nn3 x5 y6\nw10 Nn1,n2\nw11 Nn3,n1\nr20 Mw10@\n"};
+
+    osmium::thread::Pool pool{2};
+    osmium::io::Reader reader{osmium::io::File{data.data(), data.size(), "opl"}, pool};
+
+    osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location> index;
+    osmium::handler::dummy_type dummy;
+    osmium::handler::ParallelNodeLocationsForWays<map_type> handler{index, dummy, pool};
+
+    std::vector<osmium::Location> locations;
+    int objects = 0;
+    handler.process(reader, [&](const osmium::memory::Buffer& buffer) {
+        for (const auto& item : buffer) {
+            (void)item;
+            ++objects;
+        }
+        for (const auto& way : buffer.select<osmium::Way>()) {
+            for (const auto& node_ref : way.nodes()) {
+                locations.push_back(node_ref.location());
+            }
+        }
+    });
+    reader.close();
+
+    REQUIRE(objects == 6);
+    REQUIRE(locations == std::vector<osmium::Location>({{1.0, 2.0}, {3.0, 4.0}, {5.0, 6.0}, {1.0, 2.0}}));
+}
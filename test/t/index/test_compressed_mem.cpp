@@ -0,0 +1,92 @@
+#include "catch.hpp"
+
+#include <osmium/index/map/compressed_mem.hpp>
+#include <osmium/index/node_locations_map.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/types.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using index_type = osmium::index::map::CompressedMem<osmium::unsigned_object_id_type, osmium::Location>;
+
+static osmium::Location location_for(uint64_t id) {
+    return osmium::Location{static_cast<int32_t>(id * 37 % 1000000) - 500000,
+                            static_cast<int32_t>(id * 11 % 700000)};
+}
+
+TEST_CASE("CompressedMem with locations set in order") {
+    index_type index;
+
+    std::vector<bool> is_set(100000);
+    std::size_t count = 0;
+    for (uint64_t id = 1; id < is_set.size(); id += (id % 7) + 1) {
+        index.set(id, location_for(id));
+        is_set[id] = true;
+        ++count;
+    }
+    index.sort();
+
+    REQUIRE(index.size() == count);
+    for (uint64_t id = 0; id < is_set.size(); ++id) {
+        if (is_set[id]) {
+            REQUIRE(index.get(id) == location_for(id));
+        } else {
+            REQUIRE(index.get_noexcept(id) == osmium::Location{});
+        }
+    }
+    REQUIRE(index.get_noexcept(100000000) == osmium::Location{});
+}
+
+TEST_CASE("CompressedMem with locations set out of order") {
+    index_type index;
+
+    for (uint64_t id = 1000; id > 0; --id) {
+        index.set(id * 3, location_for(id * 3));
+    }
+    for (uint64_t id = 1; id <= 1000; ++id) {
+        index.set(id * 3 + 1, location_for(id * 3 + 1));
+    }
+
+    // overwrite some locations
+    index.set(30, osmium::Location{1.5, 2.5});
+    index.set(3000, osmium::Location{});
+
+    REQUIRE(index.size() == 2000);
+
+    for (uint64_t id = 1; id <= 1000; ++id) {
+        if (id != 10 && id != 1000) {
+            REQUIRE(index.get(id * 3) == location_for(id * 3));
+        }
+        REQUIRE(index.get(id * 3 + 1) == location_for(id * 3 + 1));
+        REQUIRE(index.get_noexcept(id * 3 + 2) == osmium::Location{});
+    }
+    REQUIRE(index.get(30) == osmium::Location(1.5, 2.5));
+    REQUIRE(index.get_noexcept(3000) == osmium::Location{});
+}
+
+TEST_CASE("CompressedMem uses less memory than a location per ID") {
+    index_type index;
+
+    for (uint64_t id = 1; id <= 1000000; ++id) {
+        index.set(id, osmium::Location{static_cast<int32_t>(100000000 + id * 50), static_cast<int32_t>(500000000 - id * 20)});
+    }
+    index.sort();
+
+    REQUIRE(index.get(123456) == osmium::Location(static_cast<int32_t>(100000000 + 123456 * 50), static_cast<int32_t>(500000000 - 123456 * 20)));
+    REQUIRE(index.used_memory() < 1000000 * sizeof(osmium::Location) / 2);
+
+    index.clear();
+    REQUIRE(index.size() == 0);
+    REQUIRE(index.get_noexcept(123456) == osmium::Location{});
+}
+
+TEST_CASE("CompressedMem can be created by the map factory") {
+    const auto& map_factory = osmium::index::MapFactory<osmium::unsigned_object_id_type, osmium::Location>::instance();
+    REQUIRE(map_factory.has_map_type("compressed_mem"));
+
+    std::unique_ptr<osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>> index = map_factory.create_map("compressed_mem");
+    index->set(17, osmium::Location{1.0, 2.0});
+    REQUIRE(index->get(17) == osmium::Location(1.0, 2.0));
+}
@@ -1,6 +1,7 @@
 #include "catch.hpp"
 
 #include <osmium/index/detail/tmpfile.hpp>
+#include <osmium/index/map/compressed_mem.hpp>
 #include <osmium/index/map/dense_file_array.hpp>
 #include <osmium/index/map/dense_mem_array.hpp>
 #include <osmium/index/map/dense_mmap_array.hpp>
@@ -82,3 +83,10 @@ TEST_CASE("Dump SparseMemArray, load as SparseFileArray") {
     auto dump_method = [](sparse_mem_array& index, const int fd) { index.dump_as_list(fd);};
     test_index<sparse_mem_array, sparse_file_array>(dump_method);
 }
+
+using compressed_mem = osmium::index::map::CompressedMem<osmium::unsigned_object_id_type, osmium::Location>;
+
+TEST_CASE("Dump CompressedMem, load as SparseFileArray") {
+    auto dump_method = [](compressed_mem& index, const int fd) { index.dump_as_list(fd);};
+    test_index<compressed_mem, sparse_file_array>(dump_method);
+}
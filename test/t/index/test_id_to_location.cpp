@@ -1,5 +1,6 @@
 #include "catch.hpp"
 
+#include <osmium/index/map/compressed_mem.hpp>
 #include <osmium/index/map/dense_file_array.hpp>
 #include <osmium/index/map/dense_mem_array.hpp>
 #include <osmium/index/map/dense_mmap_array.hpp>
@@ -129,6 +130,16 @@ TEST_CASE("Map Id to location: DenseMmapArray") {
     index_type index2;
     test_func_real<index_type>(index2);
 }
+
+TEST_CASE("Map Id to location: DenseMmapArrayHuge") {
+    using index_type = osmium::index::map::DenseMmapArrayHuge<osmium::unsigned_object_id_type, osmium::Location>;
+
+    index_type index1;
+    test_func_all<index_type>(index1);
+
+    index_type index2;
+    test_func_real<index_type>(index2);
+}
 #else
 # pragma message("not running 'DenseMmapArray' test case on this machine")
 #endif
@@ -249,6 +260,16 @@ TEST_CASE("Map Id to location: FlexMem switch") {
     REQUIRE(index.get_noexcept(2000000000) == osmium::Location{});
 }
 
+TEST_CASE("Map Id to location: CompressedMem") {
+    using index_type = osmium::index::map::CompressedMem<osmium::unsigned_object_id_type, osmium::Location>;
+
+    index_type index1;
+    test_func_all<index_type>(index1);
+
+    index_type index2;
+    test_func_real<index_type>(index2);
+}
+
 TEST_CASE("Map Id to location: Dynamic map choice") {
     using map_type = osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>;
     const auto& map_factory = osmium::index::MapFactory<osmium::unsigned_object_id_type, osmium::Location>::instance();
@@ -0,0 +1,180 @@
+#include "catch.hpp"
+
+#include <osmium/index/detail/radix_sort.hpp>
+#include <osmium/index/map/sparse_mem_array.hpp>
+#include <osmium/index/map/sparse_mmap_array.hpp>
+#include <osmium/index/multimap/sparse_mem_array.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+using element_type = std::pair<uint64_t, uint64_t>;
+
+static std::vector<element_type> random_elements(std::size_t size, uint64_t max_key) {
+    std::mt19937_64 generator{17};
+    std::uniform_int_distribution<uint64_t> keys{0, max_key};
+    std::uniform_int_distribution<uint64_t> values{0, 3};
+
+    std::vector<element_type> elements;
+    elements.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        elements.emplace_back(keys(generator), values(generator));
+    }
+    return elements;
+}
+
+static void check_sort(std::vector<element_type> elements, osmium::thread::Pool& pool) {
+    auto expected = elements;
+    std::sort(expected.begin(), expected.end());
+
+    osmium::index::detail::radix_sort(elements.data(), elements.size(), [](const element_type& element) {
+        return element.first;
+    }, pool);
+
+    REQUIRE(elements == expected);
+}
+
+TEST_CASE("Radix sort") {
+    osmium::thread::Pool pool{3};
+
+    SECTION("empty") {
+        check_sort({}, pool);
+    }
+
+    SECTION("fewer elements than threads") {
+        check_sort({{5, 1}, {3, 2}}, pool);
+    }
+
+    SECTION("small keys with many duplicates") {
+        check_sort(random_elements(10000, 100), pool);
+    }
+
+    SECTION("all keys the same") {
+        check_sort(random_elements(1000, 0), pool);
+    }
+
+    SECTION("large keys") {
+        check_sort(random_elements(100000, std::numeric_limits<uint64_t>::max()), pool);
+    }
+
+    SECTION("keys in node id range") {
+        check_sort(random_elements(100001, 10000000000ULL), pool);
+    }
+}
+
+TEST_CASE("Radix sort with 32 bit keys") {
+    osmium::thread::Pool pool{2};
+
+    std::vector<std::pair<uint32_t, int>> elements;
+    for (int i = 0; i < 5000; ++i) {
+        elements.emplace_back(static_cast<uint32_t>((i * 7919) % 5003) << 12U, -i);
+    }
+    auto expected = elements;
+    std::sort(expected.begin(), expected.end());
+
+    osmium::index::detail::radix_sort(elements.data(), elements.size(), [](const std::pair<uint32_t, int>& element) {
+        return element.first;
+    }, pool);
+
+    REQUIRE(elements == expected);
+}
+
+TEST_CASE("Radix sort with signed keys") {
+    osmium::thread::Pool pool{2};
+
+    std::vector<std::pair<int64_t, int>> elements;
+    for (int i = 0; i < 5000; ++i) {
+        const int64_t key = (static_cast<int64_t>(i) * 7919) % 5003 - 2500;
+        elements.emplace_back(key * 1000000007LL, i % 3);
+    }
+    elements.emplace_back(std::numeric_limits<int64_t>::min(), 0);
+    elements.emplace_back(std::numeric_limits<int64_t>::max(), 0);
+    auto expected = elements;
+    std::sort(expected.begin(), expected.end());
+
+    osmium::index::detail::radix_sort(elements.data(), elements.size(), [](const std::pair<int64_t, int>& element) {
+        return element.first;
+    }, pool);
+
+    REQUIRE(elements == expected);
+}
+
+TEST_CASE("Radix sort from tasks running on the same pool") {
+    osmium::thread::Pool pool{2};
+
+    // Both workers run a sort at the same time. If they waited for
+    // tasks on the pool, nobody would be left to run those tasks.
+    std::vector<std::future<bool>> futures;
+    for (int n = 0; n < 2; ++n) {
+        futures.push_back(pool.submit([&pool]() {
+            auto elements = random_elements(100000, 10000000000ULL);
+            auto expected = elements;
+            std::sort(expected.begin(), expected.end());
+            osmium::index::detail::radix_sort(elements.data(), elements.size(), [](const element_type& element) {
+                return element.first;
+            }, pool);
+            return pool.is_worker_thread() && elements == expected;
+        }));
+    }
+
+    for (auto& future : futures) {
+        REQUIRE(future.get());
+    }
+    REQUIRE_FALSE(pool.is_worker_thread());
+}
+
+TEST_CASE("Sorting large mmap based sparse map uses std::sort") {
+    using index_type = osmium::index::map::SparseMmapArray<osmium::unsigned_object_id_type, osmium::Location>;
+
+    const std::size_t size = osmium::index::detail::radix_sort_min_size + 1000;
+    index_type index;
+    for (std::size_t i = 0; i < size; ++i) {
+        const auto id = (i * 7919) % size;
+        index.set(id, osmium::Location{static_cast<int32_t>(id), 1});
+    }
+    index.sort();
+
+    REQUIRE(std::is_sorted(index.cbegin(), index.cend()));
+    REQUIRE(index.get(4711) == osmium::Location(4711, 1));
+}
+
+TEST_CASE("Sorting large sparse map uses radix sort") {
+    using index_type = osmium::index::map::SparseMemArray<osmium::unsigned_object_id_type, osmium::Location>;
+
+    const std::size_t size = osmium::index::detail::radix_sort_min_size + 1000;
+    index_type index;
+    for (std::size_t i = 0; i < size; ++i) {
+        const auto id = (i * 7919) % size;
+        index.set(id, osmium::Location{static_cast<int32_t>(id), 1});
+    }
+    index.sort();
+
+    REQUIRE(std::is_sorted(index.cbegin(), index.cend()));
+    REQUIRE(index.get(0) == osmium::Location(0, 1));
+    REQUIRE(index.get(4711) == osmium::Location(4711, 1));
+    REQUIRE(index.get(size - 1) == osmium::Location(static_cast<int32_t>(size - 1), 1));
+}
+
+TEST_CASE("Sorting large sparse multimap uses radix sort") {
+    using index_type = osmium::index::multimap::SparseMemArray<osmium::unsigned_object_id_type, osmium::unsigned_object_id_type>;
+
+    const std::size_t size = osmium::index::detail::radix_sort_min_size + 1000;
+    index_type index;
+    for (std::size_t i = 0; i < size; ++i) {
+        index.set((i * 7919) % 1000, size - i);
+    }
+    index.sort();
+
+    REQUIRE(std::is_sorted(index.cbegin(), index.cend()));
+    const auto range = index.get_all(17);
+    REQUIRE(std::distance(range.first, range.second) > 1000);
+}
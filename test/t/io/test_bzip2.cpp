@@ -4,6 +4,7 @@
 
 #include <osmium/io/bzip2_compression.hpp>
 #include <osmium/io/detail/read_write.hpp>
+#include <osmium/thread/pool.hpp>
 
 #include <string>
 
@@ -134,3 +135,123 @@ TEST_CASE("Write bzip2-compressed file with implicit close") {
     REQUIRE(osmium::file_size(output_file) > 10);
 }
 
+
+namespace {
+
+    std::string bzip2_compress_stream(const std::string& input) {
+        std::string output;
+        output.resize(input.size() + input.size() / 100 + 600);
+        auto size = static_cast<unsigned int>(output.size());
+        const int result = BZ2_bzBuffToBuffCompress(&*output.begin(), &size, const_cast<char*>(input.data()), static_cast<unsigned int>(input.size()), 9, 0, 0);
+        REQUIRE(result == BZ_OK);
+        output.resize(size);
+        return output;
+    }
+
+    // Random data doesn't compress well, so we get large compressed
+    // streams without needing a lot of input.
+    std::string random_text(std::size_t size, unsigned int seed) {
+        std::string data;
+        data.reserve(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            seed = seed * 1103515245U + 12345U;
+            data += static_cast<char>('a' + (seed >> 16U) % 26);
+        }
+        return data;
+    }
+
+    std::string read_all(osmium::io::Decompressor& decomp) {
+        std::string all;
+        for (std::string data = decomp.read(); !data.empty(); data = decomp.read()) {
+            all += data;
+        }
+        return all;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Read bzip2-compressed file with parallel decompressor") {
+    const int count = count_fds();
+
+    const std::string input_file = with_data_dir("t/io/data_bzip2.txt.bz2");
+    const int fd = osmium::io::detail::open_for_reading(input_file);
+    REQUIRE(fd > 0);
+
+    std::string all;
+    {
+        osmium::thread::Pool pool{2};
+        osmium::io::Bzip2ParallelDecompressor decomp{fd, pool};
+        all = read_all(decomp);
+        decomp.close();
+    }
+
+    REQUIRE(all.size() >= 9);
+    all.resize(8);
+    REQUIRE("TESTDATA" == all);
+
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Read multistream bzip2-compressed file with parallel decompressor") {
+    const std::string output_file = "test_bzip2_multistream.txt.bz2";
+
+    std::string expected;
+    {
+        std::string compressed;
+        for (unsigned int n = 0; n < 40; ++n) {
+            const auto data = random_text(100 * 1000, n);
+            expected += data;
+            compressed += bzip2_compress_stream(data);
+        }
+        const int fd = osmium::io::detail::open_for_writing(output_file, osmium::io::overwrite::allow);
+        osmium::io::detail::reliable_write(fd, compressed.data(), compressed.size());
+        osmium::io::detail::reliable_close(fd);
+    }
+
+    const int fd = osmium::io::detail::open_for_reading(output_file);
+    REQUIRE(fd > 0);
+
+    osmium::thread::Pool pool{3};
+    osmium::io::Bzip2ParallelDecompressor decomp{fd, pool};
+    const auto all = read_all(decomp);
+    decomp.close();
+
+    REQUIRE(all.size() == expected.size());
+    REQUIRE(all == expected);
+}
+
+TEST_CASE("Empty bzip2-compressed file with parallel decompressor") {
+    const int count = count_fds();
+
+    const std::string input_file = with_data_dir("t/io/empty_file");
+    const int fd = osmium::io::detail::open_for_reading(input_file);
+    REQUIRE(fd > 0);
+
+    osmium::io::Bzip2ParallelDecompressor decomp{fd};
+    REQUIRE_THROWS_AS(decomp.read(), const osmium::bzip2_error&);
+    decomp.close();
+
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Corrupted bzip2-compressed file with parallel decompressor") {
+    const int count = count_fds();
+
+    const std::string input_file = with_data_dir("t/io/corrupt_data_bzip2.txt.bz2");
+    const int fd = osmium::io::detail::open_for_reading(input_file);
+    REQUIRE(fd > 0);
+
+    osmium::io::Bzip2ParallelDecompressor decomp{fd};
+    REQUIRE_THROWS_AS(read_all(decomp), const osmium::bzip2_error&);
+    decomp.close();
+
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Find start of bzip2 streams") {
+    const std::string stream = bzip2_compress_stream("foo");
+    REQUIRE(osmium::io::detail::find_last_bzip2_stream_start(stream) == 0);
+    REQUIRE(osmium::io::detail::find_last_bzip2_stream_start(stream + stream) == stream.size());
+    REQUIRE(osmium::io::detail::find_last_bzip2_stream_start(stream + stream + stream) == 2 * stream.size());
+    REQUIRE(osmium::io::detail::find_last_bzip2_stream_start(stream + "BZh9xxxxxx") == 0);
+}
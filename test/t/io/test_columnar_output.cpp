@@ -0,0 +1,159 @@
+#include "catch.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/io/columnar_output.hpp>
+#include <osmium/memory/buffer.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+using column = osmium::io::columnar_column;
+
+namespace {
+
+    // Access to one block of a columnar file as described in the docs.
+    class block_view {
+
+        const char* m_data;
+
+        uint64_t get_uint64(std::size_t n) const {
+            uint64_t value = 0;
+            std::memcpy(&value, m_data + n * sizeof(uint64_t), sizeof(uint64_t));
+            return value;
+        }
+
+    public:
+
+        explicit block_view(const char* data) :
+            m_data(data) {
+        }
+
+        uint64_t size() const {
+            return get_uint64(0);
+        }
+
+        uint64_t count(osmium::item_type type) const {
+            return get_uint64(static_cast<std::size_t>(type));
+        }
+
+        uint64_t column_offset(column c) const {
+            return get_uint64(4 + 2 * static_cast<std::size_t>(c));
+        }
+
+        uint64_t column_size(column c) const {
+            return get_uint64(5 + 2 * static_cast<std::size_t>(c));
+        }
+
+        template <typename T>
+        std::vector<T> get(column c) const {
+            std::vector<T> values(column_size(c) / sizeof(T));
+            std::memcpy(values.data(), m_data + column_offset(c), column_size(c));
+            return values;
+        }
+
+        std::string get_string(column offsets, column data, std::size_t n) const {
+            const auto o = get<uint32_t>(offsets);
+            return std::string{m_data + column_offset(data) + o[n], o[n + 1] - o[n]};
+        }
+
+    }; // class block_view
+
+} // anonymous namespace
+
+static osmium::memory::Buffer example_buffer() {
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+
+    osmium::builder::add_node(buffer, _id(1), _version(2), _cid(10), _uid(7), _timestamp("2019-01-01T00:00:00Z"),
+                              _location(1.5, -2.5), _tag("amenity", "post_box"), _tag("ref", "A"));
+    osmium::builder::add_node(buffer, _id(2), _version(1), _cid(11), _uid(8), _location(3.0, 4.0));
+    osmium::builder::add_node(buffer, _id(3), _deleted());
+    osmium::builder::add_way(buffer, _id(20), _version(3), _nodes({1, 2, 1}), _tag("highway", "primary"));
+    osmium::builder::add_relation(buffer, _id(30), _version(4),
+                                  _member(osmium::item_type::way, 20, "outer"),
+                                  _member(osmium::item_type::node, 1, ""),
+                                  _tag("type", "multipolygon"));
+
+    return buffer;
+}
+
+static std::string write_columnar(const std::string& filename, int num_buffers) {
+    {
+        osmium::io::Writer writer{filename, osmium::io::overwrite::allow};
+        for (int i = 0; i < num_buffers; ++i) {
+            writer(example_buffer());
+        }
+        writer.close();
+    }
+
+    std::ifstream file{filename, std::ios::binary};
+    return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+TEST_CASE("Columnar file header") {
+    const std::string data = write_columnar("test-columnar-output-empty.columnar", 0);
+    REQUIRE(data.size() == 16);
+    REQUIRE(data.substr(0, 8) == "OSMCOLUM");
+
+    uint32_t values[2];
+    std::memcpy(values, data.data() + 8, sizeof(values));
+    REQUIRE(values[0] == 0x01020304U);
+    REQUIRE(values[1] == 1);
+}
+
+TEST_CASE("Columnar file with objects") {
+    const std::string data = write_columnar("test-columnar-output.columnar", 2);
+
+    std::size_t offset = 16;
+    int blocks = 0;
+    while (offset < data.size()) {
+        const block_view block{data.data() + offset};
+        REQUIRE(block.size() % 8 == 0);
+        REQUIRE(offset + block.size() <= data.size());
+
+        for (std::size_t c = 0; c < static_cast<std::size_t>(column::number_of_columns); ++c) {
+            REQUIRE(block.column_offset(static_cast<column>(c)) % 8 == 0);
+            REQUIRE(block.column_offset(static_cast<column>(c)) + block.column_size(static_cast<column>(c)) <= block.size());
+        }
+
+        REQUIRE(block.count(osmium::item_type::node) == 2);
+        REQUIRE(block.count(osmium::item_type::way) == 1);
+        REQUIRE(block.count(osmium::item_type::relation) == 1);
+
+        REQUIRE(block.get<int64_t>(column::node_id) == std::vector<int64_t>({1, 2}));
+        REQUIRE(block.get<uint32_t>(column::node_version) == std::vector<uint32_t>({2, 1}));
+        REQUIRE(block.get<uint32_t>(column::node_changeset) == std::vector<uint32_t>({10, 11}));
+        REQUIRE(block.get<uint32_t>(column::node_uid) == std::vector<uint32_t>({7, 8}));
+        REQUIRE(block.get<uint32_t>(column::node_timestamp)[0] == 1546300800U);
+        REQUIRE(block.get<int32_t>(column::node_lon) == std::vector<int32_t>({15000000, 30000000}));
+        REQUIRE(block.get<int32_t>(column::node_lat) == std::vector<int32_t>({-25000000, 40000000}));
+        REQUIRE(block.get<uint32_t>(column::node_tag_index) == std::vector<uint32_t>({0, 2, 2}));
+        REQUIRE(block.get_string(column::node_key_offsets, column::node_key_data, 0) == "amenity");
+        REQUIRE(block.get_string(column::node_value_offsets, column::node_value_data, 1) == "A");
+
+        REQUIRE(block.get<int64_t>(column::way_id) == std::vector<int64_t>({20}));
+        REQUIRE(block.get<uint32_t>(column::way_version) == std::vector<uint32_t>({3}));
+        REQUIRE(block.get<uint32_t>(column::way_node_index) == std::vector<uint32_t>({0, 3}));
+        REQUIRE(block.get<int64_t>(column::way_node_refs) == std::vector<int64_t>({1, 2, 1}));
+        REQUIRE(block.get_string(column::way_key_offsets, column::way_key_data, 0) == "highway");
+
+        REQUIRE(block.get<int64_t>(column::relation_id) == std::vector<int64_t>({30}));
+        REQUIRE(block.get<uint32_t>(column::relation_member_index) == std::vector<uint32_t>({0, 2}));
+        REQUIRE(block.get<uint8_t>(column::relation_member_types) == std::vector<uint8_t>({2, 1}));
+        REQUIRE(block.get<int64_t>(column::relation_member_refs) == std::vector<int64_t>({20, 1}));
+        REQUIRE(block.get_string(column::relation_role_offsets, column::relation_role_data, 0) == "outer");
+        REQUIRE(block.get_string(column::relation_role_offsets, column::relation_role_data, 1).empty());
+        REQUIRE(block.get_string(column::relation_value_offsets, column::relation_value_data, 0) == "multipolygon");
+
+        offset += block.size();
+        ++blocks;
+    }
+
+    REQUIRE(offset == data.size());
+    REQUIRE(blocks == 2);
+}
@@ -302,6 +302,28 @@ TEST_CASE("URL without format and filename") {
     f.check();
 }
 
+TEST_CASE("File format by suffix 'geojsonseq'") {
+    const osmium::io::File f{"test.geojsonseq"};
+    REQUIRE(osmium::io::file_format::geojsonseq == f.format());
+    REQUIRE(osmium::io::file_compression::none == f.compression());
+    REQUIRE_FALSE(f.has_multiple_object_versions());
+    f.check();
+}
+
+TEST_CASE("File format by suffix 'geojsonseq.gz'") {
+    const osmium::io::File f{"test.geojsonseq.gz"};
+    REQUIRE(osmium::io::file_format::geojsonseq == f.format());
+    REQUIRE(osmium::io::file_compression::gzip == f.compression());
+    f.check();
+}
+
+TEST_CASE("File format by suffix 'columnar'") {
+    const osmium::io::File f{"test.columnar"};
+    REQUIRE(osmium::io::file_format::columnar == f.format());
+    REQUIRE(osmium::io::file_compression::none == f.compression());
+    f.check();
+}
+
 TEST_CASE("URL with format") {
     const osmium::io::File f{"http://www.example.com/api", "osh"};
     REQUIRE(osmium::io::file_format::xml == f.format());
@@ -0,0 +1,85 @@
+#include "catch.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/io/geojsonseq_output.hpp>
+#include <osmium/memory/buffer.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+
+using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+static osmium::memory::Buffer example_buffer() {
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+
+    osmium::builder::add_node(buffer, _id(1), _location(1.5, 2.5), _tag("amenity", "post_box"), _tag("note", "say \"hi\"\n"));
+    osmium::builder::add_node(buffer, _id(2), _location(3.0, 4.0));
+    osmium::builder::add_node(buffer, _id(3), _tag("amenity", "bench"));
+    osmium::builder::add_node(buffer, _id(4), _location(1.0, 1.0), _tag("amenity", "bench"), _deleted());
+    osmium::builder::add_way(buffer, _id(10), _nodes({{1, {1.5, 2.5}}, {2, {3.0, 4.0}}}), _tag("highway", "primary"));
+    osmium::builder::add_way(buffer, _id(11), _nodes({{1, {1.5, 2.5}}, {1, {1.5, 2.5}}}), _tag("highway", "primary"));
+    osmium::builder::add_way(buffer, _id(12), _nodes({1, 2}), _tag("highway", "primary"));
+    osmium::builder::add_way(buffer, _id(13), _nodes({{1, {0.0, 0.0}}, {2, {1.0, 0.0}}, {3, {1.0, 1.0}}, {1, {0.0, 0.0}}}), _tag("building", "yes"));
+    osmium::builder::add_way(buffer, _id(14), _nodes({{1, {0.0, 0.0}}, {2, {1.0, 0.0}}, {3, {1.0, 1.0}}, {1, {0.0, 0.0}}}), _tag("barrier", "fence"), _tag("area", "no"));
+    osmium::builder::add_way(buffer, _id(15), _nodes({{1, {1.5, 2.5}}, {2, {3.0, 4.0}}}));
+    osmium::builder::add_relation(buffer, _id(20), _member(osmium::item_type::way, 10, ""), _tag("type", "route"));
+    osmium::builder::add_area(buffer, _id(26), _tag("building", "yes"),
+        _outer_ring({
+            {1, {0.0, 0.0}},
+            {2, {1.0, 0.0}},
+            {3, {1.0, 1.0}},
+            {1, {0.0, 0.0}}
+        })
+    );
+    osmium::builder::add_area(buffer, _id(41), _tag("landuse", "forest"),
+        _outer_ring({
+            {1, {0.5, 0.5}},
+            {2, {1.5, 0.5}},
+            {3, {1.5, 1.5}},
+            {1, {0.5, 0.5}}
+        })
+    );
+
+    return buffer;
+}
+
+static const char* expected_output =
+    "\x1e{\"type\":\"Feature\",\"id\":\"n1\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[1.5,2.5]},\"properties\":{\"amenity\":\"post_box\",\"note\":\"say \\\"hi\\\"\\n\"}}\n"
+    "\x1e{\"type\":\"Feature\",\"id\":\"w10\",\"geometry\":{\"type\":\"LineString\",\"coordinates\":[[1.5,2.5],[3,4]]},\"properties\":{\"highway\":\"primary\"}}\n"
+    "\x1e{\"type\":\"Feature\",\"id\":\"w13\",\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[[0,0],[1,0],[1,1],[0,0]]]},\"properties\":{\"building\":\"yes\"}}\n"
+    "\x1e{\"type\":\"Feature\",\"id\":\"w14\",\"geometry\":{\"type\":\"LineString\",\"coordinates\":[[0,0],[1,0],[1,1],[0,0]]},\"properties\":{\"barrier\":\"fence\",\"area\":\"no\"}}\n"
+    "\x1e{\"type\":\"Feature\",\"id\":\"r20\",\"geometry\":{\"type\":\"MultiPolygon\",\"coordinates\":[[[[0.5,0.5],[1.5,0.5],[1.5,1.5],[0.5,0.5]]]]},\"properties\":{\"landuse\":\"forest\"}}\n";
+
+TEST_CASE("Write GeoJSON text sequence block") {
+    osmium::io::detail::geojsonseq_output_options options;
+    osmium::io::detail::GeoJSONSeqOutputBlock block{example_buffer(), options};
+
+    REQUIRE(block() == expected_output);
+}
+
+TEST_CASE("Write GeoJSON text sequence block without record separators") {
+    osmium::io::detail::geojsonseq_output_options options;
+    options.print_record_separator = false;
+    osmium::io::detail::GeoJSONSeqOutputBlock block{example_buffer(), options};
+
+    std::string expected{expected_output};
+    expected.erase(std::remove(expected.begin(), expected.end(), '\x1e'), expected.end());
+    REQUIRE(block() == expected);
+}
+
+TEST_CASE("Write GeoJSON text sequence file") {
+    const std::string filename{"test-geojsonseq-output.geojsonseq"};
+    {
+        osmium::io::Writer writer{filename, osmium::io::overwrite::allow};
+        writer(example_buffer());
+        writer(example_buffer());
+        writer.close();
+    }
+
+    std::ifstream file{filename, std::ios::binary};
+    const std::string result{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    REQUIRE(result == std::string{expected_output} + expected_output);
+}
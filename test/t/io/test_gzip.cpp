@@ -4,6 +4,8 @@
 
 #include <osmium/io/detail/read_write.hpp>
 #include <osmium/io/gzip_compression.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/util/file.hpp>
 
 #include <string>
 
@@ -135,3 +137,133 @@ TEST_CASE("Write gzip-compressed file with implicit close") {
     REQUIRE(osmium::file_size(output_file) > 10);
 }
 
+
+namespace {
+
+    std::string read_all(osmium::io::Decompressor& decomp) {
+        std::string all;
+        for (std::string data = decomp.read(); !data.empty(); data = decomp.read()) {
+            all += data;
+        }
+        return all;
+    }
+
+    std::string test_text(std::size_t size) {
+        std::string data;
+        data.reserve(size);
+        unsigned int seed = 1;
+        while (data.size() < size) {
+            seed = seed * 1103515245U + 12345U;
+            data += std::to_string(seed >> 16U);
+            data += (seed & 0x100U) ? '\n' : ' ';
+        }
+        return data;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Parallel compressor: Invalid file descriptor for gzip-compressed file") {
+    REQUIRE_THROWS_AS(osmium::io::GzipParallelCompressor(-1, osmium::io::fsync::no), const std::system_error&);
+}
+
+TEST_CASE("Write gzip-compressed file with parallel compressor and read it back") {
+    const int count = count_fds();
+
+    const std::string output_file = "test_gzip_parallel_out.txt.gz";
+    const std::string text = test_text(5 * 1024 * 1024);
+
+    osmium::thread::Pool pool{3};
+    {
+        const int fd = osmium::io::detail::open_for_writing(output_file, osmium::io::overwrite::allow);
+        REQUIRE(fd > 0);
+        osmium::io::GzipParallelCompressor comp{fd, osmium::io::fsync::no, pool};
+        for (std::size_t pos = 0; pos < text.size(); pos += 100000) {
+            comp.write(text.substr(pos, 100000));
+        }
+        comp.close();
+    }
+    REQUIRE(count == count_fds());
+
+    SECTION("with standard decompressor") {
+        const int fd = osmium::io::detail::open_for_reading(output_file);
+        osmium::io::GzipDecompressor decomp{fd};
+        REQUIRE(read_all(decomp) == text);
+    }
+
+    SECTION("with parallel decompressor") {
+        const int fd = osmium::io::detail::open_for_reading(output_file);
+        osmium::io::GzipParallelDecompressor decomp{fd, pool};
+        REQUIRE(read_all(decomp) == text);
+    }
+
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Write empty gzip-compressed file with parallel compressor") {
+    const std::string output_file = "test_gzip_parallel_empty.txt.gz";
+    {
+        const int fd = osmium::io::detail::open_for_writing(output_file, osmium::io::overwrite::allow);
+        osmium::io::GzipParallelCompressor comp{fd, osmium::io::fsync::no};
+    }
+    REQUIRE(osmium::file_size(output_file) > 10);
+
+    const int fd = osmium::io::detail::open_for_reading(output_file);
+    osmium::io::GzipDecompressor decomp{fd};
+    REQUIRE(read_all(decomp).empty());
+}
+
+TEST_CASE("Read gzip-compressed file with parallel decompressor") {
+    const int count = count_fds();
+
+    const std::string input_file = with_data_dir("t/io/data_gzip.txt.gz");
+    const int fd = osmium::io::detail::open_for_reading(input_file);
+    REQUIRE(fd > 0);
+
+    std::string all;
+    {
+        osmium::io::GzipParallelDecompressor decomp{fd};
+        all = read_all(decomp);
+    }
+
+    REQUIRE(all.size() >= 9);
+    all.resize(8);
+    REQUIRE("TESTDATA" == all);
+
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Empty gzip-compressed file with parallel decompressor") {
+    const std::string input_file = with_data_dir("t/io/empty_file");
+    const int fd = osmium::io::detail::open_for_reading(input_file);
+    REQUIRE(fd > 0);
+
+    osmium::io::GzipParallelDecompressor decomp{fd};
+    REQUIRE(decomp.read().empty());
+}
+
+TEST_CASE("Corrupted gzip-compressed file with parallel decompressor") {
+    const int count = count_fds();
+
+    const std::string input_file = with_data_dir("t/io/corrupt_data_gzip.txt.gz");
+    const int fd = osmium::io::detail::open_for_reading(input_file);
+    REQUIRE(fd > 0);
+
+    {
+        osmium::io::GzipParallelDecompressor decomp{fd};
+        REQUIRE_THROWS_AS(read_all(decomp), const osmium::gzip_error&);
+    }
+
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Gzip members with size in header") {
+    const std::string member = osmium::io::detail::gzip_compress_member("foo", Z_DEFAULT_COMPRESSION);
+    REQUIRE(osmium::io::detail::get_gzip_member_size(member.data()) == member.size());
+
+    const std::string two = member + member;
+    std::string out;
+    osmium::io::detail::gzip_stream_decoder decoder;
+    decoder.decode(two.data(), two.size(), out);
+    decoder.finish();
+    REQUIRE(out == "foofoo");
+}
@@ -0,0 +1,59 @@
+#include "catch.hpp"
+
+#include <osmium/io/detail/lz4.hpp>
+#include <osmium/io/error.hpp>
+
+#include <string>
+
+static std::string test_data() {
+    std::string data;
+    for (int i = 0; i < 1000; ++i) {
+        data += "node " + std::to_string(i) + " amenity=post_box\n";
+    }
+    return data;
+}
+
+TEST_CASE("Compress and uncompress data with lz4") {
+    const std::string data = test_data();
+    const std::string compressed = osmium::io::detail::lz4_compress(data);
+    REQUIRE(compressed.size() < data.size());
+
+    std::string output;
+    const auto result = osmium::io::detail::lz4_uncompress_string(compressed.data(), compressed.size(), data.size(), output);
+    REQUIRE(std::string(result.data(), result.size()) == data);
+}
+
+TEST_CASE("Compress and uncompress data with lz4 HC") {
+    const std::string data = test_data();
+    const std::string compressed = osmium::io::detail::lz4_compress(data, 9);
+    REQUIRE(compressed.size() < data.size());
+
+    std::string output;
+    const auto result = osmium::io::detail::lz4_uncompress_string(compressed.data(), compressed.size(), data.size(), output);
+    REQUIRE(std::string(result.data(), result.size()) == data);
+}
+
+TEST_CASE("Compress and uncompress empty data with lz4") {
+    const std::string compressed = osmium::io::detail::lz4_compress(std::string{});
+
+    std::string output;
+    const auto result = osmium::io::detail::lz4_uncompress_string(compressed.data(), compressed.size(), 0, output);
+    REQUIRE(result.size() == 0);
+}
+
+TEST_CASE("Uncompressing lz4 data with wrong size fails") {
+    const std::string data = test_data();
+    const std::string compressed = osmium::io::detail::lz4_compress(data);
+
+    std::string output;
+    REQUIRE_THROWS_AS(osmium::io::detail::lz4_uncompress_string(compressed.data(), compressed.size(), data.size() + 1, output), const osmium::io_error&);
+}
+
+TEST_CASE("Uncompressing corrupt lz4 data fails") {
+    const std::string data = test_data();
+    std::string compressed = osmium::io::detail::lz4_compress(data);
+    compressed.resize(compressed.size() / 2);
+
+    std::string output;
+    REQUIRE_THROWS_AS(osmium::io::detail::lz4_uncompress_string(compressed.data(), compressed.size(), data.size(), output), const osmium::io_error&);
+}
@@ -0,0 +1,333 @@
+#include "catch.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/io/detail/o5m_input_format.hpp>
+#include <osmium/io/detail/opl_output_format.hpp>
+#include <osmium/io/o5m_input.hpp>
+#include <osmium/io/o5m_output.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/box.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+static std::string to_opl(const osmium::memory::Buffer& buffer) {
+    osmium::memory::Buffer copy{buffer.committed() + 1024};
+    copy.add_buffer(buffer);
+    copy.commit();
+
+    osmium::io::detail::opl_output_options options;
+    options.add_metadata = osmium::metadata_options{"all"};
+    options.format_as_diff = false;
+    return osmium::io::detail::OPLOutputBlock{std::move(copy), options}();
+}
+
+static std::string write_and_read(const std::string& filename, const std::vector<osmium::memory::Buffer>& buffers, osmium::io::Header header = osmium::io::Header{}, osmium::io::Header* header_read = nullptr) {
+    {
+        osmium::io::Writer writer{filename, header, osmium::io::overwrite::allow};
+        for (const auto& buffer : buffers) {
+            osmium::memory::Buffer copy{buffer.committed() + 1024};
+            copy.add_buffer(buffer);
+            copy.commit();
+            writer(std::move(copy));
+        }
+        writer.close();
+    }
+
+    osmium::io::Reader reader{filename};
+    if (header_read) {
+        *header_read = reader.header();
+    }
+    std::string result;
+    while (osmium::memory::Buffer buffer = reader.read()) {
+        result += to_opl(buffer);
+    }
+    reader.close();
+
+    return result;
+}
+
+static std::string all_opl(const std::vector<osmium::memory::Buffer>& buffers) {
+    std::string result;
+    for (const auto& buffer : buffers) {
+        result += to_opl(buffer);
+    }
+    return result;
+}
+
+static osmium::memory::Buffer example_buffer() {
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+
+    osmium::builder::add_node(buffer, _id(1), _version(3), _cid(10), _uid(7), _user("foo"),
+                              _timestamp("2019-01-01T00:00:00Z"), _location(1.5, 2.5),
+                              _tag("amenity", "post_box"), _tag("ref", "A"));
+    osmium::builder::add_node(buffer, _id(2), _version(1), _cid(11), _uid(7), _user("foo"),
+                              _timestamp("2019-01-02T00:00:00Z"), _location(-1.5, -2.5),
+                              _tag("amenity", "post_box"));
+    osmium::builder::add_node(buffer, _id(5), _version(1), _cid(12), _uid(0), _user(""),
+                              _timestamp("2019-01-03T00:00:00Z"), _location(0.0, 0.0));
+    osmium::builder::add_node(buffer, _id(6), _version(2), _cid(13), _uid(0), _user(""),
+                              _timestamp("2019-01-03T00:00:00Z"), _location(180.0, -90.0),
+                              _tag("name", "Ünïcödé"));
+    osmium::builder::add_way(buffer, _id(20), _version(1), _cid(20), _uid(8), _user("bar"),
+                             _timestamp("2019-02-01T00:00:00Z"),
+                             _nodes({1, 2, 5, 6, 1}), _tag("highway", "primary"));
+    osmium::builder::add_way(buffer, _id(21), _version(1), _cid(20), _uid(7), _user("foo"),
+                             _timestamp("2019-02-01T00:00:00Z"),
+                             _nodes({6, 5}));
+    osmium::builder::add_relation(buffer, _id(30), _version(4), _cid(21), _uid(8), _user("bar"),
+                                  _timestamp("2019-03-01T00:00:00Z"),
+                                  _member(osmium::item_type::way, 20, "outer"),
+                                  _member(osmium::item_type::way, 21, "inner"),
+                                  _member(osmium::item_type::node, 1, ""),
+                                  _member(osmium::item_type::relation, 31, "outer"),
+                                  _tag("type", "multipolygon"));
+    osmium::builder::add_relation(buffer, _id(31), _version(1), _cid(22), _uid(7), _user("foo"),
+                                  _timestamp("2019-03-01T00:00:00Z"));
+
+    return buffer;
+}
+
+TEST_CASE("Write and read o5m file") {
+    std::vector<osmium::memory::Buffer> buffers;
+    buffers.push_back(example_buffer());
+
+    osmium::io::Header header;
+    header.add_box(osmium::Box{1.0, 2.0, 3.0, 4.0});
+    header.set("timestamp", "2019-12-01T12:00:00Z");
+
+    osmium::io::Header header_read;
+    const std::string result = write_and_read("test-o5m-output.o5m", buffers, header, &header_read);
+
+    REQUIRE(result == all_opl(buffers));
+    REQUIRE(header_read.box() == osmium::Box(1.0, 2.0, 3.0, 4.0));
+    REQUIRE(header_read.get("timestamp") == "2019-12-01T12:00:00Z");
+    REQUIRE_FALSE(header_read.has_multiple_object_versions());
+}
+
+TEST_CASE("Write and read o5m file with several buffers") {
+    std::vector<osmium::memory::Buffer> buffers;
+    buffers.push_back(example_buffer());
+    buffers.push_back(example_buffer());
+    buffers.push_back(example_buffer());
+
+    REQUIRE(write_and_read("test-o5m-output-multiple.o5m", buffers) == all_opl(buffers));
+}
+
+TEST_CASE("Write and read o5m file without metadata") {
+    std::vector<osmium::memory::Buffer> buffers;
+    buffers.push_back(example_buffer());
+
+    {
+        osmium::io::Writer writer{osmium::io::File{"test-o5m-output-nometa.o5m", "o5m,add_metadata=false"}, osmium::io::overwrite::allow};
+        osmium::memory::Buffer copy{buffers[0].committed() + 1024};
+        copy.add_buffer(buffers[0]);
+        copy.commit();
+        writer(std::move(copy));
+        writer.close();
+    }
+
+    osmium::io::Reader reader{"test-o5m-output-nometa.o5m"};
+    const osmium::memory::Buffer buffer = reader.read();
+    REQUIRE(buffer);
+    const auto& node = buffer.get<osmium::Node>(0);
+    REQUIRE(node.id() == 1);
+    REQUIRE(node.version() == 0);
+    REQUIRE(node.timestamp() == osmium::Timestamp{});
+    REQUIRE(node.location() == osmium::Location(1.5, 2.5));
+    REQUIRE(node.tags().size() == 2);
+    reader.close();
+}
+
+static std::string write_and_read_with_format(const std::string& filename, const std::string& format, osmium::memory::Buffer&& buffer) {
+    {
+        osmium::io::Writer writer{osmium::io::File{filename, format}, osmium::io::overwrite::allow};
+        writer(std::move(buffer));
+        writer.close();
+    }
+
+    osmium::io::Reader reader{filename};
+    std::string result;
+    while (osmium::memory::Buffer read_buffer = reader.read()) {
+        result += to_opl(read_buffer);
+    }
+    reader.close();
+
+    return result;
+}
+
+// The first node has the given uid and user "foo", the others have the
+// users "foo" (uid 7) and "bar" (uid 8) or, if anonymous is set, no user.
+static osmium::memory::Buffer user_buffer(osmium::user_id_type uid_of_first, const char* user_of_first, bool anonymous = false) {
+    const osmium::user_id_type uid_foo = anonymous ? 0 : 7;
+    const osmium::user_id_type uid_bar = anonymous ? 0 : 8;
+    const char* user_foo = anonymous ? "" : "foo";
+    const char* user_bar = anonymous ? "" : "bar";
+
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+    osmium::builder::add_node(buffer, _id(1), _version(1), _cid(1), _uid(uid_of_first), _user(user_of_first),
+                              _timestamp("2019-01-01T00:00:00Z"), _location(1.0, 1.0));
+    osmium::builder::add_node(buffer, _id(2), _version(1), _cid(2), _uid(uid_foo), _user(user_foo),
+                              _timestamp("2019-01-01T00:00:00Z"), _location(2.0, 2.0));
+    osmium::builder::add_node(buffer, _id(3), _version(1), _cid(3), _uid(uid_bar), _user(user_bar),
+                              _timestamp("2019-01-01T00:00:00Z"), _location(3.0, 3.0));
+    osmium::builder::add_node(buffer, _id(4), _version(1), _cid(4), _uid(uid_foo), _user(user_foo),
+                              _timestamp("2019-01-01T00:00:00Z"), _location(4.0, 4.0),
+                              _tag("foo", "bar"));
+    return buffer;
+}
+
+TEST_CASE("Write and read o5m file with uid 0 and a user name") {
+    const std::string result = write_and_read_with_format("test-o5m-output-uid0.o5m", "o5m", user_buffer(0, "foo"));
+
+    // The anonymous user (uid 0) has no user name in o5m.
+    REQUIRE(result == to_opl(user_buffer(0, "")));
+}
+
+TEST_CASE("Write and read o5m file with user metadata but without uid") {
+    const std::string result = write_and_read_with_format("test-o5m-output-nouid.o5m", "o5m,add_metadata=version+timestamp+changeset+user", user_buffer(7, "foo"));
+
+    // Without the uid all users are written as the anonymous user.
+    REQUIRE(result == to_opl(user_buffer(0, "", true)));
+}
+
+TEST_CASE("Write and read o5m file with more strings than fit into the reference table") {
+    std::vector<osmium::memory::Buffer> buffers;
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+    for (int i = 1; i <= 40000; ++i) {
+        const std::string value = std::to_string(i % 20000);
+        const std::string long_value(300, static_cast<char>('a' + i % 26));
+        osmium::builder::add_node(buffer, _id(i), _version(1), _cid(i), _uid(i % 100 + 1), _user(("user" + std::to_string(i % 100)).c_str()),
+                                  _timestamp(static_cast<uint32_t>(1500000000 + i)), _location(i * 0.001, -i * 0.001),
+                                  _tag("k", value.c_str()), _tag("long", long_value.c_str()));
+    }
+    buffers.push_back(std::move(buffer));
+
+    REQUIRE(write_and_read("test-o5m-output-large.o5m", buffers) == all_opl(buffers));
+}
+
+TEST_CASE("Write and read o5c change file with deleted objects") {
+    std::vector<osmium::memory::Buffer> buffers;
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+    osmium::builder::add_node(buffer, _id(1), _version(2), _cid(1), _uid(1), _user("a"),
+                              _timestamp("2019-01-01T00:00:00Z"), _location(1.0, 1.0));
+    osmium::builder::add_node(buffer, _id(1), _version(3), _cid(2), _uid(1), _user("a"),
+                              _timestamp("2019-01-02T00:00:00Z"), _deleted());
+    osmium::builder::add_way(buffer, _id(2), _version(2), _cid(3), _uid(1), _user("a"),
+                             _timestamp("2019-01-02T00:00:00Z"), _deleted());
+    osmium::builder::add_relation(buffer, _id(3), _version(2), _cid(4), _uid(1), _user("a"),
+                                  _timestamp("2019-01-02T00:00:00Z"), _deleted());
+    buffers.push_back(std::move(buffer));
+
+    osmium::io::Header header_read;
+    const std::string result = write_and_read("test-o5m-output.o5c", buffers, osmium::io::Header{}, &header_read);
+    REQUIRE(result == all_opl(buffers));
+    REQUIRE(header_read.has_multiple_object_versions());
+}
+
+TEST_CASE("Write empty o5m file") {
+    const std::vector<osmium::memory::Buffer> buffers;
+    REQUIRE(write_and_read("test-o5m-output-empty.o5m", buffers).empty());
+}
+
+static std::string write_file(const std::string& filename, const std::vector<osmium::memory::Buffer>& buffers) {
+    {
+        osmium::io::Writer writer{filename, osmium::io::overwrite::allow};
+        for (const auto& buffer : buffers) {
+            osmium::memory::Buffer copy{buffer.committed() + 1024};
+            copy.add_buffer(buffer);
+            copy.commit();
+            writer(std::move(copy));
+        }
+        writer.close();
+    }
+
+    std::ifstream file{filename, std::ios::binary};
+    return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+static std::string parse_o5m(const std::string& input, bool parallel) {
+    osmium::thread::Pool pool{2};
+    osmium::io::detail::future_string_queue_type input_queue;
+    osmium::io::detail::future_buffer_queue_type output_queue;
+    std::promise<osmium::io::Header> header_promise;
+
+    for (std::size_t pos = 0; pos < input.size(); pos += 100000) {
+        osmium::io::detail::add_to_queue(input_queue, input.substr(pos, 100000));
+    }
+    osmium::io::detail::add_to_queue(input_queue, std::string{});
+
+    osmium::io::detail::parser_arguments args = {
+        pool,
+        input_queue,
+        output_queue,
+        header_promise,
+        osmium::osm_entity_bits::all,
+        osmium::io::read_meta::yes,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr
+    };
+    osmium::io::detail::O5mParser parser{args, parallel};
+    parser.parse();
+
+    std::string result;
+    while (true) {
+        std::future<osmium::memory::Buffer> future_buffer;
+        output_queue.wait_and_pop(future_buffer);
+        osmium::memory::Buffer buffer{future_buffer.get()};
+        if (!buffer) {
+            break;
+        }
+        while (buffer.has_nested_buffers()) {
+            result += to_opl(*buffer.get_last_nested());
+        }
+        result += to_opl(buffer);
+    }
+
+    return result;
+}
+
+static osmium::memory::Buffer many_nodes(int first, int count, std::size_t value_length) {
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+    for (int i = first; i < first + count; ++i) {
+        const std::string value(value_length, static_cast<char>('a' + i % 26));
+        osmium::builder::add_node(buffer, _id(i), _version(1), _cid(i), _uid(i % 10 + 1), _user("user"),
+                                  _timestamp(static_cast<uint32_t>(1500000000 + i)), _location(i * 0.001, 1.0),
+                                  _tag("k", "v"), _tag("long", value.c_str()));
+    }
+    return buffer;
+}
+
+TEST_CASE("Parallel o5m decoding gives the same result as sequential decoding") {
+    std::vector<osmium::memory::Buffer> buffers;
+    for (int i = 0; i < 6; ++i) {
+        buffers.push_back(many_nodes(i * 2000 + 1, 2000, 300));
+    }
+    buffers.push_back(example_buffer());
+
+    const std::string input = write_file("test-o5m-parallel.o5m", buffers);
+    const std::string sequential = parse_o5m(input, false);
+
+    REQUIRE(sequential == all_opl(buffers));
+    REQUIRE(parse_o5m(input, true) == sequential);
+}
+
+TEST_CASE("Parallel o5m decoding falls back to sequential decoding if there are not enough resets") {
+    std::vector<osmium::memory::Buffer> buffers;
+    buffers.push_back(many_nodes(1, 1000, 300));
+    buffers.push_back(many_nodes(1001, 40000, 900));
+    buffers.push_back(many_nodes(41001, 4000, 300));
+    buffers.push_back(example_buffer());
+
+    const std::string input = write_file("test-o5m-parallel-sparse.o5m", buffers);
+    REQUIRE(parse_o5m(input, true) == all_opl(buffers));
+}
@@ -5,6 +5,7 @@
 #include <osmium/io/detail/opl_input_format.hpp>
 #include <osmium/io/opl_input.hpp>
 #include <osmium/opl.hpp>
+#include <osmium/thread/pool.hpp>
 
 #include <algorithm>
 #include <cstring>
@@ -1230,3 +1231,91 @@ TEST_CASE("line_by_line for OPL parser 28") {
     check_lbl({"foo\nb", "ar"}, {"foo", "bar"});
 }
 
+
+TEST_CASE("Count OPL lines") {
+    REQUIRE(osmium::io::detail::opl_count_lines("") == 0);
+    REQUIRE(osmium::io::detail::opl_count_lines("\n") == 0);
+    REQUIRE(osmium::io::detail::opl_count_lines("foo") == 1);
+    REQUIRE(osmium::io::detail::opl_count_lines("foo\n") == 1);
+    REQUIRE(osmium::io::detail::opl_count_lines("foo\nbar") == 2);
+    REQUIRE(osmium::io::detail::opl_count_lines("foo\r\nbar\r\n") == 2);
+    REQUIRE(osmium::io::detail::opl_count_lines("\n\nfoo\n\n\nbar\n\r") == 2);
+}
+
+TEST_CASE("Parse chunk of OPL data") {
+    osmium::io::detail::OPLChunkParser parser{"n1 v1\r\n\nw2 v1 Nn1\n# comment\nr3\n", 0, osmium::osm_entity_bits::node | osmium::osm_entity_bits::way};
+    const auto buffer = parser();
+
+    std::vector<osmium::item_type> types;
+    for (const auto& item : buffer) {
+        types.push_back(item.type());
+    }
+    REQUIRE(types.size() == 2);
+    REQUIRE(types[0] == osmium::item_type::node);
+    REQUIRE(types[1] == osmium::item_type::way);
+}
+
+namespace {
+
+    std::string make_opl_nodes(int count) {
+        std::string data;
+        for (int i = 1; i <= count; ++i) {
+            data += "n";
+            data += std::to_string(i);
+            data += " v1 dV c1 t2020-01-01T00:00:00Z i1 ufoo Tamenity=bench x1.5 y2.5\n";
+        }
+        return data;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Parse large OPL input in parallel") {
+    const std::string data = make_opl_nodes(100000);
+    REQUIRE(data.size() > 4 * osmium::io::Decompressor::input_buffer_size);
+
+    osmium::thread::Pool pool{3};
+    osmium::io::Reader reader{osmium::io::File{data.data(), data.size(), "opl"}, pool};
+
+    osmium::object_id_type expected_id = 1;
+    while (const auto buffer = reader.read()) {
+        for (auto it = buffer.cbegin<osmium::Node>(); it != buffer.cend<osmium::Node>(); ++it) {
+            REQUIRE(it->id() == expected_id);
+            ++expected_id;
+        }
+    }
+    reader.close();
+
+    REQUIRE(expected_id == 100001);
+}
+
+TEST_CASE("Line number in error message is correct when parsing in parallel") {
+    std::string data = make_opl_nodes(50000);
+    data += "\n\nx123\n";
+    data += make_opl_nodes(10);
+
+    osmium::io::Reader reader{osmium::io::File{data.data(), data.size(), "opl"}};
+    try {
+        while (reader.read()) {
+        }
+        REQUIRE(false);
+    } catch (const osmium::opl_error& e) {
+        REQUIRE(e.line == 50000);
+    }
+    reader.close();
+}
+
+TEST_CASE("OPL scanner finds the same characters as scalar version") {
+    const std::string base{"abc def\tghi,jkl=mno%41%pqrstuvwxyz0123456789abcdefghijklmnopq rstu"};
+    for (std::size_t len = 0; len <= base.size(); ++len) {
+        // Different offsets to test all alignments
+        for (std::size_t offset = 0; offset < 40; ++offset) {
+            std::string data(offset, 'x');
+            data.append(base, 0, len);
+            const char* s = data.c_str() + offset;
+            const char* section_end = osmium::io::detail::opl_find_first_of_scalar<'\0', ' ', '\t'>(s);
+            const char* string_end = osmium::io::detail::opl_find_first_of_scalar<'\0', ' ', '\t', ',', '=', '%'>(s);
+            REQUIRE(osmium::io::detail::opl_find_section_end(s) == section_end);
+            REQUIRE(osmium::io::detail::opl_find_string_end(s) == string_end);
+        }
+    }
+}
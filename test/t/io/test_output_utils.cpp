@@ -94,6 +94,20 @@ TEST_CASE("html encoding encodes special XML characters") {
     REQUIRE(out == "&amp; &quot; &apos; &lt; &gt; &#xA; &#xD; &#x9;");
 }
 
+TEST_CASE("json encoding does not encode normal characters") {
+    const char* s = "abc123,.-&<>'\xc3\xa4";
+    std::string out;
+    osmium::io::detail::append_json_encoded_string(out, s);
+    REQUIRE(out == s);
+}
+
+TEST_CASE("json encoding encodes special JSON characters") {
+    const char* s = "a\"b\\c\nd\te\x01";
+    std::string out;
+    osmium::io::detail::append_json_encoded_string(out, s);
+    REQUIRE(out == "a\\\"b\\\\c\\nd\\te\\u0001");
+}
+
 TEST_CASE("debug encoding does not encode normal characters") {
     const char* s = "abc123,.-";
     std::string out;
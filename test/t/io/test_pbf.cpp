@@ -2,9 +2,27 @@
 
 #include "utils.hpp"
 
+#include <osmium/builder/attr.hpp>
 #include <osmium/io/pbf_input.hpp>
+#include <osmium/io/pbf_output.hpp>
 #include <osmium/io/reader.hpp>
+#include <osmium/io/writer.hpp>
+#include <osmium/memory/buffer_pool.hpp>
+#include <osmium/osm/node.hpp>
 #include <osmium/osm/object.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/util/file.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 /**
  * Osmosis writes PBF with changeset=-1 if its input file did not contain the changeset field.
@@ -43,3 +61,255 @@ TEST_CASE("Read PBF file with version=-1 and changeset=-1 and DenseNodes (writte
     REQUIRE(object.version() == 0);
     REQUIRE(object.changeset() == 0);
 }
+
+TEST_CASE("Read PBF file through memory mapping") {
+    osmium::io::File file{with_data_dir("t/io/deleted_nodes.osh.pbf")};
+    const auto buffer = osmium::io::read_file(file);
+
+    osmium::io::File mapped_file{with_data_dir("t/io/deleted_nodes.osh.pbf"), "pbf,pbf_mmap=true"};
+    const auto mapped_buffer = osmium::io::read_file(mapped_file);
+
+    REQUIRE(buffer.committed() > 0);
+    REQUIRE(buffer.committed() == mapped_buffer.committed());
+    REQUIRE(std::equal(buffer.data(), buffer.data() + buffer.committed(), mapped_buffer.data()));
+}
+
+TEST_CASE("Read PBF file through memory mapping reports offset") {
+    osmium::io::File file{with_data_dir("t/io/deleted_nodes.osh.pbf"), "pbf,pbf_mmap=true"};
+    osmium::io::Reader reader{file};
+
+    REQUIRE(reader.file_size() > 0);
+    while (reader.read()) {
+    }
+    REQUIRE(reader.offset() == reader.file_size());
+    reader.close();
+}
+
+TEST_CASE("Read PBF file with buffer pool") {
+    const auto pool = std::make_shared<osmium::memory::BufferPool>();
+
+    for (int i = 0; i < 2; ++i) {
+        osmium::io::Reader reader{with_data_dir("t/io/deleted_nodes.osh.pbf"), pool};
+        std::ptrdiff_t count = 0;
+        while (auto buffer = reader.read()) {
+            count += std::distance(buffer.cbegin<osmium::Node>(), buffer.cend<osmium::Node>());
+            reader.recycle(std::move(buffer));
+        }
+        reader.close();
+        REQUIRE(count == 2);
+        REQUIRE(pool->size() == 1);
+    }
+}
+
+TEST_CASE("Read PBF file unordered") {
+    using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+    // Write a file with many blocks
+    {
+        osmium::memory::Buffer buffer{1024 * 1024, osmium::memory::Buffer::auto_grow::yes};
+        for (int i = 1; i <= 20000; ++i) {
+            osmium::builder::add_node(buffer, _id(i), _location(1.0, 2.0));
+        }
+        const osmium::io::File file{"test-pbf-unordered.osm.pbf", "pbf"};
+        osmium::io::Writer writer{file, osmium::io::overwrite::allow};
+        writer(std::move(buffer));
+        writer.close();
+    }
+
+    osmium::io::Reader reader{"test-pbf-unordered.osm.pbf", osmium::io::read_order::unordered};
+
+    std::vector<std::pair<std::size_t, osmium::object_id_type>> first_ids;
+    osmium::object_id_type count = 0;
+    while (auto buffer = reader.read()) {
+        for (auto it = buffer.cbegin<osmium::Node>(); it != buffer.cend<osmium::Node>(); ++it) {
+            if (first_ids.empty() || first_ids.back().first != reader.sequence_number()) {
+                first_ids.emplace_back(reader.sequence_number(), it->id());
+            }
+            ++count;
+        }
+    }
+    reader.close();
+
+    REQUIRE(count == 20000);
+
+    // restore order using the sequence numbers
+    std::sort(first_ids.begin(), first_ids.end());
+    REQUIRE(std::adjacent_find(first_ids.begin(), first_ids.end(), [](const std::pair<std::size_t, osmium::object_id_type>& a, const std::pair<std::size_t, osmium::object_id_type>& b) {
+        return a.first == b.first || a.second >= b.second;
+    }) == first_ids.end());
+    REQUIRE(first_ids.front().second == 1);
+
+    // closing early must not block
+    osmium::io::Reader reader2{"test-pbf-unordered.osm.pbf", osmium::io::read_order::unordered};
+    REQUIRE(reader2.read());
+    reader2.close();
+}
+
+TEST_CASE("Build PBF blob index") {
+    const auto index = osmium::io::build_pbf_blob_index(with_data_dir("t/io/deleted_nodes.osh.pbf"));
+
+    REQUIRE(index.size() == 1);
+    REQUIRE(index.file_size() == osmium::file_size(with_data_dir("t/io/deleted_nodes.osh.pbf")));
+    REQUIRE(index[0].types == osmium::osm_entity_bits::node);
+    REQUIRE(index[0].min_id == 1);
+    REQUIRE(index[0].max_id == 2);
+
+    REQUIRE(index.select(osmium::osm_entity_bits::node).size() == 1);
+    REQUIRE(index.select(osmium::osm_entity_bits::way | osmium::osm_entity_bits::relation).empty());
+    REQUIRE(index.select(osmium::osm_entity_bits::node, 2, 10).size() == 1);
+    REQUIRE(index.select(osmium::osm_entity_bits::node, 3, 10).empty());
+}
+
+TEST_CASE("Write and read PBF blob index") {
+    const auto index = osmium::io::build_pbf_blob_index(with_data_dir("t/io/deleted_nodes.osh.pbf"));
+    index.write("test-pbf-blob-index.idx");
+
+    const auto index2 = osmium::io::PBFBlobIndex::read("test-pbf-blob-index.idx");
+    REQUIRE(index2.file_size() == index.file_size());
+    REQUIRE(index2.size() == index.size());
+    REQUIRE(index2[0].offset == index[0].offset);
+    REQUIRE(index2[0].size == index[0].size);
+    REQUIRE(index2[0].types == index[0].types);
+    REQUIRE(index2[0].min_id == index[0].min_id);
+    REQUIRE(index2[0].max_id == index[0].max_id);
+
+    REQUIRE(0 == std::remove("test-pbf-blob-index.idx"));
+
+    REQUIRE_THROWS_AS(osmium::io::PBFBlobIndex::read(with_data_dir("t/io/deleted_nodes.osh.pbf")), const osmium::io_error&);
+}
+
+TEST_CASE("Read PBF file using blob index") {
+    const auto index = osmium::io::build_pbf_blob_index(with_data_dir("t/io/deleted_nodes.osh.pbf"));
+    osmium::io::File file{with_data_dir("t/io/deleted_nodes.osh.pbf"), "pbf,pbf_mmap=true"};
+
+    SECTION("all blobs") {
+        const auto buffer = osmium::io::read_file(file, index);
+        REQUIRE(std::distance(buffer.cbegin<osmium::Node>(), buffer.cend<osmium::Node>()) == 2);
+    }
+
+    SECTION("no matching blobs") {
+        const auto buffer = osmium::io::read_file(file, index.select(osmium::osm_entity_bits::way));
+        REQUIRE(buffer.committed() == 0);
+    }
+
+    SECTION("without memory mapping") {
+        osmium::io::Reader reader{with_data_dir("t/io/deleted_nodes.osh.pbf"), index};
+        REQUIRE_THROWS_AS(reader.read(), const osmium::io_error&);
+    }
+}
+
+TEST_CASE("Skip blobs using index data in BlobHeader") {
+    using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+    osmium::builder::add_node(buffer, _id(10), _location(1.0, 2.0));
+    osmium::builder::add_node(buffer, _id(11), _location(1.1, 2.1));
+    osmium::builder::add_way(buffer, _id(20), _nodes({10, 11}));
+    osmium::builder::add_relation(buffer, _id(30), _member(osmium::item_type::way, 20));
+
+    {
+        const osmium::io::File file{"test-pbf-index-data.osm.pbf", "pbf,pbf_add_index_data=true"};
+        osmium::io::Writer writer{file, osmium::io::overwrite::allow};
+        writer(std::move(buffer));
+        writer.close();
+    }
+
+    SECTION("read only ways") {
+        const auto result = osmium::io::read_file("test-pbf-index-data.osm.pbf", osmium::osm_entity_bits::way);
+        REQUIRE(std::distance(result.cbegin<osmium::OSMObject>(), result.cend<osmium::OSMObject>()) == 1);
+        REQUIRE(result.cbegin<osmium::Way>()->id() == 20);
+    }
+
+    SECTION("read only relations with memory mapping") {
+        osmium::io::File file{"test-pbf-index-data.osm.pbf", "pbf,pbf_mmap=true"};
+        const auto result = osmium::io::read_file(file, osmium::osm_entity_bits::relation);
+        REQUIRE(std::distance(result.cbegin<osmium::OSMObject>(), result.cend<osmium::OSMObject>()) == 1);
+        REQUIRE(result.cbegin<osmium::Relation>()->id() == 30);
+    }
+
+    SECTION("read everything") {
+        const auto result = osmium::io::read_file("test-pbf-index-data.osm.pbf");
+        REQUIRE(std::distance(result.cbegin<osmium::OSMObject>(), result.cend<osmium::OSMObject>()) == 4);
+    }
+
+    SECTION("build blob index from index data") {
+        const auto index = osmium::io::build_pbf_blob_index("test-pbf-index-data.osm.pbf");
+        REQUIRE(index.size() == 3);
+        REQUIRE(index[0].types == osmium::osm_entity_bits::node);
+        REQUIRE(index[0].min_id == 10);
+        REQUIRE(index[0].max_id == 11);
+        REQUIRE(index[1].types == osmium::osm_entity_bits::way);
+        REQUIRE(index[1].min_id == 20);
+        REQUIRE(index[2].types == osmium::osm_entity_bits::relation);
+        REQUIRE(index[2].max_id == 30);
+    }
+}
+
+TEST_CASE("Write PBF file with invalid compression options") {
+    osmium::io::Header header;
+
+    SECTION("unknown compression") {
+        const osmium::io::File file{"test-pbf-compression.osm.pbf", "pbf,pbf_compression=foo"};
+        REQUIRE_THROWS_AS(osmium::io::Writer(file, header, osmium::io::overwrite::allow), const std::invalid_argument&);
+    }
+
+    SECTION("compression level too large for zlib") {
+        const osmium::io::File file{"test-pbf-compression.osm.pbf", "pbf,pbf_compression=zlib,pbf_compression_level=99"};
+        REQUIRE_THROWS_AS(osmium::io::Writer(file, header, osmium::io::overwrite::allow), const std::invalid_argument&);
+    }
+
+    SECTION("compression level without compression") {
+        const osmium::io::File file{"test-pbf-compression.osm.pbf", "pbf,pbf_compression=none,pbf_compression_level=1"};
+        REQUIRE_THROWS_AS(osmium::io::Writer(file, header, osmium::io::overwrite::allow), const std::invalid_argument&);
+    }
+
+    SECTION("invalid compression level") {
+        const osmium::io::File file{"test-pbf-compression.osm.pbf", "pbf,pbf_compression=zlib,pbf_compression_level=x"};
+        REQUIRE_THROWS_AS(osmium::io::Writer(file, header, osmium::io::overwrite::allow), const std::invalid_argument&);
+    }
+}
+
+static void check_pbf_compression_roundtrip(const char* options) {
+    using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+    osmium::builder::add_node(buffer, _id(1), _location(1.0, 2.0), _tag("amenity", "post_box"));
+    osmium::builder::add_way(buffer, _id(2), _nodes({1, 3}));
+
+    {
+        const osmium::io::File file{"test-pbf-compression.osm.pbf", options};
+        osmium::io::Writer writer{file, osmium::io::overwrite::allow};
+        writer(std::move(buffer));
+        writer.close();
+    }
+
+    const auto result = osmium::io::read_file("test-pbf-compression.osm.pbf");
+    REQUIRE(std::distance(result.cbegin<osmium::OSMObject>(), result.cend<osmium::OSMObject>()) == 2);
+    const auto& node = *result.cbegin<osmium::Node>();
+    REQUIRE(node.id() == 1);
+    REQUIRE(std::string{node.tags().get_value_by_key("amenity")} == "post_box");
+    REQUIRE(result.cbegin<osmium::Way>()->nodes().size() == 2);
+}
+
+TEST_CASE("Write and read PBF file without compression") {
+    check_pbf_compression_roundtrip("pbf,pbf_compression=none");
+}
+
+TEST_CASE("Write and read PBF file with zlib compression levels") {
+    check_pbf_compression_roundtrip("pbf,pbf_compression=zlib,pbf_compression_level=1");
+    check_pbf_compression_roundtrip("pbf,pbf_compression_level=9");
+}
+
+#ifdef OSMIUM_WITH_LZ4
+TEST_CASE("Write and read PBF file with lz4 compression") {
+    check_pbf_compression_roundtrip("pbf,pbf_compression=lz4");
+    check_pbf_compression_roundtrip("pbf,pbf_compression=lz4,pbf_compression_level=9");
+}
+#endif
+
+#ifdef OSMIUM_WITH_ZSTD
+TEST_CASE("Write and read PBF file with zstd compression") {
+    check_pbf_compression_roundtrip("pbf,pbf_compression=zstd");
+    check_pbf_compression_roundtrip("pbf,pbf_compression=zstd,pbf_compression_level=19");
+}
+#endif
@@ -10,12 +10,17 @@
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
 #include <osmium/io/reader.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/thread/pool.hpp>
 #include <osmium/thread/queue.hpp>
 #include <osmium/thread/util.hpp>
 
+#include <chrono>
+#include <future>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
 
 class MockParser : public osmium::io::detail::Parser {
@@ -109,3 +114,75 @@ TEST_CASE("Test Reader using MockParser") {
 
 }
 
+
+struct GatedTask {
+
+    std::shared_future<void> gate;
+    osmium::object_id_type id;
+
+    osmium::memory::Buffer operator()() const {
+        if (gate.valid()) {
+            gate.wait_for(std::chrono::seconds{5});
+        } else {
+            // Make sure the Reader is already waiting when we are done.
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        }
+        osmium::memory::Buffer buffer(1000);
+        osmium::builder::add_node(buffer, osmium::builder::attr::_id(id));
+        return buffer;
+    }
+
+}; // struct GatedTask
+
+class MockUnorderedParser : public osmium::io::detail::Parser {
+
+    std::shared_future<void> m_gate;
+
+public:
+
+    MockUnorderedParser(osmium::io::detail::parser_arguments& args,
+                        std::shared_future<void> gate) :
+        Parser(args),
+        m_gate(std::move(gate)) {
+    }
+
+    void run() final {
+        osmium::thread::set_thread_name("_osmium_mock_in");
+
+        set_header_value(osmium::io::Header{});
+
+        // The first task is held up until the test opens the gate.
+        send_to_output_queue(submit_to_pool(GatedTask{m_gate, 1}));
+        send_to_output_queue(submit_to_pool(GatedTask{std::shared_future<void>{}, 2}));
+    }
+
+}; // class MockUnorderedParser
+
+TEST_CASE("Reader in unordered mode returns buffers in order of completion") {
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+
+    osmium::io::detail::ParserFactory::instance().register_parser(
+        osmium::io::file_format::xml,
+        [&](osmium::io::detail::parser_arguments& args) {
+        return std::unique_ptr<osmium::io::detail::Parser>(new MockUnorderedParser(args, gate_future));
+    });
+
+    osmium::thread::Pool pool{2};
+    osmium::io::Reader reader{with_data_dir("t/io/data.osm"), pool, osmium::io::read_order::unordered};
+
+    auto buffer = reader.read();
+    REQUIRE(buffer);
+    REQUIRE(reader.sequence_number() == 1);
+    REQUIRE(buffer.get<osmium::Node>(0).id() == 2);
+
+    gate.set_value();
+
+    buffer = reader.read();
+    REQUIRE(buffer);
+    REQUIRE(reader.sequence_number() == 0);
+    REQUIRE(buffer.get<osmium::Node>(0).id() == 1);
+
+    REQUIRE_FALSE(reader.read());
+    reader.close();
+}
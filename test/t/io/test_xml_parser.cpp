@@ -0,0 +1,330 @@
+#include "catch.hpp"
+
+#include <osmium/io/detail/queue_util.hpp>
+#include <osmium/io/detail/xml_splitter.hpp>
+#include <osmium/io/xml_input.hpp>
+#include <osmium/osm/changeset.hpp>
+#include <osmium/osm/object.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <algorithm>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+using piece_type = osmium::io::detail::XMLSplitter::piece_type;
+
+static const char* osm_data =
+    "<?xml version='1.0' encoding='UTF-8'?>\n"
+    "<osm version=\"0.6\" generator=\"test > generator\">\n"
+    "  <bounds minlat=\"1\" minlon=\"2\" maxlat=\"3\" maxlon=\"4\"/>\n"
+    "  <!-- a comment with <node> in it -->\n"
+    "  <node id=\"1\" version=\"2\" lat=\"1.5\" lon=\"2.5\" user=\"a'b\"/>\n"
+    "  <node id=\"2\" version=\"1\" lat=\"1\" lon=\"2\" user='x>\"y'>\n"
+    "    <tag k=\"note\" v=\"&lt;b&gt; &amp; &#x41;\"/>\n"
+    "  </node>\n"
+    "  <way id=\"10\" version=\"1\">\n"
+    "    <nd ref=\"1\"/><nd ref=\"2\"/>\n"
+    "    <tag k=\"highway\" v=\"road\"/>\n"
+    "  </way>\n"
+    "  <relation id=\"20\" version=\"1\">\n"
+    "    <member type=\"way\" ref=\"10\" role=\"outer\"/>\n"
+    "  </relation>\n"
+    "  <changeset id=\"30\" num_changes=\"3\">\n"
+    "    <tag k=\"comment\" v=\"test\"/>\n"
+    "    <discussion><comment uid=\"1\" user=\"foo\"><text>a > b</text></comment></discussion>\n"
+    "  </changeset>\n"
+    "</osm>\n";
+
+static const char* osc_data =
+    "<?xml version='1.0' encoding='UTF-8'?>\n"
+    "<osmChange version=\"0.6\" generator=\"test\">\n"
+    "  <create>\n"
+    "    <node id=\"1\" version=\"1\" lat=\"1\" lon=\"1\"/>\n"
+    "    <node id=\"2\" version=\"1\" lat=\"2\" lon=\"2\"/>\n"
+    "  </create>\n"
+    "  <modify>\n"
+    "    <way id=\"10\" version=\"2\"><nd ref=\"1\"/><nd ref=\"2\"/></way>\n"
+    "  </modify>\n"
+    "  <delete>\n"
+    "    <node id=\"3\" version=\"4\" lat=\"3\" lon=\"3\"/>\n"
+    "    <relation id=\"20\" version=\"2\"></relation>\n"
+    "  </delete>\n"
+    "</osmChange>\n";
+
+struct piece {
+    piece_type type;
+    std::string data;
+    std::string section;
+};
+
+static std::vector<piece> split(const std::string& input, std::size_t block_size) {
+    osmium::io::detail::XMLSplitter splitter;
+    std::vector<piece> pieces;
+
+    for (std::size_t pos = 0; pos < input.size(); pos += block_size) {
+        splitter.append(input.substr(pos, block_size));
+        auto type = splitter.next();
+        for (; type == piece_type::text || type == piece_type::object; type = splitter.next()) {
+            pieces.push_back(piece{type, std::string{splitter.piece_data(), splitter.piece_size()}, splitter.section_name()});
+        }
+        if (type == piece_type::unsupported) {
+            pieces.push_back(piece{type, splitter.rest() + input.substr(std::min(pos + block_size, input.size())), ""});
+            return pieces;
+        }
+    }
+    pieces.push_back(piece{piece_type::text, splitter.rest(), ""});
+
+    return pieces;
+}
+
+TEST_CASE("XML splitter finds top-level objects") {
+    const std::string input{osm_data};
+
+    for (const std::size_t block_size : {1, 7, 100, 100000}) {
+        const auto pieces = split(input, block_size);
+        REQUIRE(pieces.size() == 11);
+
+        std::string all;
+        for (const auto& p : pieces) {
+            all += p.data;
+        }
+        REQUIRE(all == input);
+
+        REQUIRE(pieces[0].type == piece_type::text);
+        REQUIRE(pieces[0].data.find("<!-- a comment") != std::string::npos);
+        REQUIRE(pieces[1].type == piece_type::object);
+        REQUIRE(pieces[1].data.substr(0, 14) == "<node id=\"1\" v");
+        REQUIRE(pieces[2].type == piece_type::text);
+        REQUIRE(pieces[2].data == "\n  ");
+        REQUIRE(pieces[3].type == piece_type::object);
+        REQUIRE(pieces[3].data.substr(pieces[3].data.size() - 7) == "</node>");
+        REQUIRE(pieces[5].type == piece_type::object);
+        REQUIRE(pieces[5].data.substr(0, 4) == "<way");
+        REQUIRE(pieces[7].type == piece_type::object);
+        REQUIRE(pieces[7].data.substr(0, 9) == "<relation");
+        REQUIRE(pieces[9].type == piece_type::object);
+        REQUIRE(pieces[9].data.substr(pieces[9].data.size() - 12) == "</changeset>");
+        REQUIRE(pieces[10].type == piece_type::text);
+        REQUIRE(pieces[10].data == "\n</osm>\n");
+    }
+}
+
+TEST_CASE("XML splitter remembers change sections") {
+    const auto pieces = split(osc_data, 5);
+
+    std::vector<std::string> sections;
+    for (const auto& p : pieces) {
+        if (p.type == piece_type::object) {
+            sections.push_back(p.section);
+        }
+    }
+
+    const std::vector<std::string> expected = {"create", "create", "modify", "delete", "delete"};
+    REQUIRE(sections == expected);
+}
+
+TEST_CASE("XML splitter can not handle DOCTYPE declarations") {
+    const std::string input{"<?xml version='1.0'?>\n<!DOCTYPE osm [ <!ENTITY a 'b'> ]>\n<osm version='0.6'><node id='1'/></osm>"};
+    const auto pieces = split(input, 10);
+    REQUIRE(pieces.back().type == piece_type::unsupported);
+    REQUIRE(pieces.back().data == input);
+}
+
+TEST_CASE("XML splitter can not handle encodings other than UTF-8") {
+    const auto pieces = split("<?xml version='1.0' encoding='ISO-8859-1'?>\n<osm version='0.6'><node id='1'/></osm>", 1000);
+    REQUIRE(pieces.back().type == piece_type::unsupported);
+}
+
+struct object_summary {
+    osmium::item_type type;
+    osmium::object_id_type id;
+    bool visible;
+    std::size_t tags;
+    std::string data;
+
+    bool operator==(const object_summary& other) const noexcept {
+        return type == other.type && id == other.id && visible == other.visible &&
+               tags == other.tags && data == other.data;
+    }
+};
+
+static void add_objects(std::vector<object_summary>& objects, const osmium::memory::Buffer& buffer) {
+    for (const auto& item : buffer) {
+        std::string data{reinterpret_cast<const char*>(item.data()), item.byte_size()};
+        if (item.type() == osmium::item_type::changeset) {
+            const auto& changeset = static_cast<const osmium::Changeset&>(item);
+            objects.push_back(object_summary{item.type(), changeset.id(), true, changeset.tags().size(), std::move(data)});
+        } else {
+            const auto& object = static_cast<const osmium::OSMObject&>(item);
+            objects.push_back(object_summary{item.type(), object.id(), object.visible(), object.tags().size(), std::move(data)});
+        }
+    }
+}
+
+static std::vector<object_summary> parse_xml(const std::string& input, bool parallel, osmium::io::Header* header = nullptr, bool pull_parser = false) {
+    osmium::thread::Pool pool{2};
+    osmium::io::detail::future_string_queue_type input_queue;
+    osmium::io::detail::future_buffer_queue_type output_queue;
+    std::promise<osmium::io::Header> header_promise;
+    std::future<osmium::io::Header> header_future = header_promise.get_future();
+
+    for (std::size_t pos = 0; pos < input.size(); pos += 13) {
+        osmium::io::detail::add_to_queue(input_queue, input.substr(pos, 13));
+    }
+    osmium::io::detail::add_to_queue(input_queue, std::string{});
+
+    osmium::io::detail::parser_arguments args = {
+        pool,
+        input_queue,
+        output_queue,
+        header_promise,
+        osmium::osm_entity_bits::all,
+        osmium::io::read_meta::yes,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr
+    };
+    osmium::io::detail::XMLParser parser{args, parallel, pull_parser};
+    parser.parse();
+
+    if (header) {
+        *header = header_future.get();
+    }
+
+    std::vector<object_summary> objects;
+    while (true) {
+        std::future<osmium::memory::Buffer> future_buffer;
+        output_queue.wait_and_pop(future_buffer);
+        osmium::memory::Buffer buffer{future_buffer.get()};
+        if (!buffer) {
+            break;
+        }
+        while (buffer.has_nested_buffers()) {
+            add_objects(objects, *buffer.get_last_nested());
+        }
+        add_objects(objects, buffer);
+    }
+
+    return objects;
+}
+
+TEST_CASE("Parallel XML parsing gives the same result as sequential parsing") {
+    osmium::io::Header header;
+    const auto sequential = parse_xml(osm_data, false);
+    const auto parallel = parse_xml(osm_data, true, &header);
+
+    REQUIRE(sequential.size() == 5);
+    REQUIRE(parallel == sequential);
+
+    REQUIRE(header.get("generator") == "test > generator");
+    REQUIRE(header.box() == osmium::Box(2.0, 1.0, 4.0, 3.0));
+}
+
+TEST_CASE("Parallel XML parsing of change files") {
+    osmium::io::Header header;
+    const auto sequential = parse_xml(osc_data, false);
+    const auto parallel = parse_xml(osc_data, true, &header);
+
+    REQUIRE(sequential.size() == 5);
+    REQUIRE(parallel == sequential);
+    REQUIRE_FALSE(parallel[3].visible);
+    REQUIRE_FALSE(parallel[4].visible);
+    REQUIRE(header.has_multiple_object_versions());
+}
+
+TEST_CASE("Parallel XML parsing of many objects") {
+    std::string input{"<osm version=\"0.6\">\n"};
+    for (int i = 1; i <= 50000; ++i) {
+        input += "<node id=\"" + std::to_string(i) + "\" lat=\"1\" lon=\"1\"><tag k=\"a\" v=\"b\"/></node>\n";
+    }
+    input += "</osm>\n";
+
+    const auto parallel = parse_xml(input, true);
+    REQUIRE(parallel.size() == 50000);
+    REQUIRE(parallel == parse_xml(input, false));
+    REQUIRE(parallel.back().id == 50000);
+}
+
+TEST_CASE("Parallel XML parsing rejects entity declarations") {
+    const std::string input{"<?xml version='1.0'?>\n<!DOCTYPE osm [ <!ENTITY a 'b'> ]>\n<osm version='0.6'><node id='1'/></osm>"};
+    REQUIRE_THROWS_AS(parse_xml(input, true), const osmium::xml_error&);
+    REQUIRE_THROWS_WITH(parse_xml(input, true), "XML entities are not supported");
+}
+
+TEST_CASE("Parallel XML parsing reports errors in objects") {
+    const std::string input{"<osm version='0.6'><node id='1'><foo/></node></osm>"};
+    REQUIRE_THROWS_WITH(parse_xml(input, true), "Unknown element in <node>: foo");
+}
+
+TEST_CASE("Parallel XML parsing checks the version") {
+    const std::string input{"<osm version='0.5'><node id='1'/></osm>"};
+    REQUIRE_THROWS_AS(parse_xml(input, true), const osmium::format_version_error&);
+}
+
+static std::vector<object_summary> pull_parse_xml(const std::string& input, bool parallel = false) {
+    return parse_xml(input, parallel, nullptr, true);
+}
+
+TEST_CASE("XML pull parser gives the same result as Expat") {
+    const auto expat = parse_xml(osm_data, false);
+    REQUIRE(expat.size() == 5);
+    REQUIRE(pull_parse_xml(osm_data) == expat);
+    REQUIRE(pull_parse_xml(osm_data, true) == expat);
+}
+
+TEST_CASE("XML pull parser with change files") {
+    const auto expat = parse_xml(osc_data, false);
+    REQUIRE(pull_parse_xml(osc_data) == expat);
+}
+
+TEST_CASE("XML pull parser decodes entities, whitespace, and CDATA like Expat") {
+    const std::string input{
+        "<osm version='0.6'>\r\n"
+        "<node id='1' user='&#228;&#x20AC;&#x1F600;&quot;&apos;'>\r\n"
+        "  <tag k='a\tb\r\nc\nd' v='&#9;&#10;&#13;&lt;&gt;&amp;'/>\r\n"
+        "  <!-- comment with <tag k='x' v='y'/> -->\r\n"
+        "  <?pi some > data?>\r\n"
+        "</node>\r\n"
+        "<changeset id='2'>"
+        "<discussion><comment uid='1' user='u'>"
+        "<text>line1\r\nline2\rline3 &amp; <![CDATA[<b>&amp;\r\n]]> end</text>"
+        "</comment></discussion>"
+        "</changeset>\n"
+        "</osm>\n"};
+
+    const auto expat = parse_xml(input, false);
+    REQUIRE(expat.size() == 2);
+    REQUIRE(pull_parse_xml(input) == expat);
+}
+
+TEST_CASE("XML pull parser reports errors") {
+    REQUIRE_THROWS_WITH(pull_parse_xml("<osm version='0.6'><node id='1'></way></osm>"),
+                        "XML parsing error at line 1, column 32: mismatched tag");
+    REQUIRE_THROWS_WITH(pull_parse_xml("<osm version='0.6'>\n<node id='1' user='&foo;'/></osm>"),
+                        "XML parsing error at line 2, column 19: undefined entity");
+    REQUIRE_THROWS_AS(pull_parse_xml("<osm version='0.6'><node id='1' user='a<b'/></osm>"), const osmium::xml_error&);
+    REQUIRE_THROWS_AS(pull_parse_xml("<osm version='0.6'><node id='1' user='a'"), const osmium::xml_error&);
+    REQUIRE_THROWS_AS(pull_parse_xml("<osm version='0.6'><node id='1'user='a'/></osm>"), const osmium::xml_error&);
+    REQUIRE_THROWS_AS(pull_parse_xml("<osm version='0.6'><node id='1'><tag k='a' v='&#0;'/></node></osm>"), const osmium::xml_error&);
+    REQUIRE_THROWS_WITH(pull_parse_xml("<osm version='0.6'><node id='1'><foo/></node></osm>"),
+                        "Unknown element in <node>: foo");
+}
+
+TEST_CASE("XML errors in parallel mode are reported with document positions") {
+    const std::string input{"<osm version='0.6'>\n<node id='1'/>\n  <node id='2' user='&foo;'/></osm>"};
+
+    // Expat reports the start of the element
+    REQUIRE_THROWS_WITH(parse_xml(input, false),
+                        "XML parsing error at line 3, column 2: undefined entity");
+    REQUIRE_THROWS_WITH(parse_xml(input, true),
+                        "XML parsing error at line 3, column 2: undefined entity");
+
+    // The pull parser reports the start of the entity
+    REQUIRE_THROWS_WITH(pull_parse_xml(input),
+                        "XML parsing error at line 3, column 21: undefined entity");
+    REQUIRE_THROWS_WITH(pull_parse_xml(input, true),
+                        "XML parsing error at line 3, column 21: undefined entity");
+}
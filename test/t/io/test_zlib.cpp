@@ -0,0 +1,54 @@
+#include "catch.hpp"
+
+#include <osmium/io/detail/zlib.hpp>
+#include <osmium/io/error.hpp>
+
+#include <string>
+
+// These tests run against zlib or, if compiled with OSMIUM_WITH_LIBDEFLATE,
+// against libdeflate.
+
+static std::string test_data() {
+    std::string data;
+    for (int i = 0; i < 1000; ++i) {
+        data += "node " + std::to_string(i) + " amenity=post_box\n";
+    }
+    return data;
+}
+
+static void check_zlib_roundtrip(int level) {
+    const std::string data = test_data();
+    const std::string compressed = osmium::io::detail::zlib_compress(data, level);
+    REQUIRE(compressed.size() < data.size());
+
+    std::string output;
+    const auto result = osmium::io::detail::zlib_uncompress_string(compressed.data(), compressed.size(), data.size(), output);
+    REQUIRE(std::string(result.data(), result.size()) == data);
+}
+
+TEST_CASE("Compress and uncompress data with zlib using default level") {
+    check_zlib_roundtrip(0);
+}
+
+TEST_CASE("Compress and uncompress data with zlib using all levels") {
+    for (int level = 1; level <= osmium::io::detail::zlib_max_compression_level(); ++level) {
+        check_zlib_roundtrip(level);
+    }
+}
+
+TEST_CASE("Uncompressing zlib data into too small buffer fails") {
+    const std::string data = test_data();
+    const std::string compressed = osmium::io::detail::zlib_compress(data);
+
+    std::string output;
+    REQUIRE_THROWS_AS(osmium::io::detail::zlib_uncompress_string(compressed.data(), compressed.size(), data.size() - 1, output), const osmium::io_error&);
+}
+
+TEST_CASE("Uncompressing corrupt zlib data fails") {
+    const std::string data = test_data();
+    std::string compressed = osmium::io::detail::zlib_compress(data);
+    compressed.resize(compressed.size() / 2);
+
+    std::string output;
+    REQUIRE_THROWS_AS(osmium::io::detail::zlib_uncompress_string(compressed.data(), compressed.size(), data.size(), output), const osmium::io_error&);
+}
@@ -0,0 +1,59 @@
+#include "catch.hpp"
+
+#include <osmium/io/detail/zstd.hpp>
+#include <osmium/io/error.hpp>
+
+#include <string>
+
+static std::string test_data() {
+    std::string data;
+    for (int i = 0; i < 1000; ++i) {
+        data += "node " + std::to_string(i) + " amenity=post_box\n";
+    }
+    return data;
+}
+
+TEST_CASE("Compress and uncompress data with zstd") {
+    const std::string data = test_data();
+    const std::string compressed = osmium::io::detail::zstd_compress(data);
+    REQUIRE(compressed.size() < data.size());
+
+    std::string output;
+    const auto result = osmium::io::detail::zstd_uncompress_string(compressed.data(), compressed.size(), data.size(), output);
+    REQUIRE(std::string(result.data(), result.size()) == data);
+}
+
+TEST_CASE("Compress and uncompress data with zstd level 19") {
+    const std::string data = test_data();
+    const std::string compressed = osmium::io::detail::zstd_compress(data, 19);
+    REQUIRE(compressed.size() < data.size());
+
+    std::string output;
+    const auto result = osmium::io::detail::zstd_uncompress_string(compressed.data(), compressed.size(), data.size(), output);
+    REQUIRE(std::string(result.data(), result.size()) == data);
+}
+
+TEST_CASE("Compress and uncompress empty data with zstd") {
+    const std::string compressed = osmium::io::detail::zstd_compress(std::string{});
+
+    std::string output;
+    const auto result = osmium::io::detail::zstd_uncompress_string(compressed.data(), compressed.size(), 0, output);
+    REQUIRE(result.size() == 0);
+}
+
+TEST_CASE("Uncompressing zstd data with wrong size fails") {
+    const std::string data = test_data();
+    const std::string compressed = osmium::io::detail::zstd_compress(data);
+
+    std::string output;
+    REQUIRE_THROWS_AS(osmium::io::detail::zstd_uncompress_string(compressed.data(), compressed.size(), data.size() + 1, output), const osmium::io_error&);
+}
+
+TEST_CASE("Uncompressing corrupt zstd data fails") {
+    const std::string data = test_data();
+    std::string compressed = osmium::io::detail::zstd_compress(data);
+    compressed.resize(compressed.size() / 2);
+
+    std::string output;
+    REQUIRE_THROWS_AS(osmium::io::detail::zstd_uncompress_string(compressed.data(), compressed.size(), data.size(), output), const osmium::io_error&);
+}
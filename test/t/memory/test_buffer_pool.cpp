@@ -0,0 +1,82 @@
+#include "catch.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/memory/buffer_pool.hpp>
+
+#include <iterator>
+#include <utility>
+
+using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+TEST_CASE("Get buffer from empty pool") {
+    osmium::memory::BufferPool pool;
+    REQUIRE(pool.size() == 0);
+
+    auto buffer = pool.get(1000);
+    REQUIRE(buffer);
+    REQUIRE(buffer.capacity() >= 1000);
+    REQUIRE(buffer.committed() == 0);
+    REQUIRE(pool.size() == 0);
+}
+
+TEST_CASE("Buffer memory is re-used") {
+    osmium::memory::BufferPool pool;
+
+    auto buffer = pool.get(1000);
+    osmium::builder::add_node(buffer, _id(1));
+    REQUIRE(buffer.committed() > 0);
+    const auto* data = buffer.data();
+
+    pool.put(std::move(buffer));
+    REQUIRE(pool.size() == 1);
+
+    auto buffer2 = pool.get(500);
+    REQUIRE(pool.size() == 0);
+    REQUIRE(buffer2.data() == data);
+    REQUIRE(buffer2.committed() == 0);
+    REQUIRE(std::distance(buffer2.begin(), buffer2.end()) == 0);
+
+    osmium::builder::add_node(buffer2, _id(2));
+    REQUIRE(buffer2.begin()->type() == osmium::item_type::node);
+}
+
+TEST_CASE("Buffer from pool grows to requested capacity") {
+    osmium::memory::BufferPool pool;
+
+    pool.put(osmium::memory::Buffer{1000});
+    auto buffer = pool.get(10000);
+    REQUIRE(buffer.capacity() >= 10000);
+}
+
+TEST_CASE("Nested buffers are put into pool separately") {
+    osmium::memory::BufferPool pool;
+
+    osmium::memory::Buffer buffer{128, osmium::memory::Buffer::auto_grow::internal};
+    for (int i = 1; i < 20; ++i) {
+        osmium::builder::add_node(buffer, _id(i));
+    }
+    REQUIRE(buffer.has_nested_buffers());
+
+    pool.put(std::move(buffer));
+    REQUIRE(pool.size() > 1);
+}
+
+TEST_CASE("Invalid and external buffers are not put into pool") {
+    osmium::memory::BufferPool pool;
+
+    pool.put(osmium::memory::Buffer{});
+    REQUIRE(pool.size() == 0);
+
+    alignas(osmium::memory::align_bytes) unsigned char data[64] = {0};
+    pool.put(osmium::memory::Buffer{data, sizeof(data), 0});
+    REQUIRE(pool.size() == 0);
+}
+
+TEST_CASE("Buffer pool has maximum size") {
+    osmium::memory::BufferPool pool{2};
+
+    pool.put(osmium::memory::Buffer{1000});
+    pool.put(osmium::memory::Buffer{1000});
+    pool.put(osmium::memory::Buffer{1000});
+    REQUIRE(pool.size() == 2);
+}
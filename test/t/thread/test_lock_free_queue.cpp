@@ -0,0 +1,128 @@
+#include "catch.hpp"
+
+#define OSMIUM_USE_LOCK_FREE_QUEUE
+#include <osmium/thread/lock_free_queue.hpp>
+#include <osmium/thread/queue.hpp>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+static_assert(std::is_same<osmium::thread::Queue<int>, osmium::thread::LockFreeQueue<int>>::value,
+              "Queue should be the lock-free queue if OSMIUM_USE_LOCK_FREE_QUEUE is defined");
+
+TEST_CASE("Basic use of lock-free queue") {
+    osmium::thread::LockFreeQueue<int> queue;
+    REQUIRE(queue.empty());
+    queue.push(22);
+    REQUIRE_FALSE(queue.empty());
+    REQUIRE(queue.size() == 1);
+    int value = 0;
+    queue.wait_and_pop(value);
+    REQUIRE(value == 22);
+    REQUIRE(queue.empty());
+    REQUIRE_FALSE(queue.try_pop(value));
+}
+
+TEST_CASE("Lock-free queue keeps order and wraps around") {
+    osmium::thread::LockFreeQueue<int> queue{3, "small queue"};
+    int value = 0;
+    for (int i = 0; i < 10; ++i) {
+        queue.push(i);
+        queue.push(i + 100);
+        REQUIRE(queue.size() == 2);
+        REQUIRE(queue.try_pop(value));
+        REQUIRE(value == i);
+        REQUIRE(queue.try_pop(value));
+        REQUIRE(value == i + 100);
+        REQUIRE(queue.empty());
+    }
+}
+
+TEST_CASE("Lock-free queue with move-only type") {
+    osmium::thread::LockFreeQueue<std::unique_ptr<int>> queue{2};
+    queue.push(std::unique_ptr<int>{new int{7}});
+    std::unique_ptr<int> value;
+    REQUIRE(queue.try_pop(value));
+    REQUIRE(value);
+    REQUIRE(*value == 7);
+}
+
+TEST_CASE("Lock-free queue with several producers and consumers") {
+    osmium::thread::LockFreeQueue<int> queue{4};
+
+    constexpr const int num_producers = 3;
+    constexpr const int num_per_producer = 10000;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&queue]() {
+            for (int i = 1; i <= num_per_producer; ++i) {
+                queue.push(i);
+            }
+        });
+    }
+
+    std::vector<long long> sums(2, 0);
+    std::vector<std::thread> consumers;
+    for (std::size_t c = 0; c < sums.size(); ++c) {
+        consumers.emplace_back([&queue, &sums, c]() {
+            while (true) {
+                int value = 0;
+                queue.wait_and_pop(value);
+                if (value == 0) {
+                    return;
+                }
+                sums[c] += value;
+            }
+        });
+    }
+
+    for (auto& thread : producers) {
+        thread.join();
+    }
+    for (std::size_t c = 0; c < consumers.size(); ++c) {
+        queue.push(0);
+    }
+    for (auto& thread : consumers) {
+        thread.join();
+    }
+
+    const long long expected = static_cast<long long>(num_producers) * num_per_producer * (num_per_producer + 1) / 2;
+    REQUIRE(sums[0] + sums[1] == expected);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("Lock-free queue wakes up blocked threads") {
+    osmium::thread::LockFreeQueue<int> queue{2};
+    queue.push(1);
+    queue.push(2);
+
+    // queue is full, so this blocks until main thread pops
+    std::thread producer{[&queue]() {
+        queue.push(3);
+    }};
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    int value = 0;
+    queue.wait_and_pop(value);
+    REQUIRE(value == 1);
+    producer.join();
+
+    queue.wait_and_pop(value);
+    REQUIRE(value == 2);
+    queue.wait_and_pop(value);
+    REQUIRE(value == 3);
+
+    // queue is empty, so this blocks until main thread pushes
+    std::thread consumer{[&queue, &value]() {
+        queue.wait_and_pop(value);
+    }};
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    queue.push(4);
+    consumer.join();
+    REQUIRE(value == 4);
+}
@@ -2,7 +2,9 @@
 
 #include <osmium/thread/pool.hpp>
 
+#include <future>
 #include <stdexcept>
+#include <vector>
 
 struct test_job_with_result {
     int operator()() const {
@@ -10,6 +12,20 @@ struct test_job_with_result {
     }
 };
 
+struct test_job_submit_nested {
+    osmium::thread::Pool* pool;
+
+    std::vector<std::future<int>> operator()() const {
+        std::vector<std::future<int>> futures;
+        for (int i = 0; i < 100; ++i) {
+            futures.push_back(pool->submit([i]() {
+                return i;
+            }));
+        }
+        return futures;
+    }
+};
+
 struct test_job_throw {
     [[noreturn]] void operator()() const {
         throw std::runtime_error{"exception in pool thread"};
@@ -104,3 +120,52 @@ TEST_CASE("can throw from job in user provided thread pool") {
     REQUIRE_THROWS_AS(future.get(), const std::runtime_error&);
 }
 
+
+TEST_CASE("can send job to work stealing thread pool") {
+    osmium::thread::Pool pool{3, 0, osmium::thread::Pool::scheduling::work_stealing};
+    REQUIRE(pool.work_stealing());
+    REQUIRE(pool.queue_empty());
+    auto future = pool.submit(test_job_with_result{});
+    REQUIRE(future.get() == 42);
+}
+
+TEST_CASE("can throw from job in work stealing thread pool") {
+    osmium::thread::Pool pool{3, 0, osmium::thread::Pool::scheduling::work_stealing};
+    auto future = pool.submit(test_job_throw{});
+    REQUIRE_THROWS_AS(future.get(), const std::runtime_error&);
+}
+
+TEST_CASE("can submit jobs from inside jobs in work stealing thread pool") {
+    osmium::thread::Pool pool{3, 0, osmium::thread::Pool::scheduling::work_stealing};
+
+    std::vector<std::future<std::vector<std::future<int>>>> outer;
+    for (int i = 0; i < 20; ++i) {
+        outer.push_back(pool.submit(test_job_submit_nested{&pool}));
+    }
+
+    int sum = 0;
+    for (auto& future : outer) {
+        for (auto& inner : future.get()) {
+            sum += inner.get();
+        }
+    }
+    REQUIRE(sum == 20 * 4950);
+}
+
+TEST_CASE("work stealing thread pool runs all jobs before shutdown") {
+    std::vector<std::future<std::vector<std::future<int>>>> outer;
+    {
+        osmium::thread::Pool pool{2, 0, osmium::thread::Pool::scheduling::work_stealing};
+        for (int i = 0; i < 5; ++i) {
+            outer.push_back(pool.submit(test_job_submit_nested{&pool}));
+        }
+    }
+
+    int sum = 0;
+    for (auto& future : outer) {
+        for (auto& inner : future.get()) {
+            sum += inner.get();
+        }
+    }
+    REQUIRE(sum == 5 * 4950);
+}
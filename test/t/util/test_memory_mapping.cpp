@@ -108,6 +108,26 @@ TEST_CASE("Anonymous mapping: remapping to smaller size should work") {
     const auto* addr2 = mapping.get_addr<int>();
     REQUIRE(*addr2 == 42);
 }
+
+TEST_CASE("Anonymous mapping with huge pages: remapping to larger size should work") {
+    const std::size_t size = 4 * 1024 * 1024;
+    osmium::MemoryMapping mapping{size, osmium::MemoryMapping::mapping_mode::write_private_huge};
+    REQUIRE(mapping.writable());
+    REQUIRE(mapping.size() == size);
+
+    auto* addr1 = mapping.get_addr<char>();
+    addr1[0] = 'a';
+    addr1[size - 1] = 'b';
+
+    mapping.resize(2 * size);
+    REQUIRE(mapping.size() == 2 * size);
+
+    auto* addr2 = mapping.get_addr<char>();
+    REQUIRE(addr2[0] == 'a');
+    REQUIRE(addr2[size - 1] == 'b');
+    addr2[2 * size - 1] = 'c';
+    REQUIRE(addr2[2 * size - 1] == 'c');
+}
 #endif
 
 TEST_CASE("File-based mapping: writing to a mapped file should work") {